@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "manager.hpp"
+
+namespace {
+struct Position {
+  float x, y, z;
+};
+struct Velocity {
+  float x, y, z;
+};
+
+// Every thread creates entities, adds two components and removes one of them
+double Run(ComponentManager::Concurrency const concurrency,
+           unsigned const threadCount, int const entitiesPerThread) {
+  Manager manager(std::make_shared<ComponentManager>(concurrency));
+
+  auto const start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < entitiesPerThread; ++i) {
+        auto entity = manager.CreateEntity().lock();
+        entity->AddComponent<Position>({1.0f, 2.0f, 3.0f});
+        entity->AddComponent<Velocity>({0.0f, 1.0f, 0.0f});
+        entity->RemoveComponent<Velocity>();
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return threadCount * entitiesPerThread / elapsed.count();
+}
+}  // namespace
+
+// Usage: CrystalEntityBench [entities per thread] [max threads]
+int main(int argc, char** argv) {
+  int const entitiesPerThread = argc > 1 ? std::atoi(argv[1]) : 100000;
+  unsigned const maxThreads =
+      argc > 2 ? static_cast<unsigned>(std::atoi(argv[2]))
+               : std::max(1u, std::thread::hardware_concurrency());
+
+  std::cout << "threads  mode            entities/s\n";
+  std::cout << "1        single-threaded "
+            << Run(ComponentManager::Concurrency::SingleThreaded, 1,
+                   entitiesPerThread)
+            << "\n";
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    std::cout << threads << std::string(9 - std::to_string(threads).size(), ' ')
+              << "sharded         "
+              << Run(ComponentManager::Concurrency::Sharded, threads,
+                     entitiesPerThread)
+              << "\n";
+  }
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "buffered.hpp"
+#include "manager.hpp"
+
+// Drives a Manager with whole-game workload profiles rather than single
+// operations, to find where ticks stop scaling with entities or threads.
+// Every entity moves each tick and the profile adds its own load on top:
+//
+//   steady   nothing else
+//   churn    destroys and respawns a fraction of entities every tick
+//   toggle   disables a fraction of entities and re-enables last tick's
+//   systems  adds many read-only systems
+//   events   every entity sends a custom event to several observers
+//
+// Each entity count and thread count pair runs in its own child process, so
+// peak RSS (from getrusage) is per configuration.
+namespace {
+struct Position {
+  float x, y, z;
+};
+struct Velocity {
+  float x, y, z;
+};
+struct Health {
+  float value;
+};
+struct Damage {
+  Entity::Id target;
+  float amount;
+};
+
+struct Config {
+  std::string profile = "steady";
+  std::vector<std::size_t> entities = {100000};
+  std::vector<unsigned> threads = {1};
+  int ticks = 100;
+  int warmup = 10;
+  int systems = 16;
+  double fraction = 0.01;
+  int subscribers = 4;
+};
+
+// State shared between the harness and the profile systems
+struct World {
+  Manager* manager;
+  unsigned threads;
+  double fraction;
+  std::vector<Entity::Id> live;
+  std::mt19937 random{42};
+  std::atomic<std::size_t> operations = 0;
+};
+
+Entity::Id Spawn(Manager& manager, unsigned const seed) {
+  auto entity = manager.CreateEntity().lock();
+  auto const angle = static_cast<float>(seed % 360);
+  entity->AddComponent<Buffered<Position>>(
+      Position{static_cast<float>(seed % 1000), 0.0f, 0.0f});
+  entity->AddComponent<Velocity>({std::cos(angle), std::sin(angle), 0.0f});
+  entity->AddComponent<Health>({100.0f});
+  return entity->GetId();
+}
+
+// Runs func(thread index) on count threads, inline for one
+template <typename Func>
+void Parallel(unsigned const count, Func const& func) {
+  if (count == 1) return func(0u);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < count; ++t) threads.emplace_back(func, t);
+  for (auto& thread : threads) thread.join();
+}
+
+class Move : public System {
+ public:
+  Move(std::shared_ptr<EventManager>, World* world) : world_(world) {}
+
+  void Tick(double const deltaTime) override {
+    auto const dt = static_cast<float>(deltaTime);
+    auto phase = world_->manager->BeginReadPhase();
+    phase.ParallelForEach<Buffered<Position>, Velocity>(
+        [dt](Entity const&, Buffered<Position> const& position,
+             Velocity const& velocity) {
+          auto const& from = position.Read();
+          position.Write() = {from.x + velocity.x * dt,
+                              from.y + velocity.y * dt, from.z};
+        },
+        world_->threads);
+  }
+
+ private:
+  World* world_;
+};
+
+class Churn : public System {
+ public:
+  Churn(std::shared_ptr<EventManager>, World* world) : world_(world) {}
+
+  void Tick(double const) override {
+    auto& live = world_->live;
+    auto const count = static_cast<std::size_t>(
+        std::ceil(live.size() * world_->fraction));
+    std::vector<Entity::Id> victims;
+    for (std::size_t i = 0; i < count && !live.empty(); ++i) {
+      auto const index = world_->random() % live.size();
+      victims.push_back(live[index]);
+      live[index] = live.back();
+      live.pop_back();
+    }
+
+    auto const threads = world_->threads;
+    std::mutex mutex;
+    Parallel(threads, [&](unsigned const t) {
+      std::vector<Entity::Id> spawned;
+      for (auto i = t; i < victims.size(); i += threads) {
+        world_->manager->DestroyEntity(victims[i]);
+        spawned.push_back(Spawn(*world_->manager, victims[i]));
+      }
+      std::lock_guard lock(mutex);
+      live.insert(live.end(), spawned.begin(), spawned.end());
+    });
+    world_->operations += 2 * victims.size();
+  }
+
+ private:
+  World* world_;
+};
+
+class Toggle : public System {
+ public:
+  Toggle(std::shared_ptr<EventManager>, World* world) : world_(world) {}
+
+  void Tick(double const) override {
+    auto& manager = *world_->manager;
+    for (auto const entityId : disabled_) {
+      if (auto entity = manager.GetEntity(entityId).lock()) {
+        entity->SetIsEnabled(true);
+      }
+    }
+    world_->operations += disabled_.size();
+    disabled_.clear();
+
+    auto const& live = world_->live;
+    auto const count =
+        static_cast<std::size_t>(std::ceil(live.size() * world_->fraction));
+    for (std::size_t i = 0; i < count; ++i) {
+      auto const entityId = live[world_->random() % live.size()];
+      if (auto entity = manager.GetEntity(entityId).lock()) {
+        entity->SetIsEnabled(false);
+        disabled_.push_back(entityId);
+      }
+    }
+    world_->operations += disabled_.size();
+  }
+
+ private:
+  World* world_;
+  std::vector<Entity::Id> disabled_;
+};
+
+// One type per instance, since a manager holds one system of each type
+template <int Index>
+class Reader : public System {
+ public:
+  Reader(std::shared_ptr<EventManager>, World* world) : world_(world) {}
+
+  void Tick(double const) override {
+    auto phase = world_->manager->BeginReadPhase();
+    std::atomic<std::size_t> visited = 0;
+    phase.ParallelForEach<Health>(
+        [&](Entity const&, Health const& health) {
+          if (health.value > Index) ++visited;
+        },
+        world_->threads);
+    world_->operations += visited;
+  }
+
+ private:
+  World* world_;
+};
+
+constexpr int kMaxReaders = 32;
+
+template <int... Indices>
+void AddReaders(Manager& manager, World* world, int const count,
+                std::integer_sequence<int, Indices...>) {
+  ((Indices < count ? (manager.AddSystem<Reader<Indices>>(world), 0) : 0),
+   ...);
+}
+
+class EventStorm : public System {
+ public:
+  EventStorm(std::shared_ptr<EventManager> eventManager, World* world,
+             int const subscribers)
+      : world_(world), subject_(eventManager->CreateSubject<Damage>()) {
+    for (int i = 0; i < subscribers; ++i) {
+      observers_.push_back(eventManager->Subscribe<Damage>(
+          [this](Damage const& damage) { total_ += damage.amount; }));
+    }
+  }
+  ~EventStorm() {
+    for (auto& observer : observers_) observer->Unsubscribe();
+  }
+
+  void Tick(double const) override {
+    for (auto const entityId : world_->live) {
+      subject_->Notify(Damage{entityId, 1.0f});
+    }
+    world_->operations += world_->live.size() * observers_.size();
+  }
+
+ private:
+  World* world_;
+  EventPtr<Damage> subject_;
+  std::vector<ObserverPtr> observers_;
+  double total_ = 0.0;
+};
+
+double Seconds(std::chrono::steady_clock::duration const duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+double Percentile(std::vector<double> const& sorted, double const q) {
+  auto const rank = static_cast<std::size_t>(std::ceil(q * sorted.size()));
+  return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// Runs one configuration and prints its row
+bool Run(Config const& config, std::size_t const entityCount,
+         unsigned const threads) {
+  auto const concurrency = threads > 1
+                               ? ComponentManager::Concurrency::Sharded
+                               : ComponentManager::Concurrency::SingleThreaded;
+  Manager manager(std::make_shared<ComponentManager>(concurrency));
+  World world{&manager, threads, config.fraction, {}};
+
+  auto const setupStart = std::chrono::steady_clock::now();
+  world.live.reserve(entityCount);
+  for (std::size_t i = 0; i < entityCount; ++i) {
+    world.live.push_back(Spawn(manager, static_cast<unsigned>(i)));
+  }
+  auto const setup = Seconds(std::chrono::steady_clock::now() - setupStart);
+
+  manager.AddSystem<Move>(&world);
+  if (config.profile == "churn") {
+    manager.AddSystem<Churn>(&world);
+  } else if (config.profile == "toggle") {
+    manager.AddSystem<Toggle>(&world);
+  } else if (config.profile == "systems") {
+    AddReaders(manager, &world, config.systems,
+               std::make_integer_sequence<int, kMaxReaders>{});
+  } else if (config.profile == "events") {
+    manager.AddSystem<EventStorm>(&world, config.subscribers);
+  } else if (config.profile != "steady") {
+    std::cerr << "unknown profile " << config.profile << "\n";
+    return false;
+  }
+
+  double constexpr kDeltaTime = 1.0 / 60.0;
+  for (int i = 0; i < config.warmup; ++i) manager.Tick(kDeltaTime);
+  world.operations = 0;
+
+  std::vector<double> latencies;
+  latencies.reserve(config.ticks);
+  for (int i = 0; i < config.ticks; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+    manager.Tick(kDeltaTime);
+    latencies.push_back(Seconds(std::chrono::steady_clock::now() - start));
+  }
+
+  double total = 0.0;
+  for (auto const latency : latencies) total += latency;
+  std::sort(latencies.begin(), latencies.end());
+
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::printf(
+      "%-8s %10zu %7u %9.2f %9.3f %9.3f %9.3f %9.3f %9.3f %12.3g %12.3g "
+      "%9.1f\n",
+      config.profile.c_str(), entityCount, threads, setup,
+      total / latencies.size() * 1e3, Percentile(latencies, 0.5) * 1e3,
+      Percentile(latencies, 0.99) * 1e3, Percentile(latencies, 0.999) * 1e3,
+      latencies.back() * 1e3, entityCount * latencies.size() / total,
+      world.operations / total, usage.ru_maxrss / 1024.0);
+  std::fflush(stdout);
+  return true;
+}
+
+template <typename T>
+std::vector<T> ParseList(std::string const& value) {
+  std::vector<T> items;
+  std::size_t begin = 0;
+  while (begin <= value.size()) {
+    auto end = value.find(',', begin);
+    if (end == std::string::npos) end = value.size();
+    items.push_back(
+        static_cast<T>(std::stod(value.substr(begin, end - begin))));
+    begin = end + 1;
+  }
+  return items;
+}
+
+bool Parse(int const argc, char** argv, Config& config) {
+  for (int i = 1; i < argc; ++i) {
+    std::string const arg = argv[i];
+    auto const split = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || split == std::string::npos) return false;
+    auto const name = arg.substr(2, split - 2);
+    auto const value = arg.substr(split + 1);
+
+    if (name == "profile") {
+      config.profile = value;
+    } else if (name == "entities") {
+      config.entities = ParseList<std::size_t>(value);
+    } else if (name == "threads") {
+      config.threads = ParseList<unsigned>(value);
+    } else if (name == "ticks") {
+      config.ticks = std::max(1, std::stoi(value));
+    } else if (name == "warmup") {
+      config.warmup = std::stoi(value);
+    } else if (name == "systems") {
+      config.systems = std::clamp(std::stoi(value), 0, kMaxReaders);
+    } else if (name == "fraction") {
+      config.fraction = std::stod(value);
+    } else if (name == "subscribers") {
+      config.subscribers = std::stoi(value);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+// Usage: CrystalEntitySim [--profile=steady|churn|toggle|systems|events]
+//   [--entities=10000,100000,...] [--threads=1,2,4,...] [--ticks=N]
+//   [--warmup=N] [--systems=N] [--fraction=F] [--subscribers=N]
+int main(int argc, char** argv) {
+  Config config;
+  try {
+    if (!Parse(argc, argv, config)) {
+      std::cerr << "usage: " << argv[0]
+                << " [--profile=steady|churn|toggle|systems|events]"
+                   " [--entities=list] [--threads=list] [--ticks=N]"
+                   " [--warmup=N] [--systems=N] [--fraction=F]"
+                   " [--subscribers=N]\n";
+      return 1;
+    }
+  } catch (std::exception const&) {
+    std::cerr << "invalid number in arguments\n";
+    return 1;
+  }
+
+  std::printf(
+      "%-8s %10s %7s %9s %9s %9s %9s %9s %9s %12s %12s %9s\n", "profile",
+      "entities", "threads", "setup s", "mean ms", "p50 ms", "p99 ms",
+      "p99.9 ms", "max ms", "entities/s", "ops/s", "rss MiB");
+  std::fflush(stdout);
+
+  int failures = 0;
+  for (auto const entityCount : config.entities) {
+    for (auto const threads : config.threads) {
+      auto const child = fork();
+      if (child == 0) {
+        _exit(Run(config, entityCount, std::max(1u, threads)) ? 0 : 1);
+      }
+
+      int status = 0;
+      if (child < 0 || waitpid(child, &status, 0) < 0 ||
+          !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::printf("%-8s %10zu %7u failed\n", config.profile.c_str(),
+                    entityCount, threads);
+        ++failures;
+      }
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+using BufferEpoch = uint32_t;
+
+// A double buffered component value. During a tick Read returns the value as
+// it was at the end of the previous tick and Write the value being built for
+// the next one, so systems can read neighbours while updating entities in
+// parallel without locks. Manager::Tick ends by advancing the type's epoch,
+// which flips every component of the type at once.
+//
+// The first Write in a tick copies the previous value into the write buffer.
+// Only one thread may write a given component per tick but any number may
+// read it. Write is const so components can be updated from read phases.
+template <typename ValueType>
+class Buffered {
+ public:
+  Buffered() = default;
+  Buffered(ValueType value) : values_{value, std::move(value)} {}
+
+  Buffered(Buffered const& other)
+      : values_{other.values_[0], other.values_[1]},
+        state_(other.state_.load(std::memory_order_relaxed)),
+        epoch_(other.epoch_) {}
+
+  // Keeps this component's epoch
+  Buffered& operator=(Buffered const& other) {
+    values_[0] = other.values_[0];
+    values_[1] = other.values_[1];
+    state_.store(other.state_.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+    return *this;
+  }
+
+  ValueType const& Read() const {
+    auto const state = state_.load(std::memory_order_acquire);
+    auto const index = state & 1;
+    return values_[(state >> 1) == CurrentEpoch() ? index ^ 1 : index];
+  }
+
+  ValueType& Write() const {
+    auto const epoch = CurrentEpoch();
+    auto const state = state_.load(std::memory_order_relaxed);
+    auto index = state & 1;
+    if ((state >> 1) != epoch) {
+      // Readers only ever see the other buffer, before and after the store
+      index ^= 1;
+      values_[index] = values_[index ^ 1];
+      state_.store(uint64_t{epoch} << 1 | index, std::memory_order_release);
+    }
+    return values_[index];
+  }
+
+  // Done by ComponentManager for the components in its pools
+  void Bind(std::atomic<BufferEpoch> const* epoch) { epoch_ = epoch; }
+
+ private:
+  BufferEpoch CurrentEpoch() const {
+    return epoch_ ? epoch_->load(std::memory_order_relaxed) : 1;
+  }
+
+  mutable ValueType values_[2] = {};
+  // Epoch of the latest write shifted left, with the index of its buffer.
+  // Epochs start at 1 so a new component reads its initial value
+  mutable std::atomic<uint64_t> state_ = 0;
+  std::atomic<BufferEpoch> const* epoch_ = nullptr;
+};
+
+template <typename ComponentType>
+struct IsBuffered : std::false_type {};
+template <typename ValueType>
+struct IsBuffered<Buffered<ValueType>> : std::true_type {};
\ No newline at end of file
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "component.hpp"
+#include "events.hpp"
+#include "hash.hpp"
+#include "system.hpp"
+#include "thread_pool.hpp"
+
+// Deterministic hash of a component seeded with its entity. Trivially
+// copyable types hash their bytes, so any padding must be zeroed or the type
+// given a specialisation hashing its fields
+template <typename ComponentType>
+struct ComponentHash {
+  uint64_t operator()(ComponentType const& component,
+                      uint64_t const seed) const {
+    static_assert(std::is_trivially_copyable_v<ComponentType>,
+                  "Specialise ComponentHash for this component type");
+    if constexpr (std::is_empty_v<ComponentType>) {
+      return MixHash(seed);
+    } else {
+      return HashBytes(&component, sizeof(ComponentType), seed);
+    }
+  }
+};
+
+// Order independent checksum of the listed component pools, for comparing
+// world state between peers or against a replay. Each component contributes
+// a hash of its entity and value, summed per chunk of entity ids, so chunks
+// can be recomputed alone and the result doesn't depend on pool order.
+//
+// Adds, removes and replaces mark their chunk through component events,
+// including the ChangeComponents events of bulk inserts, bulk removes and
+// cold storage. Writes through component pointers aren't seen, so call
+// MarkChanged (or MarkAllChanged) for them before computing. Ticking computes
+// the checksum and hands it to the callback, if any:
+//
+//   manager.AddSystem<ChecksumSystem<Position, Health>>(
+//       componentManager, 4u, [](uint64_t checksum) { ... });
+template <typename... ComponentTypes>
+class ChecksumSystem : public System {
+ public:
+  using EntityId = ComponentManager::EntityId;
+  using Callback = std::function<void(uint64_t)>;
+
+  static constexpr EntityId kChunkSize = 256;
+
+  ChecksumSystem(std::shared_ptr<EventManager> const& eventManager,
+                 std::shared_ptr<ComponentManager> componentManager,
+                 unsigned const threadCount = 1, Callback func = nullptr)
+      : componentManager_(std::move(componentManager)),
+        func_(std::move(func)),
+        threads_(threadCount > 1 ? std::make_unique<ThreadPool>(threadCount)
+                                 : nullptr) {
+    if (!eventManager) return;
+    for (auto const event :
+         {SystemEvent::AssignComponent, SystemEvent::RemoveComponent,
+          SystemEvent::ChangeComponent}) {
+      observers_.push_back(
+          eventManager
+              ->SubscribeSystem<EntityId, ComponentManager::Handle>(
+                  event, [this](EntityId const& entityId,
+                                ComponentManager::Handle const& handle) {
+                    MarkChunk(entityId, handle.Type);
+                  }));
+    }
+    observers_.push_back(
+        eventManager->SubscribeSystem<ComponentManager::TypeId,
+                                      std::vector<EntityId>>(
+            SystemEvent::ChangeComponents,
+            [this](ComponentManager::TypeId const& type,
+                   std::vector<EntityId> const& entityIds) {
+              for (auto const entityId : entityIds) MarkChunk(entityId, type);
+            }));
+  }
+
+  ~ChecksumSystem() {
+    for (auto& observer : observers_) {
+      if (observer) observer->Unsubscribe();
+    }
+  }
+
+  void Tick(double const) override {
+    auto const checksum = Compute();
+    if (func_) func_(checksum);
+  }
+
+  // Marks the entity's chunk in every tracked pool
+  void MarkChanged(EntityId const entityId) {
+    std::lock_guard lock(mutex_);
+    std::apply(
+        [&](auto&... pools) { (pools.Dirty.insert(Chunk(entityId)), ...); },
+        pools_);
+  }
+
+  void MarkAllChanged() {
+    std::lock_guard lock(mutex_);
+    std::apply([](auto&... pools) { ((pools.AllDirty = true), ...); },
+               pools_);
+  }
+
+  // Recomputes dirty chunks, each pool as its own job on the system's
+  // threads
+  uint64_t Compute() {
+    if (!threads_) {
+      std::apply([&](auto&... pools) { (Refresh(pools), ...); }, pools_);
+    } else {
+      remaining_ = sizeof...(ComponentTypes);
+      std::apply(
+          [&](auto&... pools) {
+            (threads_->Submit([this, &pools] {
+              Refresh(pools);
+              if (--remaining_ == 0) {
+                std::lock_guard lock(mutex_);
+                idle_.notify_all();
+              }
+            }),
+             ...);
+          },
+          pools_);
+      std::unique_lock lock(mutex_);
+      idle_.wait(lock, [&] { return remaining_ == 0; });
+    }
+
+    // Salted by position so swapping two pools' contents changes the result
+    uint64_t checksum = 0;
+    uint64_t salt = 0;
+    std::apply(
+        [&](auto const&... pools) {
+          ((checksum += MixHash(pools.Total + ++salt)), ...);
+        },
+        pools_);
+    return checksum;
+  }
+
+ protected:
+  // Only chunks holding components are stored, so entities from a high id
+  // range (see Shard::FirstEntityId) don't cost a sum per unused chunk
+  template <typename ComponentType>
+  struct Pool {
+    std::unordered_map<std::size_t, uint64_t> Chunks;
+    uint64_t Total = 0;
+    bool AllDirty = true;
+    std::unordered_set<std::size_t> Dirty;
+  };
+
+  static std::size_t Chunk(EntityId const entityId) {
+    return static_cast<std::size_t>(entityId / kChunkSize);
+  }
+
+  static uint64_t Hash(EntityId const entityId, auto const& component) {
+    using ComponentType = std::decay_t<decltype(component)>;
+    return ComponentHash<ComponentType>{}(
+        component, MixHash(static_cast<uint64_t>(entityId)));
+  }
+
+  void MarkChunk(EntityId const entityId,
+                 ComponentManager::TypeId const type) {
+    std::lock_guard lock(mutex_);
+    std::apply(
+        [&]<typename... Types>(Pool<Types>&... pools) {
+          ((ComponentManager::GetTypeId<Types>() == type
+                ? void(pools.Dirty.insert(Chunk(entityId)))
+                : void()),
+           ...);
+        },
+        pools_);
+  }
+
+  template <typename ComponentType>
+  void Refresh(Pool<ComponentType>& pool) {
+    bool allDirty;
+    std::unordered_set<std::size_t> dirty;
+    {
+      std::lock_guard lock(mutex_);
+      allDirty = std::exchange(pool.AllDirty, false);
+      dirty = std::exchange(pool.Dirty, {});
+    }
+
+    // Components mostly arrive in id order, so the last chunk's sum is kept
+    // at hand. Map nodes don't move, so the pointer survives rehashing
+    auto lastChunk = ~std::size_t{0};
+    uint64_t* sum = nullptr;
+    auto add = [&](EntityId const entityId, ComponentType const& component) {
+      auto const chunk = Chunk(entityId);
+      if (chunk != lastChunk) {
+        lastChunk = chunk;
+        sum = &pool.Chunks[chunk];
+      }
+      auto const hash = Hash(entityId, component);
+      *sum += hash;
+      pool.Total += hash;
+    };
+
+    if (allDirty) {
+      pool.Chunks.clear();
+      pool.Total = 0;
+      if constexpr (ComponentManager::IsTag<ComponentType>) {
+        for (auto const entityId :
+             componentManager_->Query<With<ComponentType>>(false)) {
+          add(entityId, ComponentType{});
+        }
+      } else {
+        componentManager_->ForEachComponent<ComponentType>(add, false);
+      }
+    } else {
+      for (auto const chunk : dirty) {
+        if (auto it = pool.Chunks.find(chunk); it != pool.Chunks.end()) {
+          pool.Total -= it->second;
+          pool.Chunks.erase(it);
+          if (lastChunk == chunk) lastChunk = ~std::size_t{0};
+        }
+        auto const begin = static_cast<EntityId>(chunk) * kChunkSize;
+        componentManager_->ForEachInRange<ComponentType>(
+            begin, begin + kChunkSize, add, false);
+      }
+    }
+  }
+
+ private:
+  std::shared_ptr<ComponentManager> componentManager_;
+  Callback func_;
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  std::atomic<std::size_t> remaining_ = 0;
+  std::tuple<Pool<ComponentTypes>...> pools_;
+  std::vector<ObserverPtr> observers_;
+  // Last so the threads stop before anything they use is destroyed. None
+  // when computing on the calling thread
+  std::unique_ptr<ThreadPool> threads_;
+};
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "compression.hpp"
+#include "pool.hpp"
+
+// Compressed component bytes of disabled entities, keyed by entity. Each
+// entity's components are packed back to back in the order of its records and
+// compressed as one block. Thread safe
+class ColdStore {
+ public:
+  using EntityId = int32_t;
+  using TypeId = uint64_t;
+  using DataId = ComponentPoolBase::DataId;
+
+  struct Record {
+    TypeId Type;
+    DataId Data;
+    std::size_t Size;
+    // Removed while frozen, its bytes are skipped on restore
+    bool Dropped = false;
+  };
+
+  struct Frozen {
+    std::vector<Record> Records;
+    std::vector<uint8_t> Bytes;
+  };
+
+  // Cheap enough to check before every structural change
+  bool Empty() const { return count_ == 0; }
+
+  bool Contains(EntityId const entityId) const {
+    std::lock_guard lock(mutex_);
+    return entities_.contains(entityId);
+  }
+
+  // Compressed bytes held over all entities
+  std::size_t Bytes() const {
+    std::lock_guard lock(mutex_);
+    return bytes_;
+  }
+
+  // Merges with anything already frozen for the entity
+  void Add(EntityId const entityId, Frozen frozen) {
+    std::lock_guard lock(mutex_);
+    auto [it, inserted] = entities_.try_emplace(entityId);
+    auto& entry = it->second;
+    if (!inserted) {
+      auto old = Unpack(entry);
+      old.Records.insert(old.Records.end(), frozen.Records.begin(),
+                         frozen.Records.end());
+      old.Bytes.insert(old.Bytes.end(), frozen.Bytes.begin(),
+                       frozen.Bytes.end());
+      frozen = std::move(old);
+      bytes_ -= entry.Data.size();
+    } else {
+      ++count_;
+    }
+
+    for (auto const& record : frozen.Records) {
+      if (!record.Dropped) owners_[record.Type][record.Data] = entityId;
+    }
+    entry.Records = std::move(frozen.Records);
+    entry.RawSize = frozen.Bytes.size();
+    entry.Data = LzCompress(frozen.Bytes);
+    bytes_ += entry.Data.size();
+  }
+
+  // Decompresses and forgets the entity, returning no records if it has none
+  Frozen Take(EntityId const entityId) {
+    std::lock_guard lock(mutex_);
+    auto it = entities_.find(entityId);
+    if (it == entities_.end()) return {};
+
+    auto frozen = Unpack(it->second);
+    for (auto const& record : frozen.Records) {
+      if (!record.Dropped) owners_[record.Type].erase(record.Data);
+    }
+    bytes_ -= it->second.Data.size();
+    entities_.erase(it);
+    --count_;
+    return frozen;
+  }
+
+  // Drops a frozen component by handle, returning its entity or ~0
+  EntityId Drop(TypeId const type, DataId const dataId) {
+    std::lock_guard lock(mutex_);
+    auto owners = owners_.find(type);
+    if (owners == owners_.end()) return EntityId{~0};
+    auto owner = owners->second.find(dataId);
+    if (owner == owners->second.end()) return EntityId{~0};
+
+    auto const entityId = owner->second;
+    owners->second.erase(owner);
+    auto it = entities_.find(entityId);
+    for (auto& record : it->second.Records) {
+      if (record.Type == type && record.Data == dataId) record.Dropped = true;
+    }
+    EraseIfDropped(it);
+    return entityId;
+  }
+
+  // Drops the entity's frozen component of a type, returning its data id or
+  // ~0
+  DataId Drop(EntityId const entityId, TypeId const type) {
+    std::lock_guard lock(mutex_);
+    auto it = entities_.find(entityId);
+    if (it == entities_.end()) return DataId{~0};
+
+    for (auto& record : it->second.Records) {
+      if (record.Type != type || record.Dropped) continue;
+      record.Dropped = true;
+      owners_[type].erase(record.Data);
+      auto const dataId = record.Data;
+      EraseIfDropped(it);
+      return dataId;
+    }
+    return DataId{~0};
+  }
+
+ private:
+  struct Entry {
+    std::vector<Record> Records;
+    std::vector<uint8_t> Data;
+    std::size_t RawSize = 0;
+  };
+
+  // Nothing left to restore once every component has been removed
+  void EraseIfDropped(std::unordered_map<EntityId, Entry>::iterator const it) {
+    auto const& records = it->second.Records;
+    if (std::all_of(records.begin(), records.end(),
+                    [](Record const& record) { return record.Dropped; })) {
+      bytes_ -= it->second.Data.size();
+      entities_.erase(it);
+      --count_;
+    }
+  }
+
+  static Frozen Unpack(Entry const& entry) {
+    Frozen frozen{entry.Records, {}};
+    [[maybe_unused]] auto const valid =
+        LzDecompress(entry.Data, entry.RawSize, frozen.Bytes);
+    assert(valid);
+    return frozen;
+  }
+
+  mutable std::mutex mutex_;
+  std::unordered_map<EntityId, Entry> entities_;
+  // Frozen data ids per type, so a component can be removed by handle
+  std::unordered_map<TypeId, std::unordered_map<DataId, EntityId>> owners_;
+  std::size_t bytes_ = 0;
+  std::atomic<std::size_t> count_ = 0;
+};
\ No newline at end of file
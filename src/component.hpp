@@ -1,16 +1,33 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <typeinfo>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
-#include "AsyncLib/pool.hpp"
+#include "buffered.hpp"
+#include "cold_store.hpp"
 #include "events.hpp"
+#include "pool.hpp"
+#include "profiler.hpp"
+#include "query.hpp"
+#include "shared.hpp"
+#include "soa.hpp"
 
 class ComponentManager {
-  using DataId = int64_t;
+  using DataId = ComponentPoolBase::DataId;
 
  public:
   // Has to be uint to be compatible with hash_code
@@ -20,12 +37,34 @@ class ComponentManager {
   struct Handle {
     TypeId Type;
     DataId Data;
+
+    bool IsValid() const { return Data != DataId{~0}; }
+  };
+
+  enum class CompactOrder {
+    Insertion,
+    EntityId,
+  };
+
+  struct PoolStats {
+    std::size_t Size;
+    std::size_t Capacity;
+  };
+
+  // Sharded takes a lock per component type so worker threads can create and
+  // remove components of different (or the same) types concurrently
+  enum class Concurrency {
+    SingleThreaded,
+    Sharded,
   };
 
  protected:
   class EntityMappings {
    public:
     void Set(EntityId const entityId, DataId const dataId, bool isEnabled) {
+      ++revision_;
+      members_.Set(entityId, isEnabled);
+      dataEntities_.insert_or_assign(dataId, entityId);
       if (isEnabled) {
         enabledEntityMap_.insert({entityId, dataId});
       } else {
@@ -46,12 +85,9 @@ class ComponentManager {
 
     EntityId GetEntity(DataId const dataId,
                        bool const ignoreDisabled = true) const {
-      if (auto const entityIdPtr = GetEntity(dataId, enabledEntityMap_)) {
-        return *entityIdPtr;
-      } else if (!ignoreDisabled) {
-        if (auto const entityIdPtr = GetEntity(dataId, disabledEntityMap_)) {
-          return *entityIdPtr;
-        }
+      auto it = dataEntities_.find(dataId);
+      if (it != dataEntities_.end() && Contains(it->second, ignoreDisabled)) {
+        return it->second;
       }
       // TODO: maybe throw excption
       return {~0};
@@ -73,9 +109,28 @@ class ComponentManager {
       return entities;
     }
 
+    // Visits enabled entities in id order, then disabled ones
+    template <typename Func>
+    void ForEachEntity(Func&& func, bool const ignoreDisabled = true) const {
+      members_.ForEach(func, ignoreDisabled);
+    }
+
+    std::size_t Size(bool const ignoreDisabled = true) const {
+      return enabledEntityMap_.size() +
+             (ignoreDisabled ? 0 : disabledEntityMap_.size());
+    }
+
+    std::vector<std::pair<EntityId, DataId>> GetAllMappings() const {
+      std::vector<std::pair<EntityId, DataId>> mappings(
+          enabledEntityMap_.begin(), enabledEntityMap_.end());
+      mappings.insert(mappings.end(), disabledEntityMap_.begin(),
+                      disabledEntityMap_.end());
+      return mappings;
+    }
+
+    // A bit test rather than a hash lookup
     bool Contains(EntityId const entityId, bool ignoreDisabled = true) const {
-      return enabledEntityMap_.contains(entityId) ||
-             (!ignoreDisabled && disabledEntityMap_.contains(entityId));
+      return members_.Contains(entityId, ignoreDisabled);
     }
 
     void SetIsEnabled(EntityId const entityId, bool isEnabled) {
@@ -87,99 +142,333 @@ class ComponentManager {
     }
 
     void Remove(EntityId const entityId) {
+      ++revision_;
+      if (Contains(entityId, false)) {
+        dataEntities_.erase(GetData(entityId, false));
+      }
+      members_.Remove(entityId);
       enabledEntityMap_.erase(entityId);
       disabledEntityMap_.erase(entityId);
     }
 
     void Remove(DataId const dataId) {
-      std::erase_if(enabledEntityMap_,
-                    [&](auto const& item) { return item.second == dataId; });
-      std::erase_if(disabledEntityMap_,
-                    [&](auto const& item) { return item.second == dataId; });
-    }
-
-   protected:
-    EntityId const* GetEntity(
-        DataId const dataId,
-        std::unordered_map<EntityId, DataId> const& map) const {
-      auto it = std::find_if(map.begin(), map.end(), [&](auto const& item) {
-        return item.second == dataId;
-      });
-      if (it != map.end()) {
-        return &it->first;
+      if (auto it = dataEntities_.find(dataId); it != dataEntities_.end()) {
+        Remove(it->second);
       }
-      return nullptr;
     }
 
+    void Reserve(std::size_t const count) {
+      enabledEntityMap_.reserve(enabledEntityMap_.size() + count);
+      dataEntities_.reserve(dataEntities_.size() + count);
+    }
+
+    // Changes whenever an entity's data id or enabled state may have changed
+    uint64_t GetRevision() const { return revision_; }
+
    private:
     std::unordered_map<EntityId, DataId> enabledEntityMap_;
     std::unordered_map<EntityId, DataId> disabledEntityMap_;
+    // Reverse lookup so pools can be walked in slot order
+    std::unordered_map<DataId, EntityId> dataEntities_;
+    // Paged, so a pool whose entities come from a high id range (see
+    // Shard::FirstEntityId) only pays for the pages those ids touch
+    TagSet members_;
+    uint64_t revision_ = 1;
   };
 
+  // Pools owned by a group keep the group's entities packed at the front in
+  // the same order. Any change to an owned pool marks the group for repacking
+  struct Group {
+    std::size_t Types = 0;
+    std::atomic<bool> Dirty = true;
+    std::vector<EntityId> Entities;
+  };
+
+  // Components with a SoaLayout are split into per-field arrays and shared
+  // components keep one copy per distinct value
+  template <typename ComponentType>
+  using PoolType = std::conditional_t<
+      SoaComponent<ComponentType>, SoaPool<ComponentType>,
+      std::conditional_t<SharedComponent<ComponentType>,
+                         SharedPool<ComponentType>,
+                         ComponentPool<ComponentType>>>;
+
+  // Empty component types only get a TagSet, everything else a pool and
+  // entity map
   struct Mappings {
-    std::shared_ptr<async_lib::PoolBase> ComponentPool;
+    std::shared_ptr<ComponentPoolBase> ComponentPool;
     EntityMappings EntityMap;
+    std::unique_ptr<TagSet> Tags;
+    // Set for pools kept sorted, see SetSortOrder
+    std::function<std::size_t()> Sort;
+    std::shared_ptr<Group> Owner;
+    // Read by the type's Buffered components, see SwapBuffers
+    std::atomic<BufferEpoch> Epoch = 1;
+    mutable std::mutex Mutex;
 
     template <typename ComponentType>
-    std::shared_ptr<async_lib::Pool<ComponentType>> GetPool() {
-      return std::static_pointer_cast<async_lib::Pool<ComponentType>>(
-          ComponentPool);
+    std::shared_ptr<PoolType<ComponentType>> GetPool() const {
+      return std::static_pointer_cast<PoolType<ComponentType>>(ComponentPool);
     }
   };
 
  public:
+  // Ids are handed out from firstEntityId up, so worlds that exchange
+  // entities (see shard.hpp) can be given ranges that don't overlap
+  explicit ComponentManager(
+      Concurrency const concurrency = Concurrency::SingleThreaded,
+      EntityId const firstEntityId = 0)
+      : concurrency_(concurrency), nextEntityId_(firstEntityId) {}
+
+  Concurrency GetConcurrency() const { return concurrency_; }
+
+  // Each component manager is its own id space, so separate worlds can't
+  // collide
+  EntityId NewEntityId() { return nextEntityId_++; }
+
+  // Held for the duration of a structural change. Evaluates to false (and the
+  // change must be skipped) while a read phase is active
+  class WriteScope {
+   public:
+    explicit WriteScope(ComponentManager& manager)
+        : writers_(manager.activeWriters_) {
+      ++writers_;
+      writing_.push_back(&manager);
+      allowed_ = !manager.InReadPhase();
+    }
+    ~WriteScope() {
+      writing_.pop_back();
+      --writers_;
+    }
+
+    WriteScope(WriteScope const&) = delete;
+    WriteScope& operator=(WriteScope const&) = delete;
+
+    explicit operator bool() const { return allowed_; }
+
+    // Whether the calling thread holds a scope on manager
+    static bool IsWriting(ComponentManager const& manager) {
+      return std::find(writing_.begin(), writing_.end(), &manager) !=
+             writing_.end();
+    }
+
+   private:
+    // Scopes held by this thread, innermost last
+    static inline thread_local std::vector<ComponentManager const*> writing_;
+
+    std::atomic<int>& writers_;
+    bool allowed_;
+  };
+
+  // While any read phase is active structural changes are rejected, which
+  // lets const lookups made through the phase (Find and ReadQuery) skip the
+  // pool locks. Everything else still locks. Waits for in-flight changes, so
+  // a thread inside a WriteScope would wait for itself: it is refused and
+  // false is returned instead
+  bool BeginReadPhase() {
+    if (WriteScope::IsWriting(*this)) return false;
+    ++readPhases_;
+    while (activeWriters_ > 0) std::this_thread::yield();
+    return true;
+  }
+
+  void EndReadPhase() {
+    assert(readPhases_ > 0);
+    --readPhases_;
+  }
+
+  bool InReadPhase() const { return readPhases_ > 0; }
+
   void SetSystemEvents(
       EventPtr<EntityId, ComponentManager::Handle> const& addEvent,
-      EventPtr<EntityId, ComponentManager::Handle> const& removeEvent) {
+      EventPtr<EntityId, ComponentManager::Handle> const& removeEvent,
+      EventPtr<EntityId, ComponentManager::Handle> const& changeEvent =
+          nullptr,
+      EventPtr<TypeId, std::vector<EntityId>> const& bulkEvent = nullptr) {
     addEvent_ = addEvent;
     removeEvent_ = removeEvent;
+    changeEvent_ = changeEvent;
+    bulkEvent_ = bulkEvent;
+  }
+
+#ifdef CRYSTAL_ENTITY_PROFILING
+  void SetProfiler(std::shared_ptr<Profiler> const& profiler) {
+    profiler_ = profiler;
   }
+#endif
 
   template <typename ComponentType>
   inline static TypeId GetTypeId() {
     return typeid(ComponentType).hash_code();
   }
 
+  template <typename ComponentType>
+  inline static constexpr bool IsTag = std::is_empty_v<ComponentType>;
+
   bool PoolExists(TypeId typeId) const {
+    auto lock = LockPoolsShared();
     return componentPools_.contains(typeId);
   }
 
   template <typename ComponentType>
   Handle Create(EntityId const entityId, ComponentType&& data,
                 bool const isEnabled = true) {
+    return Emplace<ComponentType>(entityId, isEnabled,
+                                  std::forward<ComponentType>(data));
+  }
+
+  // Constructs the component from args directly in its pool slot. An existing
+  // component of the type is removed, as with Create
+  template <typename ComponentType, typename... Args>
+  Handle Emplace(EntityId const entityId, bool const isEnabled,
+                 Args&&... args) {
+    Handle handle{GetTypeId<ComponentType>(), {~0}};
+    WriteScope write(*this);
+    if (!write) return handle;
+
     Mappings& mappings = GetOrCreateMappings<ComponentType>();
-    auto dataId = mappings.GetPool<ComponentType>()->Add(
-        std::forward<ComponentType>(data));
+    Handle replaced{handle.Type, {~0}};
+    if constexpr (IsTag<ComponentType>) {
+      auto lock = LockPool(mappings);
+      mappings.Tags->Set(entityId, isEnabled);
+      handle.Data = entityId;
+    } else {
+      auto lock = LockPool(mappings);
+      auto& pool = *mappings.GetPool<ComponentType>();
+      handle.Data = pool.Emplace(std::forward<Args>(args)...);
+      Bind<ComponentType>(mappings, handle.Data);
 
-    // TODO: need to check DisabledEntityMap
-    if (mappings.EntityMap.Contains(entityId, false)) {
-      Remove({GetTypeId<ComponentType>(),
-              mappings.EntityMap.GetData(entityId, false)});
-    }
+      if (mappings.EntityMap.Contains(entityId, false)) {
+        replaced.Data = mappings.EntityMap.GetData(entityId, false);
+        RemoveData(mappings, replaced.Data);
+      } else if (!cold_.Empty()) {
+        replaced.Data = cold_.Drop(entityId, handle.Type);
+      }
 
-    mappings.EntityMap.Set(entityId, dataId, isEnabled);
+      mappings.EntityMap.Set(entityId, handle.Data, isEnabled);
+      if constexpr (SoaComponent<ComponentType>) {
+        pool.SetEntity(handle.Data, entityId);
+        pool.SetIsEnabled(handle.Data, isEnabled);
+      }
+      MarkChanged(mappings);
+    }
 
-    Handle handle{GetTypeId<ComponentType>(), dataId};
+    if (replaced.IsValid()) NotifyRemove(entityId, replaced);
     if (addEvent_) addEvent_->Notify(entityId, handle);
+    CRYSTAL_PROFILE_COUNT(profiler_, ComponentCreated, 1);
+    CRYSTAL_PROFILE_COUNT(profiler_, EventNotified, 1);
+
+    return handle;
+  }
+
+  // Copies value to every entity with one pool lookup and lock, sending one
+  // ChangeComponents event instead of an add event per entity. An existing
+  // component of the type is removed, with its remove event, as with Emplace.
+  // Returns a handle per entity, or none if rejected because a read phase is
+  // active
+  template <typename ComponentType>
+  std::vector<Handle> CreateMany(std::vector<EntityId> const& entityIds,
+                                 ComponentType const& value,
+                                 bool const isEnabled = true) {
+    WriteScope write(*this);
+    return CreateMany(write, entityIds, value, isEnabled);
+  }
+
+  // As CreateMany, under a scope the caller holds on this manager so a larger
+  // change can't be rejected half way through
+  template <typename ComponentType>
+  std::vector<Handle> CreateMany(WriteScope const& write,
+                                 std::vector<EntityId> const& entityIds,
+                                 ComponentType const& value,
+                                 bool const isEnabled = true) {
+    return CreateManyWith<ComponentType>(
+        write, entityIds, isEnabled,
+        [&](std::size_t) -> ComponentType const& { return value; });
+  }
+
+  // As CreateMany but with a value per entity, moved into the pool
+  template <typename ComponentType>
+  std::vector<Handle> InsertMany(std::vector<EntityId> const& entityIds,
+                                 std::vector<ComponentType>&& values,
+                                 bool const isEnabled = true) {
+    WriteScope write(*this);
+    return InsertMany(write, entityIds, std::move(values), isEnabled);
+  }
+
+  template <typename ComponentType>
+  std::vector<Handle> InsertMany(WriteScope const& write,
+                                 std::vector<EntityId> const& entityIds,
+                                 std::vector<ComponentType>&& values,
+                                 bool const isEnabled = true) {
+    assert(values.size() == entityIds.size());
+    return CreateManyWith<ComponentType>(
+        write, entityIds, isEnabled,
+        [&](std::size_t const index) -> ComponentType&& {
+          return std::move(values[index]);
+        });
+  }
+
+  // Overwrites the entity's component in place, keeping its slot and handle,
+  // and sends one ChangeComponent event instead of a remove and an add.
+  // Returns an invalid handle if the entity doesn't have the component or a
+  // read phase is active
+  template <typename ComponentType, typename... Args>
+  Handle Replace(EntityId const entityId, Args&&... args) {
+    Handle handle{GetTypeId<ComponentType>(), {~0}};
+    WriteScope write(*this);
+    if (!write || !PoolExists(handle.Type)) return handle;
+
+    auto& mappings = GetMappings(handle.Type);
+    {
+      auto lock = LockPool(mappings);
+      if constexpr (IsTag<ComponentType>) {
+        if (!mappings.Tags->Contains(entityId, false)) return handle;
+        handle.Data = entityId;
+      } else {
+        if (!mappings.EntityMap.Contains(entityId, false)) return handle;
+        handle.Data = mappings.EntityMap.GetData(entityId, false);
+        Overwrite<ComponentType>(mappings, handle.Data,
+                                 std::forward<Args>(args)...);
+      }
+    }
 
+    if (changeEvent_) changeEvent_->Notify(entityId, handle);
+    CRYSTAL_PROFILE_COUNT(profiler_, EventNotified, 1);
     return handle;
   }
 
   template <typename ComponentType>
-  std::weak_ptr<ComponentType> Get(Handle const& handle) {
+  std::weak_ptr<ComponentAccess<ComponentType>> Get(Handle const& handle) {
+    static_assert(!SoaComponent<ComponentType>,
+                  "SoA components are accessed through GetFields");
     assert(GetTypeId<ComponentType>() == handle.Type &&
            PoolExists(handle.Type));
 
     auto& mappings = GetMappings(handle.Type);
-    return mappings.GetPool<ComponentType>()->Get(handle.Data);
+    auto lock = LockPool(mappings);
+    if constexpr (IsTag<ComponentType>) {
+      if (mappings.Tags->Contains(static_cast<EntityId>(handle.Data), false)) {
+        return GetTagInstance<ComponentType>();
+      }
+      return {};
+    } else {
+      return mappings.GetPool<ComponentType>()->Get(handle.Data);
+    }
   }
 
   template <typename ComponentType>
-  std::weak_ptr<ComponentType> GetByEntity(EntityId const entityId,
-                                           bool const ignoreDisabled = true) {
+  std::weak_ptr<ComponentAccess<ComponentType>> GetByEntity(
+      EntityId const entityId, bool const ignoreDisabled = true) {
+    static_assert(!SoaComponent<ComponentType>,
+                  "SoA components are accessed through GetFields");
     if (PoolExists(GetTypeId<ComponentType>())) {
       Mappings& mappings = GetMappings<ComponentType>();
-      if (mappings.EntityMap.Contains(entityId, ignoreDisabled)) {
+      auto lock = LockPool(mappings);
+      if constexpr (IsTag<ComponentType>) {
+        if (mappings.Tags->Contains(entityId, ignoreDisabled)) {
+          return GetTagInstance<ComponentType>();
+        }
+      } else if (mappings.EntityMap.Contains(entityId, ignoreDisabled)) {
         auto dataId = mappings.EntityMap.GetData(entityId, ignoreDisabled);
         return mappings.GetPool<ComponentType>()->Get(dataId);
       }
@@ -188,39 +477,936 @@ class ComponentManager {
     return {};
   }
 
-  void Remove(Handle const& handle) {
-    if (PoolExists(handle.Type)) {
-      auto& mappings = componentPools_.at(handle.Type);
-      auto entityId = mappings.EntityMap.GetEntity(handle.Data, false);
+  // Each of a list of entities' data ids in one pool, as of a revision of its
+  // mappings. Lets callers that walk the same entities every tick (see
+  // Manager::ForEachInHierarchy) skip the per-entity lookups until the pool's
+  // membership changes
+  struct EntitySlots {
+    uint64_t Revision = 0;
+    bool IgnoreDisabled = true;
+    std::vector<DataId> DataIds;
+  };
+
+  // GetByEntity for each entity in turn under one lock, null where an entity
+  // doesn't have the component. slots is refreshed first if it's empty or
+  // stale, and must only be passed back with the same entities
+  template <typename ComponentType>
+  std::vector<std::shared_ptr<ComponentAccess<ComponentType>>> GetByEntities(
+      std::vector<EntityId> const& entityIds,
+      std::shared_ptr<EntitySlots const>& slots,
+      bool const ignoreDisabled = true) {
+    static_assert(!SoaComponent<ComponentType>,
+                  "SoA components are accessed through GetFields");
+    std::vector<std::shared_ptr<ComponentAccess<ComponentType>>> components(
+        entityIds.size());
+    if (!PoolExists(GetTypeId<ComponentType>())) return components;
+
+    Mappings& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    if constexpr (IsTag<ComponentType>) {
+      for (std::size_t i = 0; i < entityIds.size(); ++i) {
+        if (mappings.Tags->Contains(entityIds[i], ignoreDisabled)) {
+          components[i] = GetTagInstance<ComponentType>();
+        }
+      }
+    } else {
+      auto const revision = mappings.EntityMap.GetRevision();
+      if (!slots || slots->Revision != revision ||
+          slots->IgnoreDisabled != ignoreDisabled ||
+          slots->DataIds.size() != entityIds.size()) {
+        auto fresh = std::make_shared<EntitySlots>();
+        fresh->Revision = revision;
+        fresh->IgnoreDisabled = ignoreDisabled;
+        fresh->DataIds.reserve(entityIds.size());
+        for (auto const entityId : entityIds) {
+          fresh->DataIds.push_back(
+              mappings.EntityMap.GetData(entityId, ignoreDisabled));
+        }
+        slots = std::move(fresh);
+      }
+
+      auto const pool = mappings.GetPool<ComponentType>();
+      for (std::size_t i = 0; i < entityIds.size(); ++i) {
+        components[i] = pool->Get(slots->DataIds[i]).lock();
+      }
+    }
+    return components;
+  }
+
+  // Lock-free lookup for use inside a read phase
+  template <typename ComponentType>
+  ComponentType const* Find(EntityId const entityId,
+                            bool const ignoreDisabled = true) const {
+    static_assert(!SoaComponent<ComponentType>,
+                  "SoA components are accessed through GetFields");
+    assert(InReadPhase());
+    if (auto const* mappings =
+            FindMappings(GetTypeId<ComponentType>(), true)) {
+      if constexpr (IsTag<ComponentType>) {
+        if (mappings->Tags->Contains(entityId, ignoreDisabled)) {
+          return GetTagInstance<ComponentType>().get();
+        }
+      } else if (mappings->EntityMap.Contains(entityId, ignoreDisabled)) {
+        auto dataId = mappings->EntityMap.GetData(entityId, ignoreDisabled);
+        return mappings->template GetPool<ComponentType>()->Find(dataId);
+      }
+    }
+    return nullptr;
+  }
 
-      mappings.ComponentPool->Remove(handle.Data);
-      mappings.EntityMap.Remove(handle.Data);
+  // Returns false if rejected because a read phase is active
+  bool Remove(Handle const& handle) {
+    WriteScope write(*this);
+    if (!write) return false;
 
-      if (removeEvent_) removeEvent_->Notify(entityId, handle);
+    if (PoolExists(handle.Type)) {
+      auto& mappings = GetMappings(handle.Type);
+      EntityId entityId;
+      {
+        auto lock = LockPool(mappings);
+        entityId = RemoveLocked(mappings, handle);
+      }
+      NotifyRemove(entityId, handle);
     }
     // TODO: log in else that pool doesn't exist
+    return true;
+  }
+
+  // Removes components locking each pool once, sending one ChangeComponents
+  // event per type instead of remove events. Returns false if rejected
+  // because a read phase is active
+  bool RemoveMany(std::vector<Handle> handles) {
+    WriteScope write(*this);
+    return RemoveMany(write, std::move(handles));
+  }
+
+  // As RemoveMany, under a scope the caller holds on this manager
+  bool RemoveMany(WriteScope const& write, std::vector<Handle> handles) {
+    if (!write) return false;
+
+    std::sort(handles.begin(), handles.end(),
+              [](Handle const& lhs, Handle const& rhs) {
+                return lhs.Type < rhs.Type;
+              });
+    for (auto it = handles.begin(); it != handles.end();) {
+      auto const type = it->Type;
+      auto const end = std::find_if(
+          it, handles.end(), [&](Handle const& h) { return h.Type != type; });
+      if (PoolExists(type)) {
+        std::vector<EntityId> entityIds;
+        entityIds.reserve(end - it);
+        {
+          auto& mappings = GetMappings(type);
+          auto lock = LockPool(mappings);
+          for (; it != end; ++it) {
+            entityIds.push_back(RemoveLocked(mappings, *it));
+          }
+        }
+        NotifyMany(type, entityIds);
+      }
+      it = end;
+    }
+    CRYSTAL_PROFILE_COUNT(profiler_, ComponentRemoved, handles.size());
+    return true;
+  }
+
+  // Returns false if rejected because a read phase is active
+  bool SetEntityEnabled(EntityId const entityId, bool const isEnabled) {
+    WriteScope write(*this);
+    return SetEntityEnabled(write, entityId, isEnabled);
   }
 
-  void SetEntityEnabled(EntityId const entityId, bool const isEnabled) {
+  // As SetEntityEnabled, under a scope the caller holds on this manager
+  bool SetEntityEnabled(WriteScope const& write, EntityId const entityId,
+                        bool const isEnabled) {
+    if (!write) return false;
+
+    auto poolsLock = LockPoolsShared();
+    // Types moved in or out of cold storage, which send no other events
+    std::vector<TypeId> moved;
+    if (isEnabled && !cold_.Empty()) moved = Thaw(entityId);
+
+    ColdStore::Frozen frozen;
     // TODO: have to if every iteration, maybe improve
-    for (auto& [_, pool] : componentPools_) {
-      pool.EntityMap.SetIsEnabled(entityId, isEnabled);
+    for (auto& [typeId, pool] : componentPools_) {
+      auto lock = LockPool(pool);
+      if (pool.Tags) {
+        pool.Tags->SetIsEnabled(entityId, isEnabled);
+      } else {
+        if (pool.EntityMap.Contains(entityId, false)) {
+          auto const dataId = pool.EntityMap.GetData(entityId, false);
+          pool.ComponentPool->SetIsEnabled(dataId, isEnabled);
+          if (!isEnabled && coldStorage_ &&
+              pool.ComponentPool->Freeze(dataId, frozen.Bytes)) {
+            frozen.Records.push_back(
+                {typeId, dataId, pool.ComponentPool->FrozenSize()});
+            RemoveData(pool, dataId);
+            moved.push_back(typeId);
+          }
+        }
+        pool.EntityMap.SetIsEnabled(entityId, isEnabled);
+        MarkChanged(pool);
+      }
+    }
+    if (!frozen.Records.empty()) cold_.Add(entityId, std::move(frozen));
+    if (poolsLock) poolsLock.unlock();
+    for (auto const typeId : moved) NotifyMany(typeId, {entityId});
+    return true;
+  }
+
+  // With cold storage on, disabling an entity moves its trivially copyable
+  // components out of their pools into a compressed store, and enabling it
+  // moves them back under the same handles. Frozen components can't be
+  // fetched until then. Turning it off leaves frozen entities where they are
+  void SetColdStorage(bool const enabled) { coldStorage_ = enabled; }
+
+  bool IsFrozen(EntityId const entityId) const {
+    return !cold_.Empty() && cold_.Contains(entityId);
+  }
+
+  // Moves a frozen entity's components back into their pools, still
+  // disabled, e.g. to copy them out. Disabling the entity again freezes them.
+  // Returns false if rejected because a read phase is active
+  bool Unfreeze(WriteScope const& write, EntityId const entityId) {
+    if (!write) return false;
+    if (!IsFrozen(entityId)) return true;
+
+    std::vector<TypeId> moved;
+    {
+      auto poolsLock = LockPoolsShared();
+      moved = Thaw(entityId);
+    }
+    for (auto const typeId : moved) NotifyMany(typeId, {entityId});
+    return true;
+  }
+
+  // Compressed size of all frozen components
+  std::size_t ColdStorageBytes() const { return cold_.Bytes(); }
+
+  // Flips every Buffered component so the values written this tick are read
+  // next tick
+  void SwapBuffers() {
+    auto lock = LockPoolsShared();
+    for (auto* epoch : bufferedEpochs_) ++*epoch;
+  }
+
+  // Packs every pool. Handles stay valid but weak_ptrs handed out before the
+  // call expire, so re-fetch components afterwards. Components locked during
+  // the call stay where they are until a later Compact. Sharded managers
+  // can't rule out another thread locking a weak_ptr mid-move, so there only
+  // the slots are packed and weak_ptrs stay valid
+  void Compact() {
+    WriteScope write(*this);
+    if (!write) return;
+
+    auto poolsLock = LockPoolsShared();
+    for (auto& [_, mappings] : componentPools_) {
+      auto lock = LockPool(mappings);
+      if (mappings.ComponentPool) {
+        mappings.ComponentPool->Compact({}, RelocatesOnCompact());
+      }
+      MarkChanged(mappings);
+    }
+  }
+
+  template <typename ComponentType>
+  void Compact(CompactOrder const order = CompactOrder::Insertion) {
+    WriteScope write(*this);
+    if (IsTag<ComponentType> || !write ||
+        !PoolExists(GetTypeId<ComponentType>())) {
+      return;
+    }
+
+    auto& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    std::vector<DataId> dataOrder;
+    if (order == CompactOrder::EntityId) {
+      auto entityMappings = mappings.EntityMap.GetAllMappings();
+      std::sort(entityMappings.begin(), entityMappings.end());
+      for (auto const& [_, dataId] : entityMappings) {
+        dataOrder.push_back(dataId);
+      }
+    }
+    mappings.ComponentPool->Compact(dataOrder, RelocatesOnCompact());
+    MarkChanged(mappings);
+  }
+
+  // Packs the pool ordered by compare(lhs, rhs) over component values
+  template <typename ComponentType, typename Compare>
+  void CompactSorted(Compare compare) {
+    static_assert(!IsTag<ComponentType> && !SharedComponent<ComponentType>);
+    WriteScope write(*this);
+    if (!write || !PoolExists(GetTypeId<ComponentType>())) return;
+
+    auto& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    auto pool = mappings.template GetPool<ComponentType>();
+    std::vector<std::pair<DataId, ComponentType const*>> components;
+    components.reserve(pool->Size());
+    pool->ForEach([&](DataId const dataId, ComponentType const& component) {
+      components.push_back({dataId, &component});
+    });
+    std::stable_sort(components.begin(), components.end(),
+                     [&](auto const& lhs, auto const& rhs) {
+                       return compare(*lhs.second, *rhs.second);
+                     });
+
+    std::vector<DataId> dataOrder;
+    dataOrder.reserve(components.size());
+    for (auto const& [dataId, _] : components) {
+      dataOrder.push_back(dataId);
+    }
+    pool->Compact(dataOrder, RelocatesOnCompact());
+    MarkChanged(mappings);
+  }
+
+  // Fills pool holes, moving at most budget components in total. Cheap enough
+  // to run every tick and leaves weak_ptrs valid. Returns components moved
+  std::size_t CompactIncremental(std::size_t const budget) {
+    WriteScope write(*this);
+    if (!write) return 0;
+
+    auto poolsLock = LockPoolsShared();
+    std::size_t moved = 0;
+    for (auto& [_, mappings] : componentPools_) {
+      if (moved == budget) break;
+      auto lock = LockPool(mappings);
+      if (mappings.ComponentPool && mappings.ComponentPool->HasHoles()) {
+        moved += mappings.ComponentPool->CompactStep(budget - moved);
+        MarkChanged(mappings);
+      }
+    }
+    return moved;
+  }
+
+  // Keeps the pool sorted by compare(lhs, rhs) over component values. The
+  // pool is sorted now and re-sorted by SortIncremental, which is cheap while
+  // values only drift a little between calls. Queries driven by a sorted pool
+  // visit entities in its order
+  template <typename ComponentType, typename Compare>
+  void SetSortOrder(Compare compare) {
+    static_assert(!IsTag<ComponentType> && !SharedComponent<ComponentType>);
+    WriteScope write(*this);
+    if (!write) return;
+
+    auto& mappings = GetOrCreateMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    mappings.Sort = [pool = mappings.template GetPool<ComponentType>(),
+                     compare] { return pool->Sort(compare); };
+    if (mappings.Sort() > 0) MarkChanged(mappings);
+  }
+
+  // Insertion sorts every pool with a sort order. Returns components shifted
+  std::size_t SortIncremental() {
+    WriteScope write(*this);
+    if (!write) return 0;
+
+    auto poolsLock = LockPoolsShared();
+    std::size_t shifts = 0;
+    for (auto& [_, mappings] : componentPools_) {
+      auto lock = LockPool(mappings);
+      if (mappings.Sort) {
+        auto const poolShifts = mappings.Sort();
+        if (poolShifts > 0) MarkChanged(mappings);
+        shifts += poolShifts;
+      }
+    }
+    return shifts;
+  }
+
+  // Owns the pools of every listed type so entities with all of them sit at
+  // the front of each pool in the same slots, in the first type's order.
+  // ForEachGroup is then a lockstep walk. A type can only be in one group.
+  // Returns false if a type is already owned or in a read phase
+  template <typename... ComponentTypes>
+  bool AddGroup() {
+    static_assert(sizeof...(ComponentTypes) > 1);
+    static_assert(!(IsTag<ComponentTypes> || ...));
+    static_assert(!(SharedComponent<ComponentTypes> || ...),
+                  "Shared components have no slots to arrange");
+    WriteScope write(*this);
+    if (!write) return false;
+
+    std::array<Mappings*, sizeof...(ComponentTypes)> owned{
+        &GetOrCreateMappings<ComponentTypes>()...};
+    for (auto* mappings : owned) {
+      auto lock = LockPool(*mappings);
+      if (mappings->Owner) return false;
+    }
+
+    auto group = std::make_shared<Group>();
+    group->Types = owned.size();
+    for (auto* mappings : owned) {
+      auto lock = LockPool(*mappings);
+      mappings->Owner = group;
+    }
+    return true;
+  }
+
+  template <typename... ComponentTypes>
+  bool HasGroup() const {
+    if (!(PoolExists(GetTypeId<ComponentTypes>()) && ...)) return false;
+
+    std::array<std::shared_ptr<Group>, sizeof...(ComponentTypes)> owners{
+        GetOwner(GetMappings<ComponentTypes>())...};
+    return owners[0] && owners[0]->Types == owners.size() &&
+           std::all_of(owners.begin(), owners.end(),
+                       [&](auto const& owner) { return owner == owners[0]; });
+  }
+
+  // Calls func(EntityId, std::shared_ptr<ComponentTypes>...) for enabled
+  // entities in the group, repacking it first if its pools changed. Returns
+  // false, without calling func, if the types aren't exactly a group or the
+  // group needs repacking during a read phase. Other threads must not change
+  // the owned pools while this runs
+  template <typename... ComponentTypes, typename Func>
+  bool ForEachGroup(Func&& func) {
+    if (!HasGroup<ComponentTypes...>()) return false;
+
+    using First = std::tuple_element_t<0, std::tuple<ComponentTypes...>>;
+    auto group = GetOwner(GetMappings<First>());
+    if (group->Dirty) {
+      WriteScope write(*this);
+      if (!write) return false;
+      RepackGroup<ComponentTypes...>(*group);
+    }
+
+    auto pools = std::make_tuple(
+        GetMappings<ComponentTypes>().template GetPool<ComponentTypes>()...);
+    for (std::size_t slot = 0; slot < group->Entities.size(); ++slot) {
+      // Components removed by earlier callbacks leave holes
+      auto components = std::apply(
+          [&](auto const&... pool) {
+            return std::make_tuple(pool->At(slot)...);
+          },
+          pools);
+      if (std::apply([](auto const&... c) { return (c && ...); }, components)) {
+        std::apply(
+            [&](auto&&... c) { func(group->Entities[slot], std::move(c)...); },
+            components);
+      }
+    }
+    return true;
+  }
+
+  PoolStats GetPoolStats(TypeId const typeId) const {
+    if (PoolExists(typeId)) {
+      auto const& mappings = GetMappings(typeId);
+      auto lock = LockPool(mappings);
+      if (mappings.Tags) {
+        return {mappings.Tags->Size(), mappings.Tags->Size()};
+      }
+      return {mappings.ComponentPool->Size(),
+              mappings.ComponentPool->Capacity()};
     }
+    return {0, 0};
   }
 
   template <typename... Args>
   std::unordered_set<EntityId> GetEntitiesWithSharedComponents(
       bool const ignoreDisabled = true) const {
-    return SetIntersection(GetComponentEntities<Args>(ignoreDisabled)...);
+    auto entities = Query<Args...>(ignoreDisabled);
+    return {entities.begin(), entities.end()};
+  }
+
+  // Entities matching every term (see query.hpp). The required term with the
+  // fewest entities is scanned and every other term is a membership bit test,
+  // so excluded entities are never fetched
+  template <typename... Terms>
+  std::vector<EntityId> Query(bool const ignoreDisabled = true) const {
+    return QueryEntities<Terms...>(ignoreDisabled, false);
+  }
+
+  // Lock-free Query for use inside a read phase
+  template <typename... Terms>
+  std::vector<EntityId> ReadQuery(bool const ignoreDisabled = true) const {
+    assert(InReadPhase());
+    return QueryEntities<Terms...>(ignoreDisabled, true);
+  }
+
+  // Drops the entities that don't match every term, e.g. candidates from a
+  // spatial lookup
+  template <typename... Terms>
+  void Filter(std::vector<EntityId>& entities,
+              bool const ignoreDisabled = true) const {
+    (FilterEntities<Terms>(entities, 0, ignoreDisabled, false), ...);
+  }
+
+  // Calls func(EntityId, ComponentType const&) in slot order with the pool
+  // locked, so func must not change components of this type
+  template <typename ComponentType, typename Func>
+  void ForEachComponent(Func&& func, bool const ignoreDisabled = true) const {
+    static_assert(!IsTag<ComponentType>);
+    if (!PoolExists(GetTypeId<ComponentType>())) return;
+
+    auto const& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    mappings.template GetPool<ComponentType>()->ForEach(
+        [&](DataId const dataId, ComponentType const& component) {
+          auto const entityId =
+              mappings.EntityMap.GetEntity(dataId, ignoreDisabled);
+          if (entityId != EntityId{~0}) func(entityId, component);
+        });
+  }
+
+  // Proxy for an entity's SoA component, false if it doesn't have one
+  template <SoaComponent ComponentType>
+  SoaRef<ComponentType> GetFields(EntityId const entityId,
+                                  bool const ignoreDisabled = true) {
+    if (!PoolExists(GetTypeId<ComponentType>())) return {};
+
+    auto& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    if (!mappings.EntityMap.Contains(entityId, ignoreDisabled)) return {};
+    return mappings.template GetPool<ComponentType>()->Get(
+        mappings.EntityMap.GetData(entityId, ignoreDisabled));
+  }
+
+  // Calls func(EntityId, SoaRef<ComponentType>) for every component in slot
+  // order with the pool locked, so func must not add or remove components of
+  // this type
+  template <SoaComponent ComponentType, typename Func>
+  void ForEachSoa(Func&& func, bool const ignoreDisabled = true) {
+    if (!PoolExists(GetTypeId<ComponentType>())) return;
+
+    auto& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    auto& pool = *mappings.template GetPool<ComponentType>();
+    auto const count = ignoreDisabled ? pool.EnabledSize() : pool.Size();
+    auto const entities = pool.Entities(count);
+    for (std::size_t slot = 0; slot < count; ++slot) {
+      func(entities[slot], SoaRef<ComponentType>{&pool, slot});
+    }
+  }
+
+  // Calls func(std::span<EntityId const>, std::span<Field>...) once with the
+  // listed fields of every component as parallel arrays, with the pool locked
+  template <SoaComponent ComponentType, auto... Members, typename Func>
+  void ForEachFields(Func&& func, bool const ignoreDisabled = true) {
+    if (!PoolExists(GetTypeId<ComponentType>())) return;
+
+    auto& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    auto& pool = *mappings.template GetPool<ComponentType>();
+    auto const count = ignoreDisabled ? pool.EnabledSize() : pool.Size();
+    func(pool.Entities(count), pool.template Span<Members>(count)...);
+  }
+
+  // Calls func(ComponentType const&, std::span<EntityId const>) once per
+  // distinct value of a shared component, with every entity holding it, so
+  // work on the value can be hoisted out of the loop over entities. The pool
+  // is locked throughout
+  template <SharedComponent ComponentType, typename Func>
+  void ForEachShared(Func&& func, bool const ignoreDisabled = true) const {
+    if (!PoolExists(GetTypeId<ComponentType>())) return;
+
+    auto const& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    std::vector<EntityId> entities;
+    mappings.template GetPool<ComponentType>()->ForEachValue(
+        [&](ComponentType const& value, std::span<DataId const> dataIds) {
+          entities.clear();
+          for (auto const dataId : dataIds) {
+            auto const entityId =
+                mappings.EntityMap.GetEntity(dataId, ignoreDisabled);
+            if (entityId != EntityId{~0}) entities.push_back(entityId);
+          }
+          if (!entities.empty()) {
+            func(value, std::span<EntityId const>(entities));
+          }
+        });
+  }
+
+  // Number of distinct values stored for a shared component
+  template <SharedComponent ComponentType>
+  std::size_t CountSharedValues() const {
+    if (!PoolExists(GetTypeId<ComponentType>())) return 0;
+
+    auto const& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    return mappings.template GetPool<ComponentType>()->Distinct();
+  }
+
+  // Calls func(EntityId, ComponentType const&) for the entities in
+  // [begin, end) that have the component, in id order with the pool locked
+  template <typename ComponentType, typename Func>
+  void ForEachInRange(EntityId const begin, EntityId const end, Func&& func,
+                      bool const ignoreDisabled = true) const {
+    if (!PoolExists(GetTypeId<ComponentType>())) return;
+
+    auto const& mappings = GetMappings<ComponentType>();
+    auto lock = LockPool(mappings);
+    for (auto entityId = begin; entityId < end; ++entityId) {
+      if constexpr (IsTag<ComponentType>) {
+        if (mappings.Tags->Contains(entityId, ignoreDisabled)) {
+          func(entityId, *GetTagInstance<ComponentType>());
+        }
+      } else if (mappings.EntityMap.Contains(entityId, ignoreDisabled)) {
+        auto const dataId =
+            mappings.EntityMap.GetData(entityId, ignoreDisabled);
+        func(entityId, *mappings.template GetPool<ComponentType>()->Find(
+                           dataId));
+      }
+    }
   }
 
  protected:
-  // TODO: probably a more efficient way of doing this
+  // Pool locks are skipped when inReadPhase, see ReadQuery
+  template <typename... Terms>
+  std::vector<EntityId> QueryEntities(bool const ignoreDisabled,
+                                      bool const inReadPhase) const {
+    static_assert(HasRequiredTerm<Terms...>,
+                  "Query needs at least one required component");
+
+    using ListFunc =
+        std::vector<EntityId> (ComponentManager::*)(bool, bool) const;
+    ListFunc list = nullptr;
+    TypeId driver = 0;
+    auto smallest = ~std::size_t{0};
+    auto pickDriver = [&]<typename Term>() {
+      using ComponentType = typename QueryTerm<Term>::Component;
+      if constexpr (QueryTerm<Term>::Required) {
+        // A sorted pool always drives so its order is kept
+        auto const count = IsSorted<ComponentType>(inReadPhase)
+                               ? 0
+                               : CountEntities<ComponentType>(ignoreDisabled,
+                                                              inReadPhase);
+        if (count < smallest) {
+          smallest = count;
+          list = &ComponentManager::ListEntities<ComponentType>;
+          driver = GetTypeId<ComponentType>();
+        }
+      }
+    };
+    (pickDriver.template operator()<Terms>(), ...);
+
+    auto entities = (this->*list)(ignoreDisabled, inReadPhase);
+    (FilterEntities<Terms>(entities, driver, ignoreDisabled, inReadPhase),
+     ...);
+    return entities;
+  }
+
   template <typename ComponentType>
-  std::unordered_set<EntityId> GetComponentEntities(
-      bool const ignoreDisabled) const {
-    auto const& mappings = GetMappings<ComponentType>();
-    return mappings.EntityMap.GetAllEntities(ignoreDisabled);
+  bool IsMember(Mappings const& mappings, EntityId const entityId,
+                bool const ignoreDisabled) const {
+    if constexpr (IsTag<ComponentType>) {
+      return mappings.Tags->Contains(entityId, ignoreDisabled);
+    } else {
+      return mappings.EntityMap.Contains(entityId, ignoreDisabled);
+    }
+  }
+
+  template <typename ComponentType>
+  std::size_t CountEntities(bool const ignoreDisabled,
+                            bool const inReadPhase) const {
+    auto const* found = FindMappings(GetTypeId<ComponentType>(), inReadPhase);
+    if (!found) return 0;
+
+    auto const& mappings = *found;
+    auto lock = LockPool(mappings, inReadPhase);
+    if constexpr (IsTag<ComponentType>) {
+      // Tags don't track disabled counts separately, so this may over count
+      return mappings.Tags->Size();
+    } else {
+      return mappings.EntityMap.Size(ignoreDisabled);
+    }
+  }
+
+  template <typename ComponentType>
+  std::vector<EntityId> ListEntities(bool const ignoreDisabled,
+                                     bool const inReadPhase) const {
+    auto const* found = FindMappings(GetTypeId<ComponentType>(), inReadPhase);
+    if (!found) return {};
+
+    auto const& mappings = *found;
+    auto lock = LockPool(mappings, inReadPhase);
+    std::vector<EntityId> entities;
+    auto add = [&](EntityId const entityId) { entities.push_back(entityId); };
+    if constexpr (IsTag<ComponentType>) {
+      mappings.Tags->ForEach(add, ignoreDisabled);
+    } else {
+      // SoA pools are never sorted
+      if constexpr (!SoaComponent<ComponentType>) {
+        if (mappings.Sort) {
+          mappings.template GetPool<ComponentType>()->ForEach(
+              [&](DataId const dataId, ComponentType const&) {
+                auto const entityId =
+                    mappings.EntityMap.GetEntity(dataId, ignoreDisabled);
+                if (entityId != EntityId{~0}) add(entityId);
+              });
+          return entities;
+        }
+      }
+      mappings.EntityMap.ForEachEntity(add, ignoreDisabled);
+    }
+    return entities;
+  }
+
+  template <typename Term>
+  void FilterEntities(std::vector<EntityId>& entities, TypeId const driver,
+                      bool const ignoreDisabled,
+                      bool const inReadPhase) const {
+    using ComponentType = typename QueryTerm<Term>::Component;
+    constexpr bool keepMembers = QueryTerm<Term>::Required;
+    if constexpr (QueryTerm<Term>::Required || QueryTerm<Term>::Excluded) {
+      auto const typeId = GetTypeId<ComponentType>();
+      if (keepMembers && typeId == driver) return;
+      auto const* found = FindMappings(typeId, inReadPhase);
+      if (!found) {
+        if (keepMembers) entities.clear();
+        return;
+      }
+
+      auto const& mappings = *found;
+      auto lock = LockPool(mappings, inReadPhase);
+      std::erase_if(entities, [&](EntityId const entityId) {
+        return IsMember<ComponentType>(mappings, entityId, ignoreDisabled) !=
+               keepMembers;
+      });
+    }
+  }
+
+  using PoolLock = std::unique_lock<std::mutex>;
+
+  // Moving a component is only safe if no other thread can lock a weak_ptr
+  // to it meanwhile, see ComponentPoolBase::Compact
+  bool RelocatesOnCompact() const {
+    return concurrency_ != Concurrency::Sharded;
+  }
+
+  // Lookups made through a read phase pass inReadPhase, as nothing can change
+  // until it ends. Any other caller, writers above all, always locks: a
+  // change let through before the phase began may still be in flight
+  PoolLock LockPool(Mappings const& mappings,
+                    bool const inReadPhase = false) const {
+    if (concurrency_ == Concurrency::Sharded && !inReadPhase) {
+      return PoolLock{mappings.Mutex};
+    }
+    return {};
+  }
+
+  // Pools are never erased and map nodes are stable, so the map lock is only
+  // needed while looking up or inserting a pool
+  std::shared_lock<std::shared_mutex> LockPoolsShared(
+      bool const inReadPhase = false) const {
+    if (concurrency_ == Concurrency::Sharded && !inReadPhase) {
+      return std::shared_lock{poolsMutex_};
+    }
+    return {};
+  }
+
+  Mappings const* FindMappings(TypeId const typeId,
+                               bool const inReadPhase) const {
+    auto lock = LockPoolsShared(inReadPhase);
+    auto it = componentPools_.find(typeId);
+    return it != componentPools_.end() ? &it->second : nullptr;
+  }
+
+  // Expects valueAt(index into entityIds) to return the entity's value
+  template <typename ComponentType, typename ValueAt>
+  std::vector<Handle> CreateManyWith(WriteScope const& write,
+                                     std::vector<EntityId> const& entityIds,
+                                     bool const isEnabled,
+                                     ValueAt&& valueAt) {
+    std::vector<Handle> handles;
+    if (!write) return handles;
+
+    auto const typeId = GetTypeId<ComponentType>();
+    handles.reserve(entityIds.size());
+    std::vector<std::pair<EntityId, Handle>> replaced;
+    Mappings& mappings = GetOrCreateMappings<ComponentType>();
+    {
+      auto lock = LockPool(mappings);
+      if constexpr (IsTag<ComponentType>) {
+        for (auto const entityId : entityIds) {
+          mappings.Tags->Set(entityId, isEnabled);
+          handles.push_back({typeId, entityId});
+        }
+      } else {
+        auto& pool = *mappings.GetPool<ComponentType>();
+        pool.Reserve(entityIds.size());
+        mappings.EntityMap.Reserve(entityIds.size());
+        for (std::size_t index = 0; index < entityIds.size(); ++index) {
+          auto const entityId = entityIds[index];
+          auto const dataId = pool.Emplace(valueAt(index));
+          Bind<ComponentType>(mappings, dataId);
+          if (mappings.EntityMap.Contains(entityId, false)) {
+            Handle const old{typeId,
+                             mappings.EntityMap.GetData(entityId, false)};
+            RemoveData(mappings, old.Data);
+            replaced.push_back({entityId, old});
+          } else if (!cold_.Empty()) {
+            if (Handle const old{typeId, cold_.Drop(entityId, typeId)};
+                old.IsValid()) {
+              replaced.push_back({entityId, old});
+            }
+          }
+          mappings.EntityMap.Set(entityId, dataId, isEnabled);
+          if constexpr (SoaComponent<ComponentType>) {
+            pool.SetEntity(dataId, entityId);
+            pool.SetIsEnabled(dataId, isEnabled);
+          }
+          handles.push_back({typeId, dataId});
+        }
+        MarkChanged(mappings);
+      }
+    }
+
+    for (auto const& [entityId, handle] : replaced) {
+      NotifyRemove(entityId, handle);
+    }
+    NotifyMany(typeId, entityIds);
+    CRYSTAL_PROFILE_COUNT(profiler_, ComponentCreated, entityIds.size());
+    return handles;
+  }
+
+  // Restores a frozen entity's components, still disabled, and returns their
+  // types. Expects the pools lock to be held
+  std::vector<TypeId> Thaw(EntityId const entityId) {
+    std::vector<TypeId> thawed;
+    auto const frozen = cold_.Take(entityId);
+    auto const* bytes = frozen.Bytes.data();
+    for (auto const& record : frozen.Records) {
+      if (!record.Dropped) {
+        auto& mappings = componentPools_.at(record.Type);
+        auto lock = LockPool(mappings);
+        mappings.ComponentPool->Thaw(record.Data, bytes);
+        mappings.EntityMap.Set(entityId, record.Data, false);
+        MarkChanged(mappings);
+        thawed.push_back(record.Type);
+      }
+      bytes += record.Size;
+    }
+    return thawed;
+  }
+
+  // Returns the entity the component belonged to. Expects the pool lock to be
+  // held
+  EntityId RemoveLocked(Mappings& mappings, Handle const& handle) {
+    if (mappings.Tags) {
+      auto const entityId = static_cast<EntityId>(handle.Data);
+      mappings.Tags->Remove(entityId);
+      return entityId;
+    }
+
+    auto entityId = mappings.EntityMap.GetEntity(handle.Data, false);
+    if (entityId == EntityId{~0} && !cold_.Empty()) {
+      entityId = cold_.Drop(handle.Type, handle.Data);
+    }
+    RemoveData(mappings, handle.Data);
+    return entityId;
+  }
+
+  // Expects the pool lock to be held
+  void RemoveData(Mappings& mappings, DataId const dataId) {
+    mappings.ComponentPool->Remove(dataId);
+    mappings.EntityMap.Remove(dataId);
+    MarkChanged(mappings);
+  }
+
+  // Expects the pool lock to be held
+  static void MarkChanged(Mappings& mappings) {
+    if (mappings.Owner) mappings.Owner->Dirty = true;
+  }
+
+  // Expects the pool lock to be held
+  template <typename ComponentType, typename... Args>
+  static void Overwrite(Mappings& mappings, DataId const dataId,
+                        Args&&... args) {
+    auto& pool = *mappings.GetPool<ComponentType>();
+    if constexpr (SoaComponent<ComponentType>) {
+      pool.Get(dataId).Store(ComponentType(std::forward<Args>(args)...));
+    } else if constexpr (SharedComponent<ComponentType>) {
+      pool.Assign(dataId, ComponentType(std::forward<Args>(args)...));
+    } else {
+      auto* component = pool.Find(dataId);
+      // Built aside first as args may refer to the component itself, and a
+      // throwing constructor then leaves the slot untouched
+      ComponentType value(std::forward<Args>(args)...);
+      if constexpr (std::is_move_assignable_v<ComponentType>) {
+        *component = std::move(value);
+      } else {
+        static_assert(std::is_nothrow_move_constructible_v<ComponentType>);
+        std::destroy_at(component);
+        std::construct_at(component, std::move(value));
+      }
+      Bind<ComponentType>(mappings, dataId);
+    }
+  }
+
+  // Points a new Buffered component at its type's epoch. Expects the pool
+  // lock to be held
+  template <typename ComponentType>
+  static void Bind(Mappings& mappings, DataId const dataId) {
+    if constexpr (IsBuffered<ComponentType>::value) {
+      mappings.GetPool<ComponentType>()->Find(dataId)->Bind(&mappings.Epoch);
+    }
+  }
+
+  std::shared_ptr<Group> GetOwner(Mappings const& mappings) const {
+    auto lock = LockPool(mappings);
+    return mappings.Owner;
+  }
+
+  template <typename ComponentType>
+  bool IsSorted(bool const inReadPhase) const {
+    if constexpr (IsTag<ComponentType>) {
+      return false;
+    } else {
+      auto const* mappings =
+          FindMappings(GetTypeId<ComponentType>(), inReadPhase);
+      if (!mappings) return false;
+      auto lock = LockPool(*mappings, inReadPhase);
+      return static_cast<bool>(mappings->Sort);
+    }
+  }
+
+  // Packs the entities that have every owned component, in the first type's
+  // slot order, at the front of each owned pool
+  template <typename First, typename... Rest>
+  void RepackGroup(Group& group) {
+    auto locks = std::make_tuple(LockPool(GetMappings<First>()),
+                                 LockPool(GetMappings<Rest>())...);
+    auto const& first = GetMappings<First>();
+
+    std::vector<EntityId> entities;
+    first.template GetPool<First>()->ForEach(
+        [&](DataId const dataId, First const&) {
+          auto const entityId = first.EntityMap.GetEntity(dataId);
+          if (entityId != EntityId{~0} &&
+              (GetMappings<Rest>().EntityMap.Contains(entityId) && ...)) {
+            entities.push_back(entityId);
+          }
+        });
+
+    auto arrange = [&]<typename ComponentType>() {
+      auto const& mappings = GetMappings<ComponentType>();
+      std::vector<DataId> front;
+      front.reserve(entities.size());
+      for (auto const entityId : entities) {
+        front.push_back(mappings.EntityMap.GetData(entityId));
+      }
+      mappings.template GetPool<ComponentType>()->Arrange(front);
+    };
+    arrange.template operator()<First>();
+    (arrange.template operator()<Rest>(), ...);
+
+    group.Entities = std::move(entities);
+    group.Dirty = false;
+  }
+
+  void NotifyMany(TypeId const typeId,
+                  std::vector<EntityId> const& entityIds) {
+    if (bulkEvent_ && !entityIds.empty()) {
+      bulkEvent_->Notify(typeId, entityIds);
+    }
+    CRYSTAL_PROFILE_COUNT(profiler_, EventNotified, 1);
+  }
+
+  void NotifyRemove(EntityId const entityId, Handle const& handle) {
+    if (removeEvent_) removeEvent_->Notify(entityId, handle);
+    CRYSTAL_PROFILE_COUNT(profiler_, ComponentRemoved, 1);
+    CRYSTAL_PROFILE_COUNT(profiler_, EventNotified, 1);
   }
 
   void RemoveEntity(std::unordered_map<EntityId, DataId>& entityMap,
@@ -234,34 +1420,39 @@ class ComponentManager {
     }
   }
 
-  template <typename... Sets>
-  std::unordered_set<EntityId> SetIntersection(
-      std::unordered_set<EntityId> const& set1, Sets const&... sets) const {
-    if constexpr (sizeof...(Sets) == 0) {
-      return set1;
-    } else {
-      auto set2 = SetIntersection(sets...);
-
-      std::unordered_set<EntityId> intersection;
-      std::set_intersection(set1.begin(), set1.end(), set2.begin(), set2.end(),
-                            std::inserter(intersection, intersection.end()));
-      return intersection;
-    }
-  }
-
   template <typename ComponentType>
   Mappings& GetOrCreateMappings() {
     auto typeId = GetTypeId<ComponentType>();
-    if (!componentPools_.contains(typeId)) {
-      // TODO: can this ever fail?
-      componentPools_.insert(
-          {typeId,
-           Mappings{std::make_shared<async_lib::Pool<ComponentType>>(), {}}});
+    if (!PoolExists(typeId)) {
+      std::unique_lock<std::shared_mutex> lock;
+      if (concurrency_ == Concurrency::Sharded) {
+        lock = std::unique_lock{poolsMutex_};
+      }
+      auto [it, inserted] = componentPools_.try_emplace(typeId);
+      if (inserted) {
+        if constexpr (IsTag<ComponentType>) {
+          it->second.Tags = std::make_unique<TagSet>();
+        } else {
+          it->second.ComponentPool =
+              std::make_shared<PoolType<ComponentType>>();
+        }
+        if constexpr (IsBuffered<ComponentType>::value) {
+          bufferedEpochs_.push_back(&it->second.Epoch);
+        }
+      }
+      return it->second;
     }
 
     return GetMappings(typeId);
   }
 
+  // Tags carry no data, so every entity shares one instance
+  template <typename ComponentType>
+  static std::shared_ptr<ComponentType> const& GetTagInstance() {
+    static auto const instance = std::make_shared<ComponentType>();
+    return instance;
+  }
+
   template <typename ComponentType>
   Mappings& GetMappings() {
     return const_cast<Mappings&>(
@@ -279,12 +1470,27 @@ class ComponentManager {
   }
 
   Mappings const& GetMappings(TypeId const typeId) const {
+    auto lock = LockPoolsShared();
     return componentPools_.at(typeId);
   }
 
  private:
+  Concurrency const concurrency_;
+  mutable std::shared_mutex poolsMutex_;
+  std::atomic<int> readPhases_ = 0;
+  std::atomic<int> activeWriters_ = 0;
+  std::atomic<EntityId> nextEntityId_;
   std::unordered_map<TypeId, Mappings> componentPools_;
+  std::vector<std::atomic<BufferEpoch>*> bufferedEpochs_;
+  std::atomic<bool> coldStorage_ = false;
+  ColdStore cold_;
 
   EventPtr<EntityId, Handle> addEvent_;
   EventPtr<EntityId, Handle> removeEvent_;
+  EventPtr<EntityId, Handle> changeEvent_;
+  EventPtr<TypeId, std::vector<EntityId>> bulkEvent_;
+
+#ifdef CRYSTAL_ENTITY_PROFILING
+  std::shared_ptr<Profiler> profiler_ = std::make_shared<Profiler>();
+#endif
 };
\ No newline at end of file
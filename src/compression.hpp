@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// A small LZ77 compressor in the style of LZ4: a stream of sequences, each a
+// token byte (literal count in the high nibble, match length - 4 in the low
+// one, 15 meaning more length bytes follow), the literals, then a two byte
+// offset back into the output. The last sequence is literals only. Fast
+// rather than tight, which suits component data full of zeros and repeats.
+inline constexpr std::size_t kLzMinMatch = 4;
+
+inline std::vector<uint8_t> LzCompress(std::span<uint8_t const> const input) {
+  constexpr unsigned kHashBits = 12;
+  constexpr std::size_t kNone = ~std::size_t{0};
+  constexpr std::size_t kMaxOffset = 0xffff;
+
+  std::vector<uint8_t> output;
+  output.reserve(input.size() / 2 + 16);
+  std::vector<std::size_t> table(std::size_t{1} << kHashBits, kNone);
+
+  auto read32 = [&](std::size_t const pos) {
+    uint32_t value;
+    std::memcpy(&value, input.data() + pos, sizeof(value));
+    return value;
+  };
+  auto writeLength = [&](std::size_t length) {
+    for (; length >= 255; length -= 255) output.push_back(255);
+    output.push_back(static_cast<uint8_t>(length));
+  };
+
+  std::size_t anchor = 0;
+  auto emit = [&](std::size_t const end, std::size_t const offset,
+                  std::size_t const matchLength) {
+    auto const literals = end - anchor;
+    auto token = static_cast<uint8_t>(std::min<std::size_t>(literals, 15) << 4);
+    if (matchLength > 0) {
+      token |= std::min<std::size_t>(matchLength - kLzMinMatch, 15);
+    }
+    output.push_back(token);
+    if (literals >= 15) writeLength(literals - 15);
+    output.insert(output.end(), input.begin() + anchor, input.begin() + end);
+    if (matchLength > 0) {
+      output.push_back(static_cast<uint8_t>(offset));
+      output.push_back(static_cast<uint8_t>(offset >> 8));
+      if (matchLength - kLzMinMatch >= 15) {
+        writeLength(matchLength - kLzMinMatch - 15);
+      }
+    }
+  };
+
+  std::size_t pos = 0;
+  while (pos + kLzMinMatch <= input.size()) {
+    auto const value = read32(pos);
+    auto& entry = table[(value * 2654435761u) >> (32 - kHashBits)];
+    auto const candidate = entry;
+    entry = pos;
+
+    if (candidate == kNone || pos - candidate > kMaxOffset ||
+        read32(candidate) != value) {
+      ++pos;
+      continue;
+    }
+
+    auto length = kLzMinMatch;
+    while (pos + length < input.size() &&
+           input[candidate + length] == input[pos + length]) {
+      ++length;
+    }
+    emit(pos, pos - candidate, length);
+    pos += length;
+    anchor = pos;
+  }
+  emit(input.size(), 0, 0);
+  return output;
+}
+
+// Returns false if input isn't a valid stream of exactly size bytes
+inline bool LzDecompress(std::span<uint8_t const> const input,
+                         std::size_t const size, std::vector<uint8_t>& output) {
+  output.clear();
+  output.reserve(size);
+
+  std::size_t pos = 0;
+  auto readLength = [&](std::size_t& length) {
+    uint8_t byte;
+    do {
+      if (pos >= input.size()) return false;
+      byte = input[pos++];
+      length += byte;
+    } while (byte == 255);
+    return true;
+  };
+
+  while (pos < input.size()) {
+    auto const token = input[pos++];
+    std::size_t literals = token >> 4;
+    if (literals == 15 && !readLength(literals)) return false;
+    if (literals > input.size() - pos || output.size() + literals > size) {
+      return false;
+    }
+    output.insert(output.end(), input.begin() + pos,
+                  input.begin() + pos + literals);
+    pos += literals;
+    if (pos == input.size()) break;
+
+    if (input.size() - pos < 2) return false;
+    std::size_t const offset = input[pos] | input[pos + 1] << 8;
+    pos += 2;
+    std::size_t length = token & 15;
+    if (length == 15 && !readLength(length)) return false;
+    length += kLzMinMatch;
+    if (offset == 0 || offset > output.size() ||
+        output.size() + length > size) {
+      return false;
+    }
+
+    // Byte by byte since a match may overlap the bytes it produces
+    auto const from = output.size() - offset;
+    for (std::size_t i = 0; i < length; ++i) {
+      auto const byte = output[from + i];
+      output.push_back(byte);
+    }
+  }
+  return output.size() == size;
+}
\ No newline at end of file
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "events.hpp"
+#include "system.hpp"
+#include "thread_pool.hpp"
+
+class CoroutineSystem;
+
+// Return type of a coroutine run by a CoroutineSystem. Frames come from a
+// shared pool resource so long-lived suspended behaviours are packed together
+// and recycled instead of each going through the global heap.
+class Task {
+ public:
+  struct promise_type {
+    Task get_return_object() { return Task{Handle::from_promise(*this)}; }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { Exception = std::current_exception(); }
+
+    static void* operator new(std::size_t const size) {
+      return FrameResource().allocate(size);
+    }
+    static void operator delete(void* ptr, std::size_t const size) {
+      FrameResource().deallocate(ptr, size);
+    }
+
+    CoroutineSystem* Owner = nullptr;
+    std::exception_ptr Exception;
+  };
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&&) = delete;
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  Handle Release() { return std::exchange(handle_, {}); }
+
+ private:
+  explicit Task(Handle const handle) : handle_(handle) {}
+
+  static std::pmr::memory_resource& FrameResource() {
+    static std::pmr::synchronized_pool_resource resource;
+    return resource;
+  }
+
+  Handle handle_;
+};
+
+// Runs Task coroutines that can co_await NextTick(), Delay(seconds),
+// WaitEvent<T>() and RunAsync(func). Tasks are only resumed inside Tick, so
+// they can use entities like any other system, while RunAsync jobs run on the
+// system's own thread pool. An exception escaping a task is rethrown by Tick.
+class CoroutineSystem : public System {
+ public:
+  explicit CoroutineSystem(std::shared_ptr<EventManager> eventManager,
+                           unsigned const threadCount = 1)
+      : eventManager_(std::move(eventManager)),
+        threadPool_(std::make_unique<ThreadPool>(threadCount)) {}
+
+  // Workers are stopped first as running jobs point into suspended frames
+  ~CoroutineSystem() {
+    threadPool_.reset();
+    for (auto* address : tasks_) Task::Handle::from_address(address).destroy();
+  }
+
+  // Runs the task up to its first suspension
+  void Start(Task task) {
+    auto handle = task.Release();
+    handle.promise().Owner = this;
+    tasks_.insert(handle.address());
+    Resume(handle);
+  }
+
+  void Tick(double const deltaTime) override {
+    time_ += deltaTime;
+
+    std::vector<Task::Handle> due;
+    due.swap(nextTick_);
+    while (!sleeping_.empty() && sleeping_.top().Time <= time_) {
+      due.push_back(sleeping_.top().Handle);
+      sleeping_.pop();
+    }
+    {
+      std::lock_guard lock(wokenMutex_);
+      due.insert(due.end(), woken_.begin(), woken_.end());
+      woken_.clear();
+    }
+
+    // Every due task runs even if one throws, then the first exception is
+    // rethrown
+    std::exception_ptr failure;
+    for (auto handle : due) {
+      try {
+        Resume(handle);
+      } catch (...) {
+        if (!failure) failure = std::current_exception();
+      }
+    }
+    if (failure) std::rethrow_exception(failure);
+  }
+
+  // Number of tasks that haven't finished
+  std::size_t Size() const { return tasks_.size(); }
+
+  // Sum of the deltas passed to Tick
+  double GetTime() const { return time_; }
+
+  // Used by the awaitables below
+  void ResumeNextTick(Task::Handle const handle) {
+    nextTick_.push_back(handle);
+  }
+
+  void ResumeAt(double const time, Task::Handle const handle) {
+    sleeping_.push({time, handle});
+  }
+
+  // Safe to call from any thread
+  void Wake(Task::Handle const handle) {
+    std::lock_guard lock(wokenMutex_);
+    woken_.push_back(handle);
+  }
+
+  EventManager& GetEventManager() { return *eventManager_; }
+  ThreadPool& GetThreadPool() { return *threadPool_; }
+
+ protected:
+  struct Sleeper {
+    double Time;
+    Task::Handle Handle;
+
+    bool operator>(Sleeper const& rhs) const { return Time > rhs.Time; }
+  };
+
+  void Resume(Task::Handle const handle) {
+    handle.resume();
+    if (handle.done()) {
+      auto exception = handle.promise().Exception;
+      tasks_.erase(handle.address());
+      handle.destroy();
+      if (exception) std::rethrow_exception(exception);
+    }
+  }
+
+ private:
+  std::shared_ptr<EventManager> eventManager_;
+  std::unique_ptr<ThreadPool> threadPool_;
+  std::unordered_set<void*> tasks_;
+  double time_ = 0.0;
+
+  std::vector<Task::Handle> nextTick_;
+  std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<>> sleeping_;
+  std::mutex wokenMutex_;
+  std::vector<Task::Handle> woken_;
+};
+
+// co_await NextTick() resumes on the following Tick
+inline auto NextTick() {
+  struct Awaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Task::Handle const handle) {
+      handle.promise().Owner->ResumeNextTick(handle);
+    }
+    void await_resume() const noexcept {}
+  };
+  return Awaiter{};
+}
+
+// co_await Delay(seconds) resumes on the first Tick at least seconds of tick
+// time later
+inline auto Delay(double const seconds) {
+  struct Awaiter {
+    double Seconds;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Task::Handle const handle) {
+      auto* owner = handle.promise().Owner;
+      owner->ResumeAt(owner->GetTime() + Seconds, handle);
+    }
+    void await_resume() const noexcept {}
+  };
+  return Awaiter{seconds};
+}
+
+// co_await WaitEvent<T>() resumes on the Tick after the next T is notified
+// through the EventManager and returns it
+template <typename EventType>
+auto WaitEvent() {
+  // Shared with the observer, which may still fire after the frame is gone
+  struct State {
+    std::mutex Mutex;
+    std::optional<EventType> Value;
+    bool Cancelled = false;
+  };
+
+  struct Awaiter {
+    std::shared_ptr<State> Shared = std::make_shared<State>();
+    ObserverPtr Observer;
+
+    Awaiter() = default;
+    Awaiter(Awaiter&&) = default;
+    ~Awaiter() { Cancel(); }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Task::Handle const handle) {
+      auto* owner = handle.promise().Owner;
+      Observer = owner->GetEventManager().template Subscribe<EventType>(
+          [state = Shared, owner, handle](EventType const& event) {
+            std::lock_guard lock(state->Mutex);
+            if (state->Value || state->Cancelled) return;
+            state->Value = event;
+            owner->Wake(handle);
+          });
+    }
+    EventType await_resume() {
+      Cancel();
+      return std::move(*Shared->Value);
+    }
+
+    void Cancel() {
+      if (Observer) {
+        Observer->Unsubscribe();
+        Observer.reset();
+      }
+      if (Shared) {
+        std::lock_guard lock(Shared->Mutex);
+        Shared->Cancelled = true;
+      }
+    }
+  };
+  return Awaiter{};
+}
+
+// co_await RunAsync(func) runs func on the system's thread pool and resumes on
+// the Tick after it finishes, returning its result. func must not touch
+// entities or components
+template <typename Func>
+auto RunAsync(Func func) {
+  using Result = std::invoke_result_t<Func>;
+  using Stored = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+
+  struct Awaiter {
+    Func Job;
+    std::optional<Stored> Value;
+    std::exception_ptr Exception;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Task::Handle const handle) {
+      auto* owner = handle.promise().Owner;
+      owner->GetThreadPool().Submit([this, owner, handle] {
+        try {
+          if constexpr (std::is_void_v<Result>) {
+            Job();
+            Value = true;
+          } else {
+            Value = Job();
+          }
+        } catch (...) {
+          Exception = std::current_exception();
+        }
+        owner->Wake(handle);
+      });
+    }
+    Result await_resume() {
+      if (Exception) std::rethrow_exception(Exception);
+      if constexpr (!std::is_void_v<Result>) return std::move(*Value);
+    }
+  };
+  return Awaiter{std::move(func), {}, {}};
+}
\ No newline at end of file
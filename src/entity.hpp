@@ -1,7 +1,9 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include <unordered_set>
+#include <vector>
 
 #include "AsyncLib/observer.hpp"
 #include "component.hpp"
@@ -13,7 +15,15 @@ class Entity {
   explicit Entity(
       std::shared_ptr<async_lib::Subject<Entity::Id>> invalidationSubject,
       std::shared_ptr<ComponentManager> const& componentManager)
-      : entityId_(entityIdCounter_++),
+      : entityId_(componentManager->NewEntityId()),
+        componentManager_(componentManager),
+        invalidationSubject_(invalidationSubject) {}
+
+  // Takes an id handed out earlier, for entities restored after eviction
+  Entity(Id const entityId,
+         std::shared_ptr<async_lib::Subject<Entity::Id>> invalidationSubject,
+         std::shared_ptr<ComponentManager> const& componentManager)
+      : entityId_(entityId),
         componentManager_(componentManager),
         invalidationSubject_(invalidationSubject) {}
 
@@ -29,47 +39,106 @@ class Entity {
 
   template <typename ComponentType>
   bool HasComponent() const {
+    std::lock_guard lock(componentsMutex_);
     return components_.contains(ComponentManager::GetTypeId<ComponentType>());
   }
 
+  // False if the entity has any component not in ComponentTypes
+  template <typename... ComponentTypes>
+  bool HasOnlyComponents() const {
+    std::lock_guard lock(componentsMutex_);
+    for (auto const& [type, _] : components_) {
+      if (((type != ComponentManager::GetTypeId<ComponentTypes>()) && ...)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Shared components (see shared.hpp) are handed out const
   template <typename ComponentType>
-  std::weak_ptr<ComponentType> GetComponent() const {
-    auto& handle = GetComponentHandle<ComponentType>();
+  std::weak_ptr<ComponentAccess<ComponentType>> GetComponent() const {
+    auto handle = GetComponentHandle<ComponentType>();
     return componentManager_->Get<ComponentType>(handle);
   }
 
   template <typename ComponentType>
   void AddComponent(ComponentType&& component) {
+    EmplaceComponent<ComponentType>(std::forward<ComponentType>(component));
+  }
+
+  // Constructs the component from args in its pool, replacing any existing
+  // component of the type
+  template <typename ComponentType, typename... Args>
+  void EmplaceComponent(Args&&... args) {
+    // Held across the create so concurrent adds leave a matching handle
+    std::lock_guard lock(componentsMutex_);
     if (IsValid()) {
-      auto handle = componentManager_->Create<ComponentType>(
-          entityId_, std::forward<ComponentType>(component), isEnabled_);
-      components_.insert_or_assign(ComponentManager::GetTypeId<ComponentType>(),
-                                   handle);
+      auto handle = componentManager_->Emplace<ComponentType>(
+          entityId_, isEnabled_, std::forward<Args>(args)...);
+      if (handle.IsValid()) {
+        components_.insert_or_assign(
+            ComponentManager::GetTypeId<ComponentType>(), handle);
+      }
     }
   }
 
+  // Overwrites an existing component in place. Returns false if the entity
+  // doesn't have it
+  template <typename ComponentType, typename... Args>
+  bool ReplaceComponent(Args&&... args) {
+    if (!IsValid()) return false;
+    auto handle = componentManager_->Replace<ComponentType>(
+        entityId_, std::forward<Args>(args)...);
+    return handle.IsValid();
+  }
+
+  // Records a component already created in the component manager, e.g. by
+  // prefab instantiation
+  void AttachComponent(ComponentManager::Handle const& handle) {
+    std::lock_guard lock(componentsMutex_);
+    if (IsValid()) components_.insert_or_assign(handle.Type, handle);
+  }
+
   template <typename ComponentType>
   void RemoveComponent() {
-    auto& handle = GetComponentHandle<ComponentType>();
-    componentManager_->Remove(handle);
-    components_.erase(ComponentManager::GetTypeId<ComponentType>());
+    std::lock_guard lock(componentsMutex_);
+    auto handle = GetComponentHandle<ComponentType>();
+    if (componentManager_->Remove(handle)) {
+      components_.erase(ComponentManager::GetTypeId<ComponentType>());
+    }
   }
 
-  void RemoveAllComponents() {
-    for (auto const& [_, handle] : components_) {
-      componentManager_->Remove(handle);
-    }
+  // Forgets every component without removing it and invalidates the entity,
+  // leaving the components to the caller
+  std::vector<ComponentManager::Handle> DetachComponents() {
+    std::lock_guard lock(componentsMutex_);
+    isValid_ = false;
+    std::vector<ComponentManager::Handle> handles;
+    handles.reserve(components_.size());
+    for (auto const& [_, handle] : components_) handles.push_back(handle);
     components_.clear();
+    return handles;
+  }
+
+  void RemoveAllComponents() {
+    std::lock_guard lock(componentsMutex_);
+    std::erase_if(components_, [&](auto const& item) {
+      return componentManager_->Remove(item.second);
+    });
   }
 
   void SetIsEnabled(bool const isEnabled) {
-    isEnabled_ = isEnabled;
-    componentManager_->SetEntityEnabled(entityId_, isEnabled);
+    if (componentManager_->SetEntityEnabled(entityId_, isEnabled)) {
+      isEnabled_ = isEnabled;
+    }
   }
 
   bool GetIsEnabled() const { return isEnabled_; }
 
   void Invalidate() {
+    if (componentManager_->InReadPhase()) return;
+
     isValid_ = false;
     RemoveAllComponents();
     if (invalidationSubject_) invalidationSubject_->Notify(entityId_);
@@ -79,7 +148,8 @@ class Entity {
 
  protected:
   template <typename ComponentType>
-  ComponentManager::Handle const& GetComponentHandle() const {
+  ComponentManager::Handle GetComponentHandle() const {
+    std::lock_guard lock(componentsMutex_);
     assert(HasComponent<ComponentType>());
     return components_.at(ComponentManager::GetTypeId<ComponentType>());
   }
@@ -88,11 +158,11 @@ class Entity {
   Id const entityId_;
   std::atomic<bool> isEnabled_ = true;
   std::atomic<bool> isValid_ = true;
-  // TODO: replace with thread safe map
+  // Recursive so component event observers can query this entity
+  mutable std::recursive_mutex componentsMutex_;
   std::unordered_map<ComponentManager::TypeId, ComponentManager::Handle>
       components_;
 
-  inline static std::atomic<Entity::Id> entityIdCounter_ = 0;
   std::shared_ptr<ComponentManager> componentManager_;
   std::shared_ptr<async_lib::Subject<Entity::Id>> invalidationSubject_;
 };
\ No newline at end of file
@@ -10,6 +10,10 @@ enum class SystemEvent {
   DestroyEntity,
   AssignComponent,
   RemoveComponent,
+  ChangeComponent,
+  // Sent once per component type by bulk paths that skip the per-component
+  // events above, with the entities whose component was added or removed
+  ChangeComponents,
 };
 
 template <typename... EventArgs>
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+inline uint64_t MixHash(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111eb;
+  return value ^ (value >> 31);
+}
+
+// Hashes bytes in four independent lanes of 8 bytes so the loop has no
+// dependency between lanes and can be vectorised
+inline uint64_t HashBytes(void const* data, std::size_t const size,
+                          uint64_t const seed) {
+  constexpr uint64_t kPrime1 = 0x9e3779b185ebca87;
+  constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4f;
+  constexpr std::size_t kBlock = 32;
+
+  uint64_t lanes[4] = {seed + kPrime1, seed + kPrime2, seed, seed - kPrime1};
+  auto round = [&](unsigned char const* block) {
+    for (int lane = 0; lane < 4; ++lane) {
+      uint64_t word;
+      std::memcpy(&word, block + lane * 8, 8);
+      lanes[lane] = std::rotl(lanes[lane] + word * kPrime2, 31) * kPrime1;
+    }
+  };
+
+  auto const* bytes = static_cast<unsigned char const*>(data);
+  std::size_t offset = 0;
+  for (; offset + kBlock <= size; offset += kBlock) round(bytes + offset);
+  if (offset < size) {
+    unsigned char tail[kBlock] = {};
+    std::memcpy(tail, bytes + offset, size - offset);
+    round(tail);
+  }
+
+  return MixHash(std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) +
+                 std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18) + size);
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Parent/child links between entities. Traversal uses a breadth-first array
+// sorted by depth, so parents always come before their children and
+// propagating values down the tree (transforms, visibility) is one linear
+// pass. Only entities with a parent or children are stored.
+class Hierarchy {
+ public:
+  using EntityId = int32_t;
+  static constexpr EntityId kNone = ~EntityId{0};
+  static constexpr std::size_t kNoIndex = ~std::size_t{0};
+
+  struct Node {
+    EntityId Entity;
+    EntityId Parent;
+    // Position of the parent in the traversal order, kNoIndex for roots
+    std::size_t ParentIndex;
+    std::size_t Depth;
+  };
+
+  // Replaces any existing parent. Fails if it would create a cycle
+  bool SetParent(EntityId const child, EntityId const parent) {
+    if (child == parent || IsAncestor(child, parent)) return false;
+
+    RemoveParent(child);
+    links_[child].Parent = parent;
+    links_[parent].Children.push_back(child);
+    dirty_ = true;
+    return true;
+  }
+
+  void RemoveParent(EntityId const child) {
+    auto it = links_.find(child);
+    if (it == links_.end() || it->second.Parent == kNone) return;
+
+    auto const parent = it->second.Parent;
+    it->second.Parent = kNone;
+    std::erase(links_.at(parent).Children, child);
+    Prune(parent);
+    Prune(child);
+    dirty_ = true;
+  }
+
+  EntityId GetParent(EntityId const entityId) const {
+    auto it = links_.find(entityId);
+    return it != links_.end() ? it->second.Parent : kNone;
+  }
+
+  std::vector<EntityId> GetChildren(EntityId const entityId) const {
+    auto it = links_.find(entityId);
+    return it != links_.end() ? it->second.Children : std::vector<EntityId>{};
+  }
+
+  // Breadth-first, so nearest descendants come first
+  std::vector<EntityId> GetDescendants(EntityId const entityId) const {
+    auto descendants = GetChildren(entityId);
+    for (std::size_t i = 0; i < descendants.size(); ++i) {
+      auto const& children = links_.at(descendants[i]).Children;
+      descendants.insert(descendants.end(), children.begin(), children.end());
+    }
+    return descendants;
+  }
+
+  // Drops the entity and everything below it. Returns the dropped descendants
+  std::vector<EntityId> RemoveTree(EntityId const entityId) {
+    if (!links_.contains(entityId)) return {};
+
+    auto descendants = GetDescendants(entityId);
+    RemoveParent(entityId);
+    links_.erase(entityId);
+    for (auto const descendant : descendants) links_.erase(descendant);
+    dirty_ = true;
+    return descendants;
+  }
+
+  // Roots in id order, then each depth in turn. Rebuilt lazily after changes
+  std::vector<Node> const& GetOrder() {
+    if (dirty_) Rebuild();
+    return order_;
+  }
+
+  // Bumped each time the order is rebuilt, so callers can keep data
+  // alongside it
+  uint64_t GetRevision() const { return revision_; }
+
+  std::size_t Size() const { return links_.size(); }
+
+ protected:
+  struct Link {
+    EntityId Parent = kNone;
+    std::vector<EntityId> Children;
+  };
+
+  bool IsAncestor(EntityId const ancestor, EntityId entityId) const {
+    for (entityId = GetParent(entityId); entityId != kNone;
+         entityId = GetParent(entityId)) {
+      if (entityId == ancestor) return true;
+    }
+    return false;
+  }
+
+  void Prune(EntityId const entityId) {
+    auto it = links_.find(entityId);
+    if (it != links_.end() && it->second.Parent == kNone &&
+        it->second.Children.empty()) {
+      links_.erase(it);
+    }
+  }
+
+  void Rebuild() {
+    order_.clear();
+    order_.reserve(links_.size());
+    for (auto const& [entityId, link] : links_) {
+      if (link.Parent == kNone) {
+        order_.push_back({entityId, kNone, kNoIndex, 0});
+      }
+    }
+    std::sort(order_.begin(), order_.end(),
+              [](auto const& a, auto const& b) { return a.Entity < b.Entity; });
+
+    // A single queue over all roots keeps the whole array sorted by depth
+    for (std::size_t i = 0; i < order_.size(); ++i) {
+      auto const node = order_[i];
+      for (auto const child : links_.at(node.Entity).Children) {
+        order_.push_back({child, node.Entity, i, node.Depth + 1});
+      }
+    }
+    ++revision_;
+    dirty_ = false;
+  }
+
+ private:
+  std::unordered_map<EntityId, Link> links_;
+  std::vector<Node> order_;
+  uint64_t revision_ = 0;
+  bool dirty_ = false;
+};
\ No newline at end of file
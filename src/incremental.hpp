@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "events.hpp"
+#include "manager.hpp"
+#include "query.hpp"
+#include "system.hpp"
+
+// A system whose work over its query is spread across ticks. Each pass takes
+// a snapshot of the matching entities and every tick continues from a cursor
+// into it until the budget runs out. Entities destroyed or no longer matching
+// are skipped, and ones added mid-pass are picked up by the next pass, so
+// every entity that matches for a whole pass is processed exactly once in it.
+//
+//   manager.AddSystem<IncrementalSystem<Agent>>(
+//       &manager, IncrementalSystem<Agent>::Budget{.Entities = 500},
+//       [](std::shared_ptr<Entity>, std::shared_ptr<Agent>) { ... });
+template <typename... Terms>
+class IncrementalSystem : public System {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = QueryCallback<Entity, Terms...>;
+
+  // Zero means no limit. With both limits the first one reached ends the
+  // tick. At least one slice is processed per tick so a pass always ends
+  struct Budget {
+    std::size_t Entities = 0;
+    Clock::duration Time{0};
+  };
+
+  IncrementalSystem(std::shared_ptr<EventManager> const&, Manager* manager,
+                    Budget const budget, Callback func)
+      : manager_(manager), budget_(budget), func_(std::move(func)) {}
+
+  void Tick(double const) override {
+    if (cursor_ == snapshot_.size()) {
+      snapshot_ = manager_->Query<Terms...>();
+      cursor_ = 0;
+    }
+
+    auto const start = Clock::now();
+    std::size_t processed = 0;
+    while (cursor_ < snapshot_.size()) {
+      auto count = std::min(kSliceSize, snapshot_.size() - cursor_);
+      if (budget_.Entities > 0) {
+        count = std::min(count, budget_.Entities - processed);
+      }
+
+      auto const begin = snapshot_.begin() + cursor_;
+      manager_->ForEachOf<Terms...>({begin, begin + count}, func_);
+      cursor_ += count;
+      processed += count;
+
+      if (cursor_ == snapshot_.size()) ++completedPasses_;
+      if (budget_.Entities > 0 && processed >= budget_.Entities) break;
+      if (budget_.Time > Clock::duration{0} &&
+          Clock::now() - start >= budget_.Time) {
+        break;
+      }
+    }
+  }
+
+  // Fraction of the current pass done
+  double GetProgress() const {
+    return snapshot_.empty() ? 1.0
+                             : static_cast<double>(cursor_) / snapshot_.size();
+  }
+
+  std::size_t GetCompletedPasses() const { return completedPasses_; }
+
+  void SetBudget(Budget const budget) { budget_ = budget; }
+
+ protected:
+  // The clock is only read between slices
+  static constexpr std::size_t kSliceSize = 32;
+
+ private:
+  Manager* manager_;
+  Budget budget_;
+  Callback func_;
+  std::vector<Entity::Id> snapshot_;
+  std::size_t cursor_ = 0;
+  std::size_t completedPasses_ = 0;
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 
 #include "manager.hpp"
 
+#include <cmath>
 #include <memory>
 
 Manager::Manager(std::shared_ptr<ComponentManager> const& componentManager)
@@ -14,28 +15,84 @@ Manager::Manager(std::shared_ptr<ComponentManager> const& componentManager)
       EventManager::CreateSystemEvent<Entity::Id, ComponentManager::Handle>();
   auto componentRemoveEvent =
       EventManager::CreateSystemEvent<Entity::Id, ComponentManager::Handle>();
+  auto componentChangeEvent =
+      EventManager::CreateSystemEvent<Entity::Id, ComponentManager::Handle>();
+  auto componentsChangeEvent =
+      EventManager::CreateSystemEvent<ComponentManager::TypeId,
+                                      std::vector<Entity::Id>>();
 
-  componentManager_->SetSystemEvents(componentAddEvent, componentRemoveEvent);
+  componentManager_->SetSystemEvents(componentAddEvent, componentRemoveEvent,
+                                     componentChangeEvent,
+                                     componentsChangeEvent);
+#ifdef CRYSTAL_ENTITY_PROFILING
+  componentManager_->SetProfiler(profiler_);
+#endif
 
   eventManager_ = std::make_shared<EventManager>(
       std::unordered_map<SystemEvent, EventBasePtr>{
           {SystemEvent::CreateEntity, entityCreationEvent_},
           {SystemEvent::DestroyEntity, entityInvalidationEvent_},
           {SystemEvent::AssignComponent, componentAddEvent},
-          {SystemEvent::RemoveComponent, componentRemoveEvent}});
+          {SystemEvent::RemoveComponent, componentRemoveEvent},
+          {SystemEvent::ChangeComponent, componentChangeEvent},
+          {SystemEvent::ChangeComponents, componentsChangeEvent}});
 }
 
 std::weak_ptr<Entity> Manager::CreateEntity() {
+  ComponentManager::WriteScope write(*componentManager_);
+  if (!write) return {};
+
   auto entity =
       std::make_shared<Entity>(entityInvalidationEvent_, componentManager_);
   auto id = entity->GetId();
-  entities_.insert({id, entity});
+  {
+    auto lock = LockEntities();
+    entities_.insert({id, entity});
+  }
 
   entityCreationEvent_->Notify(entity);
+  CRYSTAL_PROFILE_COUNT(profiler_, EntityCreated, 1);
+  CRYSTAL_PROFILE_COUNT(profiler_, EventNotified, 1);
   return entity;
 }
 
+std::vector<std::weak_ptr<Entity>> Manager::Instantiate(
+    Prefab const& prefab, std::size_t const count) {
+  ComponentManager::WriteScope write(*componentManager_);
+  if (!write) return {};
+
+  std::vector<std::shared_ptr<Entity>> entities;
+  std::vector<Entity::Id> ids;
+  entities.reserve(count);
+  ids.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    entities.push_back(
+        std::make_shared<Entity>(entityInvalidationEvent_, componentManager_));
+    ids.push_back(entities.back()->GetId());
+  }
+
+  prefab.Create(*componentManager_, write, ids,
+                [&](std::size_t const index,
+                    ComponentManager::Handle const& handle) {
+                  entities[index]->AttachComponent(handle);
+                });
+
+  {
+    auto lock = LockEntities();
+    entities_.reserve(entities_.size() + count);
+    for (auto const& entity : entities) {
+      entities_.insert({entity->GetId(), entity});
+    }
+  }
+
+  for (auto const& entity : entities) entityCreationEvent_->Notify(entity);
+  CRYSTAL_PROFILE_COUNT(profiler_, EntityCreated, count);
+  CRYSTAL_PROFILE_COUNT(profiler_, EventNotified, count);
+  return {entities.begin(), entities.end()};
+}
+
 std::weak_ptr<Entity> Manager::GetEntity(Entity::Id const entityId) {
+  auto lock = LockEntitiesShared();
   if (entities_.contains(entityId)) {
     return entities_.at(entityId);
   }
@@ -43,20 +100,176 @@ std::weak_ptr<Entity> Manager::GetEntity(Entity::Id const entityId) {
 }
 
 void Manager::DestroyEntity(Entity::Id const entityId) {
-  if (entities_.contains(entityId)) {
-    entities_.at(entityId)->Invalidate();
+  ComponentManager::WriteScope write(*componentManager_);
+  if (!write) return;
+
+  if (auto entity = GetEntity(entityId).lock()) {
+    entity->Invalidate();
     DestoryEntityInternal(entityId);
   }
 }
 
+bool Manager::Evict(std::vector<Entity::Id> const& entityIds) {
+  ComponentManager::WriteScope write(*componentManager_);
+  return Evict(write, entityIds);
+}
+
+bool Manager::Evict(ComponentManager::WriteScope const& write,
+                    std::vector<Entity::Id> const& entityIds) {
+  if (!write) return false;
+
+  std::vector<ComponentManager::Handle> handles;
+  {
+    auto lock = LockEntities();
+    for (auto const entityId : entityIds) {
+      auto it = entities_.find(entityId);
+      if (it == entities_.end()) continue;
+      auto const detached = it->second->DetachComponents();
+      handles.insert(handles.end(), detached.begin(), detached.end());
+      entities_.erase(it);
+    }
+  }
+  return componentManager_->RemoveMany(write, std::move(handles));
+}
+
+bool Manager::SetParent(Entity::Id const child, Entity::Id const parent) {
+  ComponentManager::WriteScope write(*componentManager_);
+  if (!write) return false;
+
+  auto lock = LockEntities();
+  if (!entities_.contains(child) || !entities_.contains(parent)) {
+    return false;
+  }
+  return hierarchy_.SetParent(child, parent);
+}
+
+void Manager::RemoveParent(Entity::Id const child) {
+  ComponentManager::WriteScope write(*componentManager_);
+  if (!write) return;
+
+  auto lock = LockEntities();
+  hierarchy_.RemoveParent(child);
+}
+
+Entity::Id Manager::GetParent(Entity::Id const entityId) const {
+  auto lock = LockEntitiesShared();
+  return hierarchy_.GetParent(entityId);
+}
+
+std::vector<Entity::Id> Manager::GetChildren(
+    Entity::Id const entityId) const {
+  auto lock = LockEntitiesShared();
+  return hierarchy_.GetChildren(entityId);
+}
+
+std::shared_ptr<Manager::HierarchyView> Manager::GetHierarchyView() {
+  auto lock = LockEntities();
+  auto const& order = hierarchy_.GetOrder();
+  if (hierarchyView_ && hierarchyView_->Revision == hierarchy_.GetRevision()) {
+    return hierarchyView_;
+  }
+
+  // Callers still walking the old view keep it alive
+  auto view = std::make_shared<HierarchyView>();
+  view->Revision = hierarchy_.GetRevision();
+  view->Nodes = order;
+  view->Ids.reserve(order.size());
+  view->Entities.reserve(order.size());
+  for (auto const& node : order) {
+    view->Ids.push_back(node.Entity);
+    auto it = entities_.find(node.Entity);
+    view->Entities.push_back(it != entities_.end()
+                                 ? std::weak_ptr<Entity>{it->second}
+                                 : std::weak_ptr<Entity>{});
+  }
+  hierarchyView_ = view;
+  return view;
+}
+
+void Manager::DisableSpatialIndex() {
+  for (auto& observer : spatialObservers_) {
+    if (observer) observer->Unsubscribe();
+  }
+  spatialObservers_.clear();
+
+  std::lock_guard lock(spatialMutex_);
+  spatialRefresh_ = nullptr;
+  spatialUpdate_ = nullptr;
+  spatialGrid_.Clear();
+}
+
+void Manager::RefreshSpatialIndex() {
+  std::function<void()> refresh;
+  {
+    std::lock_guard lock(spatialMutex_);
+    refresh = spatialRefresh_;
+  }
+  if (refresh) refresh();
+}
+
+void Manager::MarkMoved(Entity::Id const entityId) {
+  std::function<void(Entity::Id)> update;
+  {
+    std::lock_guard lock(spatialMutex_);
+    update = spatialUpdate_;
+  }
+  if (update) update(entityId);
+}
+
 void Manager::Tick(double const deltaTime) {
   for (auto& systemId : systemOrder_) {
-    systems_.at(systemId)->Tick(deltaTime);
+    auto it = schedules_.find(systemId);
+    if (it == schedules_.end()) {
+      TickSystem(systemId, deltaTime);
+      continue;
+    }
+
+    auto& schedule = it->second;
+    schedule.Accumulator += deltaTime;
+    unsigned steps = 0;
+    for (; steps < schedule.MaxSteps && schedule.Accumulator >= schedule.Period;
+         ++steps) {
+      TickSystem(systemId, schedule.Period);
+      schedule.Accumulator -= schedule.Period;
+    }
+    // Catch-up limit hit, so drop the whole steps still owed
+    if (steps == schedule.MaxSteps) {
+      schedule.Accumulator = std::fmod(schedule.Accumulator, schedule.Period);
+    }
+  }
+
+  if (compactionBudget_ > 0) {
+    componentManager_->CompactIncremental(compactionBudget_);
   }
+  // After compaction, which moves components out of order
+  componentManager_->SortIncremental();
+  componentManager_->SwapBuffers();
+}
+
+bool Manager::SetSystemRate(System::Id const systemId,
+                            System::Rate const rate) {
+  if (!systems_.contains(systemId) || rate.Hz <= 0.0 || rate.MaxSteps == 0) {
+    return false;
+  }
+
+  auto const period = 1.0 / rate.Hz;
+  auto phase = 0.0;
+  if (rate.Stagger) {
+    // Golden ratio steps spread any number of systems evenly over a period
+    phase = std::fmod(staggeredSystems_++ * 0.6180339887, 1.0);
+  }
+  schedules_.insert_or_assign(systemId,
+                              Schedule{period, rate.MaxSteps, phase * period});
+  return true;
+}
+
+void Manager::ClearSystemRate(System::Id const systemId) {
+  schedules_.erase(systemId);
 }
 
 void Manager::RemoveSystem(System::Id const systemId) {
   systems_.erase(systemId);
+  schedules_.erase(systemId);
   std::erase_if(systemOrder_,
                 [&](auto const& item) { return item == systemId; });
 }
@@ -80,6 +293,58 @@ void Manager::AddSystemInternal(System::Id const id,
   }
 }
 
+void Manager::TickSystem(System::Id const systemId, double const deltaTime) {
+  CRYSTAL_PROFILE_SCOPE(profiler_, systemId);
+  systems_.at(systemId)->Tick(deltaTime);
+}
+
 void Manager::DestoryEntityInternal(Entity::Id const& entityId) {
-  entities_.erase(entityId);
+  std::vector<Entity::Id> descendants;
+  {
+    auto lock = LockEntities();
+    if (entities_.erase(entityId) == 0) return;
+
+    CRYSTAL_PROFILE_COUNT(profiler_, EntityDestroyed, 1);
+    CRYSTAL_PROFILE_COUNT(profiler_, EventNotified, 1);
+    relations_.RemoveEntity(entityId);
+    // The whole subtree is unlinked up front so each descendant below is
+    // destroyed without touching the hierarchy again
+    descendants = hierarchy_.RemoveTree(entityId);
+  }
+
+  for (auto const descendant : descendants) {
+    if (auto entity = GetEntity(descendant).lock()) entity->Invalidate();
+  }
+}
+
+std::shared_lock<std::shared_mutex> Manager::LockEntitiesShared() const {
+  if (componentManager_->GetConcurrency() ==
+      ComponentManager::Concurrency::Sharded) {
+    return std::shared_lock{entitiesMutex_};
+  }
+  return {};
+}
+
+std::unique_lock<std::shared_mutex> Manager::LockEntities() {
+  if (componentManager_->GetConcurrency() ==
+      ComponentManager::Concurrency::Sharded) {
+    return std::unique_lock{entitiesMutex_};
+  }
+  return {};
+}
+
+std::shared_lock<std::shared_mutex> Manager::LockResourcesShared() const {
+  if (componentManager_->GetConcurrency() ==
+      ComponentManager::Concurrency::Sharded) {
+    return std::shared_lock{resourcesMutex_};
+  }
+  return {};
+}
+
+std::unique_lock<std::shared_mutex> Manager::LockResources() {
+  if (componentManager_->GetConcurrency() ==
+      ComponentManager::Concurrency::Sharded) {
+    return std::unique_lock{resourcesMutex_};
+  }
+  return {};
 }
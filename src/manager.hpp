@@ -1,8 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 #include "component.hpp"
 #include "entity.hpp"
 #include "events.hpp"
+#include "hierarchy.hpp"
+#include "prefab.hpp"
+#include "profiler.hpp"
+#include "query.hpp"
+#include "relation.hpp"
+#include "resource.hpp"
+#include "spatial.hpp"
 #include "system.hpp"
 
 class Manager {
@@ -12,35 +28,426 @@ class Manager {
 
   ~Manager() {
     if (entityInvalidationObserver_) entityInvalidationObserver_->Unsubscribe();
+    DisableSpatialIndex();
   }
 
   std::weak_ptr<Entity> CreateEntity();
+  // Creates count entities with the prefab's components. Sends CreateEntity
+  // for each entity and one ChangeComponents event per component type instead
+  // of per-component AssignComponent events
+  std::vector<std::weak_ptr<Entity>> Instantiate(Prefab const& prefab,
+                                                 std::size_t const count = 1);
   std::weak_ptr<Entity> GetEntity(Entity::Id const);
   void DestroyEntity(Entity::Id const);
 
+  // Takes entities out of the world without destroying them, e.g. to page
+  // them out to disk. Their components are removed in bulk, sending only
+  // ChangeComponents events, and hierarchy links and relations are kept for
+  // when they return. Returns false if rejected because a read phase is
+  // active
+  bool Evict(std::vector<Entity::Id> const& entityIds);
+  // As Evict, under a scope the caller holds on the component manager
+  bool Evict(ComponentManager::WriteScope const& write,
+             std::vector<Entity::Id> const& entityIds);
+
+  // Brings evicted entities back under their old ids. create(componentManager,
+  // write, attach) adds their components in bulk under write (e.g. with
+  // InsertMany(write, ...)) and calls attach(index into entityIds, handle)
+  // for each one. Sends no entity events
+  template <typename Func>
+  std::vector<std::weak_ptr<Entity>> Restore(
+      std::vector<Entity::Id> const& entityIds, Func&& create) {
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return {};
+
+    std::vector<std::shared_ptr<Entity>> entities;
+    entities.reserve(entityIds.size());
+    for (auto const entityId : entityIds) {
+      entities.push_back(std::make_shared<Entity>(
+          entityId, entityInvalidationEvent_, componentManager_));
+    }
+    create(*componentManager_, write,
+           [&](std::size_t const index,
+               ComponentManager::Handle const& handle) {
+             entities[index]->AttachComponent(handle);
+           });
+
+    auto lock = LockEntities();
+    entities_.reserve(entities_.size() + entities.size());
+    for (auto const& entity : entities) {
+      entities_.insert({entity->GetId(), entity});
+    }
+    return {entities.begin(), entities.end()};
+  }
+
   // TODO: figure out how this works and if there is a simpler way
   template <typename T>
   struct identity {
     typedef T type;
   };
 
-  template <typename... Args>
-  void ForEach(
-      typename identity<std::function<
-          void(std::shared_ptr<Entity>, std::shared_ptr<Args>...)>>::type func,
+  // Terms can be plain components or With/Without/Optional (see query.hpp),
+  // e.g. ForEach<Position, Without<Frozen>>
+  template <typename... Terms>
+  void ForEach(typename identity<QueryCallback<Entity, Terms...>>::type func,
+               bool const ignoreDisabled = true) {
+    // Plain component lists that match a group are a lockstep slot walk.
+    // Shared components have no slots, so never form a group
+    if constexpr ((std::is_same_v<typename QueryTerm<Terms>::Component,
+                                  Terms> &&
+                   ...) &&
+                  !(SharedComponent<Terms> || ...)) {
+      if (ignoreDisabled &&
+          componentManager_->ForEachGroup<Terms...>(
+              [&](Entity::Id const entityId,
+                  std::shared_ptr<Terms>... components) {
+                if (auto entity = GetEntity(entityId).lock()) {
+                  func(entity, std::move(components)...);
+                }
+              })) {
+        return;
+      }
+    }
+
+    auto entities = componentManager_->Query<Terms...>(ignoreDisabled);
+    CRYSTAL_PROFILE_QUERY(profiler_, typeid(std::tuple<Terms...>).hash_code(),
+                          typeid(std::tuple<Terms...>).name(),
+                          entities.size());
+    Visit<Terms...>(entities, func, ignoreDisabled);
+  }
+
+  // Ids of the entities ForEach would visit
+  template <typename... Terms>
+  std::vector<Entity::Id> Query(bool const ignoreDisabled = true) const {
+    return componentManager_->Query<Terms...>(ignoreDisabled);
+  }
+
+  // ForEach restricted to the given entities. Entities that have been
+  // destroyed or no longer match the terms are skipped
+  template <typename... Terms>
+  void ForEachOf(
+      std::vector<Entity::Id> entities,
+      typename identity<QueryCallback<Entity, Terms...>>::type func,
       bool const ignoreDisabled = true) {
-    static_assert(sizeof...(Args) > 0);
+    componentManager_->Filter<Terms...>(entities, ignoreDisabled);
+    Visit<Terms...>(entities, func, ignoreDisabled);
+  }
 
-    auto entities = componentManager_->GetEntitiesWithSharedComponents<Args...>(
-        ignoreDisabled);
-    for (auto entityId : entities) {
-      if (auto entity = GetEntity(entityId).lock()) {
-        // TODO: can components ever be null?
-        auto out = std::make_tuple(
-            entity, componentManager_->GetByEntity<Args>(entityId).lock()...);
-        std::apply(func, out);
+  // Indexes entities by PositionType in a uniform grid with cells of
+  // cellSize. getPoint(position) returns a SpatialGrid::Point. The grid
+  // follows component events, so adds, removes and ReplaceComponent are seen
+  // straight away. Positions written through component pointers aren't, so
+  // call MarkMoved for those entities (or RefreshSpatialIndex after moving
+  // most of them)
+  template <typename PositionType, typename GetPoint>
+  void EnableSpatialIndex(float const cellSize, GetPoint getPoint) {
+    DisableSpatialIndex();
+    auto const typeId = ComponentManager::GetTypeId<PositionType>();
+    auto update = [this, getPoint](Entity::Id const entityId) {
+      auto const position =
+          componentManager_->GetByEntity<PositionType>(entityId, false).lock();
+      std::lock_guard lock(spatialMutex_);
+      if (position) {
+        spatialGrid_.Set(entityId, getPoint(*position));
+      } else {
+        spatialGrid_.Remove(entityId);
       }
+    };
+    {
+      std::lock_guard lock(spatialMutex_);
+      spatialGrid_ = SpatialGrid{cellSize};
+      spatialUpdate_ = update;
+      spatialRefresh_ = [this, getPoint] {
+        std::lock_guard lock(spatialMutex_);
+        spatialGrid_.Clear();
+        componentManager_->ForEachComponent<PositionType>(
+            [&](Entity::Id const entityId, PositionType const& position) {
+              spatialGrid_.Set(entityId, getPoint(position));
+            },
+            false);
+      };
+    }
+
+    for (auto const event :
+         {SystemEvent::AssignComponent, SystemEvent::RemoveComponent,
+          SystemEvent::ChangeComponent}) {
+      spatialObservers_.push_back(
+          eventManager_->SubscribeSystem<Entity::Id, ComponentManager::Handle>(
+              event, [typeId, update](Entity::Id const& entityId,
+                                      ComponentManager::Handle const& handle) {
+                if (handle.Type == typeId) update(entityId);
+              }));
     }
+    spatialObservers_.push_back(
+        eventManager_->SubscribeSystem<ComponentManager::TypeId,
+                                       std::vector<Entity::Id>>(
+            SystemEvent::ChangeComponents,
+            [typeId, update](ComponentManager::TypeId const& type,
+                             std::vector<Entity::Id> const& entityIds) {
+              if (type != typeId) return;
+              for (auto const entityId : entityIds) update(entityId);
+            }));
+    RefreshSpatialIndex();
+  }
+
+  void DisableSpatialIndex();
+  // Rebuilds the whole spatial index from the position components
+  void RefreshSpatialIndex();
+  // Re-reads the entity's position into the spatial index
+  void MarkMoved(Entity::Id const entityId);
+
+  // Like ForEach over PositionType and Terms, but only for entities within
+  // radius of center, using the indexed positions
+  template <typename PositionType, typename... Terms>
+  void ForEachInRadius(
+      SpatialGrid::Point const& center, float const radius,
+      typename identity<QueryCallback<Entity, PositionType, Terms...>>::type
+          func,
+      bool const ignoreDisabled = true) {
+    std::vector<Entity::Id> entities;
+    {
+      std::lock_guard lock(spatialMutex_);
+      spatialGrid_.ForEachInRadius(
+          center, radius, [&](Entity::Id const entityId, auto const&) {
+            entities.push_back(entityId);
+          });
+    }
+    componentManager_->Filter<PositionType, Terms...>(entities,
+                                                      ignoreDisabled);
+    Visit<PositionType, Terms...>(entities, func, ignoreDisabled);
+  }
+
+  // Any number of threads may query through a read phase without taking
+  // locks. Only const access is handed out, and creating or destroying
+  // entities and components is rejected until every read phase has ended.
+  // Starting one waits for structural changes already in flight
+  class ReadPhase {
+   public:
+    explicit ReadPhase(Manager const& manager)
+        : manager_(manager),
+          active_(manager_.componentManager_->BeginReadPhase()) {}
+    ~ReadPhase() {
+      if (active_) manager_.componentManager_->EndReadPhase();
+    }
+
+    ReadPhase(ReadPhase const&) = delete;
+    ReadPhase& operator=(ReadPhase const&) = delete;
+
+    // False if the phase was refused, in which case it finds nothing
+    explicit operator bool() const { return active_; }
+
+    Entity const* GetEntity(Entity::Id const entityId) const {
+      if (!active_) return nullptr;
+      auto it = manager_.entities_.find(entityId);
+      return it != manager_.entities_.end() ? it->second.get() : nullptr;
+    }
+
+    template <typename ComponentType>
+    ComponentType const* GetByEntity(Entity::Id const entityId,
+                                     bool const ignoreDisabled = true) const {
+      if (!active_) return nullptr;
+      return manager_.componentManager_->Find<ComponentType>(entityId,
+                                                             ignoreDisabled);
+    }
+
+    template <typename ResourceType>
+    ResourceType const* GetResource() const {
+      if (!active_) return nullptr;
+      return manager_.resources_.Get<ResourceType>();
+    }
+
+    template <typename... Terms>
+    void ForEach(
+        typename identity<ReadQueryCallback<Entity, Terms...>>::type func,
+        bool const ignoreDisabled = true) const {
+      if (!active_) return;
+      auto entities =
+          manager_.componentManager_->ReadQuery<Terms...>(ignoreDisabled);
+      for (auto entityId : entities) {
+        Visit<Terms...>(entityId, func, ignoreDisabled);
+      }
+    }
+
+    // Splits the matching entities evenly across threadCount threads, at
+    // least one
+    template <typename... Terms>
+    void ParallelForEach(
+        typename identity<ReadQueryCallback<Entity, Terms...>>::type func,
+        unsigned const threadCount, bool const ignoreDisabled = true) const {
+      if (!active_) return;
+      auto entities =
+          manager_.componentManager_->ReadQuery<Terms...>(ignoreDisabled);
+      auto const workers = std::max(threadCount, 1u);
+      auto const chunk = (entities.size() + workers - 1) / workers;
+      std::vector<std::thread> threads;
+      for (std::size_t begin = 0; begin < entities.size(); begin += chunk) {
+        auto const end = std::min(begin + chunk, entities.size());
+        threads.emplace_back([&, begin, end] {
+          for (auto i = begin; i < end; ++i) {
+            Visit<Terms...>(entities[i], func, ignoreDisabled);
+          }
+        });
+      }
+      for (auto& thread : threads) thread.join();
+    }
+
+   protected:
+    // Nothing can be removed during a read phase, so required components of
+    // a queried entity are always there
+    template <typename Term>
+    ReadQueryArgs<Term> FetchTerm(Entity::Id const entityId,
+                                  bool const ignoreDisabled) const {
+      using ComponentType = typename QueryTerm<Term>::Component;
+      if constexpr (!QueryTerm<Term>::Fetched) {
+        return {};
+      } else if constexpr (QueryTerm<Term>::Required) {
+        auto const* component =
+            GetByEntity<ComponentType>(entityId, ignoreDisabled);
+        assert(component);
+        return ReadQueryArgs<Term>{*component};
+      } else {
+        return ReadQueryArgs<Term>{
+            GetByEntity<ComponentType>(entityId, ignoreDisabled)};
+      }
+    }
+
+    template <typename... Terms, typename Func>
+    void Visit(Entity::Id const entityId, Func const& func,
+               bool const ignoreDisabled) const {
+      auto const* entity = GetEntity(entityId);
+      if (!entity) return;
+
+      std::apply(func, std::tuple_cat(std::tuple<Entity const&>{*entity},
+                                       FetchTerm<Terms>(entityId,
+                                                        ignoreDisabled)...));
+    }
+
+   private:
+    Manager const& manager_;
+    bool const active_;
+  };
+
+  // Can't be started from inside a structural change on the same thread,
+  // e.g. by an observer of entity or component events: the phase would wait
+  // for that change to finish. The phase is refused instead and evaluates to
+  // false
+  ReadPhase BeginReadPhase() const { return ReadPhase(*this); }
+
+  // Replaces any existing resource of the same type. Rejected (returning
+  // nullptr) during a read phase. Pointers to a resource stay valid until it
+  // is replaced or removed
+  template <typename ResourceType, typename... Args>
+  ResourceType* SetResource(Args&&... args) {
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return nullptr;
+    auto lock = LockResources();
+    return &resources_.Emplace<ResourceType>(std::forward<Args>(args)...);
+  }
+
+  template <typename ResourceType>
+  ResourceType* GetResource() {
+    auto lock = LockResourcesShared();
+    return resources_.Get<ResourceType>();
+  }
+
+  template <typename ResourceType>
+  ResourceType const* GetResource() const {
+    auto lock = LockResourcesShared();
+    return resources_.Get<ResourceType>();
+  }
+
+  template <typename ResourceType>
+  void RemoveResource() {
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return;
+    auto lock = LockResources();
+    resources_.Remove<ResourceType>();
+  }
+
+  // Destroying a parent destroys all of its descendants. Fails if either
+  // entity doesn't exist, the link would create a cycle or in a read phase
+  bool SetParent(Entity::Id const child, Entity::Id const parent);
+  void RemoveParent(Entity::Id const child);
+  // Hierarchy::kNone for entities without a parent
+  Entity::Id GetParent(Entity::Id const entityId) const;
+  std::vector<Entity::Id> GetChildren(Entity::Id const entityId) const;
+
+  // Visits every entity in the hierarchy with the component, parents before
+  // children, passing the parent's component (nullptr for roots or when the
+  // parent doesn't have one)
+  template <typename ComponentType>
+  void ForEachInHierarchy(
+      typename identity<std::function<void(
+          std::shared_ptr<Entity>,
+          std::shared_ptr<ComponentAccess<ComponentType>>,
+          std::shared_ptr<ComponentAccess<ComponentType>>)>>::type func,
+      bool const ignoreDisabled = true) {
+    auto const view = GetHierarchyView();
+    auto const typeId = ComponentManager::GetTypeId<ComponentType>();
+    std::shared_ptr<ComponentManager::EntitySlots const> slots;
+    {
+      std::lock_guard lock(view->Mutex);
+      slots = view->Slots[typeId];
+    }
+    auto const components = componentManager_->GetByEntities<ComponentType>(
+        view->Ids, slots, ignoreDisabled);
+    {
+      std::lock_guard lock(view->Mutex);
+      view->Slots[typeId] = std::move(slots);
+    }
+
+    // Parents are always earlier in the order, so their components are
+    // already fetched
+    for (std::size_t i = 0; i < view->Nodes.size(); ++i) {
+      auto entity = view->Entities[i].lock();
+      if (!entity || !components[i]) continue;
+
+      auto const parentIndex = view->Nodes[i].ParentIndex;
+      func(entity, components[i],
+           parentIndex != Hierarchy::kNoIndex ? components[parentIndex]
+                                              : nullptr);
+    }
+  }
+
+  // Typed pairs between entities, see relation.hpp. Relations are removed
+  // when either entity is destroyed
+  template <typename RelationType>
+  bool AddRelation(Entity::Id const source, Entity::Id const target) {
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return false;
+
+    auto lock = LockEntities();
+    if (!entities_.contains(source) || !entities_.contains(target)) {
+      return false;
+    }
+    return relations_.Add<RelationType>(source, target);
+  }
+
+  template <typename RelationType>
+  bool RemoveRelation(Entity::Id const source, Entity::Id const target) {
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return false;
+
+    auto lock = LockEntities();
+    return relations_.Remove<RelationType>(source, target);
+  }
+
+  template <typename RelationType>
+  bool HasRelation(Entity::Id const source, Entity::Id const target) const {
+    auto lock = LockEntitiesShared();
+    return relations_.Contains<RelationType>(source, target);
+  }
+
+  template <typename RelationType>
+  std::vector<Entity::Id> GetRelationTargets(Entity::Id const source) const {
+    auto lock = LockEntitiesShared();
+    return relations_.GetTargets<RelationType>(source);
+  }
+
+  template <typename RelationType>
+  std::vector<Entity::Id> GetRelationSources(Entity::Id const target) const {
+    auto lock = LockEntitiesShared();
+    return relations_.GetSources<RelationType>(target);
   }
 
   template <typename SystemClass, typename... Args>
@@ -48,9 +455,25 @@ class Manager {
     auto id = System::GetId<SystemClass>();
     AddSystemInternal(id,
                       std::make_unique<SystemClass>(eventManager_, args...));
+#ifdef CRYSTAL_ENTITY_PROFILING
+    profiler_->SetSystemName(id, typeid(SystemClass).name());
+#endif
+    return id;
+  }
+
+  // Adds a system that ticks at a fixed rate, see System::Rate
+  template <typename SystemClass, typename... Args>
+  System::Id AddSystem(System::Rate const rate, Args... args) {
+    auto id = AddSystem<SystemClass>(args...);
+    SetSystemRate(id, rate);
     return id;
   }
 
+  // Returns false if the system doesn't exist or the rate isn't positive
+  bool SetSystemRate(System::Id const systemId, System::Rate const rate);
+  // Goes back to ticking once per Manager::Tick
+  void ClearSystemRate(System::Id const systemId);
+
   template <typename SystemClass>
   void RemoveSystem() {
     auto systemId = System::GetId<SystemClass>();
@@ -71,27 +494,163 @@ class Manager {
   void Tick(double const deltaTime) {
     auto systemId = System::GetId<SystemClass>();
     if (systems_.contains(systemId)) {
+      CRYSTAL_PROFILE_SCOPE(profiler_, systemId);
       systems_.at(systemId)->Tick(deltaTime);
     }
   }
 
-  // Ticks all systems in system order
+  // Ticks all systems in system order, fixed rate systems as many times as
+  // they are owed, then flips Buffered components
   void Tick(double const deltaTime);
 
+#ifdef CRYSTAL_ENTITY_PROFILING
+  std::shared_ptr<Profiler> const& GetProfiler() const { return profiler_; }
+#endif
+
+  // Keeps the component pool sorted by compare(lhs, rhs), re-sorted at the end
+  // of each tick. ForEach visits entities in this order when the type drives
+  // the query
+  template <typename ComponentType, typename Compare>
+  void SetSortOrder(Compare compare) {
+    componentManager_->SetSortOrder<ComponentType>(compare);
+  }
+
+  // Keeps the listed component pools co-sorted so ForEach over exactly these
+  // types walks them in lockstep, see ComponentManager::AddGroup
+  template <typename... ComponentTypes>
+  bool AddGroup() {
+    return componentManager_->AddGroup<ComponentTypes...>();
+  }
+
+  // Components with a SoaLayout are stored field by field. These hand out a
+  // proxy per component or spans of chosen fields, see ComponentManager
+  template <SoaComponent ComponentType, typename Func>
+  void ForEachSoa(Func&& func, bool const ignoreDisabled = true) {
+    componentManager_->ForEachSoa<ComponentType>(std::forward<Func>(func),
+                                                 ignoreDisabled);
+  }
+
+  template <SoaComponent ComponentType, auto... Members, typename Func>
+  void ForEachFields(Func&& func, bool const ignoreDisabled = true) {
+    componentManager_->ForEachFields<ComponentType, Members...>(
+        std::forward<Func>(func), ignoreDisabled);
+  }
+
+  // Visits each distinct value of a shared component once with the ids of
+  // the entities holding it, see ComponentManager::ForEachShared
+  template <SharedComponent ComponentType, typename Func>
+  void ForEachShared(Func&& func, bool const ignoreDisabled = true) {
+    componentManager_->ForEachShared<ComponentType>(std::forward<Func>(func),
+                                                    ignoreDisabled);
+  }
+
+  // Number of components moved into pool holes at the end of each tick.
+  // Zero (the default) disables incremental compaction
+  void SetCompactionBudget(std::size_t const budget) {
+    compactionBudget_ = budget;
+  }
+
+  // Compresses the components of disabled entities out of their pools, see
+  // ComponentManager::SetColdStorage
+  void SetColdStorage(bool const enabled) {
+    componentManager_->SetColdStorage(enabled);
+  }
+
  protected:
+  struct Schedule {
+    double Period;
+    unsigned MaxSteps;
+    double Accumulator;
+  };
+
   void AddSystemInternal(System::Id const, std::unique_ptr<System>&&);
+  void TickSystem(System::Id const, double const deltaTime);
   void DestoryEntityInternal(Entity::Id const&);
 
+  template <typename... Terms, typename Func>
+  void Visit(std::vector<Entity::Id> const& entities, Func const& func,
+             bool const ignoreDisabled) {
+    for (auto entityId : entities) {
+      if (auto entity = GetEntity(entityId).lock()) {
+        bool missing = false;
+        auto out = std::tuple_cat(
+            std::make_tuple(entity),
+            FetchTerm<Terms>(entityId, ignoreDisabled, missing)...);
+        // Removed by an earlier callback in this loop
+        if (!missing) std::apply(func, out);
+      }
+    }
+  }
+
+  template <typename Term>
+  QueryArgs<Term> FetchTerm(Entity::Id const entityId,
+                            bool const ignoreDisabled, bool& missing) {
+    using ComponentType = typename QueryTerm<Term>::Component;
+    if constexpr (!QueryTerm<Term>::Fetched) {
+      return {};
+    } else {
+      auto component =
+          componentManager_->GetByEntity<ComponentType>(entityId,
+                                                        ignoreDisabled)
+              .lock();
+      if constexpr (QueryTerm<Term>::Required) missing = missing || !component;
+      return QueryArgs<Term>{std::move(component)};
+    }
+  }
+
+  std::shared_lock<std::shared_mutex> LockEntitiesShared() const;
+  std::unique_lock<std::shared_mutex> LockEntities();
+  std::shared_lock<std::shared_mutex> LockResourcesShared() const;
+  std::unique_lock<std::shared_mutex> LockResources();
+
+  // The hierarchy order with each node's entity, rebuilt along with it so
+  // ForEachInHierarchy is one pass without per-node entity lookups. Slots
+  // holds each node's component data ids per type, see
+  // ComponentManager::GetByEntities
+  struct HierarchyView {
+    uint64_t Revision;
+    std::vector<Hierarchy::Node> Nodes;
+    std::vector<Entity::Id> Ids;
+    std::vector<std::weak_ptr<Entity>> Entities;
+    std::mutex Mutex;
+    std::unordered_map<ComponentManager::TypeId,
+                       std::shared_ptr<ComponentManager::EntitySlots const>>
+        Slots;
+  };
+
+  std::shared_ptr<HierarchyView> GetHierarchyView();
+
  private:
+  mutable std::shared_mutex entitiesMutex_;
+  // Resources are only set or removed outside read phases, so ReadPhase reads
+  // them without it
+  mutable std::shared_mutex resourcesMutex_;
   std::unordered_map<Entity::Id, std::shared_ptr<Entity>> entities_;
   std::unordered_map<System::Id, std::unique_ptr<System>> systems_;
   std::vector<System::Id> systemOrder_;
+  std::unordered_map<System::Id, Schedule> schedules_;
+  std::size_t staggeredSystems_ = 0;
+  std::size_t compactionBudget_ = 0;
 
   std::shared_ptr<ComponentManager> componentManager_;
   std::shared_ptr<EventManager> eventManager_;
+  ResourceStore resources_;
+  Hierarchy hierarchy_;
+  std::shared_ptr<HierarchyView> hierarchyView_;
+  RelationStore relations_;
+
+  std::mutex spatialMutex_;
+  SpatialGrid spatialGrid_;
+  std::function<void()> spatialRefresh_;
+  std::function<void(Entity::Id)> spatialUpdate_;
+  std::vector<ObserverPtr> spatialObservers_;
 
   EventPtr<std::shared_ptr<Entity>> entityCreationEvent_;
   EventPtr<Entity::Id> entityInvalidationEvent_;
 
   ObserverPtr entityInvalidationObserver_;
+
+#ifdef CRYSTAL_ENTITY_PROFILING
+  std::shared_ptr<Profiler> profiler_ = std::make_shared<Profiler>();
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Hands out component memory from a shared arena so live components of a type
+// sit next to each other. Every shared_ptr control block keeps a copy of the
+// allocator, so an arena lives until the last weak_ptr into it has gone.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit ArenaAllocator(std::shared_ptr<std::pmr::memory_resource> arena)
+      : arena_(std::move(arena)) {}
+
+  template <typename U>
+  ArenaAllocator(ArenaAllocator<U> const& other) : arena_(other.arena_) {}
+
+  T* allocate(std::size_t const n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, std::size_t const n) {
+    arena_->deallocate(ptr, n * sizeof(T), alignof(T));
+  }
+
+  template <typename U>
+  bool operator==(ArenaAllocator<U> const& rhs) const {
+    return arena_ == rhs.arena_;
+  }
+
+ private:
+  template <typename U>
+  friend class ArenaAllocator;
+
+  std::shared_ptr<std::pmr::memory_resource> arena_;
+};
+
+class ComponentPoolBase {
+ public:
+  using DataId = int64_t;
+
+  virtual ~ComponentPoolBase() = default;
+
+  virtual bool Contains(DataId const) const = 0;
+  virtual void Remove(DataId const) = 0;
+  // For pools that keep enabled components together
+  virtual void SetIsEnabled(DataId const, bool const) {}
+
+  // Cold storage, see ComponentManager::SetColdStorage. Pools whose
+  // components can be copied as raw bytes append them to bytes and return
+  // true. Thaw restores a component under its old data id
+  virtual bool Freeze(DataId const, std::vector<uint8_t>&) const {
+    return false;
+  }
+  virtual void Thaw(DataId const, uint8_t const*) {}
+  virtual std::size_t FrozenSize() const { return 0; }
+
+  // Number of live components
+  virtual std::size_t Size() const = 0;
+  // Number of slots iteration walks, including holes left by removals
+  virtual std::size_t Capacity() const = 0;
+
+  // Moves all live components into a fresh arena, first in the given order and
+  // then in slot order, and releases the old arena. Data ids stay valid but
+  // outstanding weak_ptrs expire rather than pointing at moved-from data.
+  // Components someone holds locked keep their place in the old arena and
+  // are moved by a later call. That check is only sound if no other thread
+  // can lock a weak_ptr meanwhile, so without relocate only the slots are
+  // reordered: components stay put, weak_ptrs stay valid and nothing is
+  // released.
+  virtual void Compact(std::vector<DataId> const& order = {},
+                       bool const relocate = true) = 0;
+
+  // Fills holes with components from the back of the pool, moving at most
+  // budget of them. Only pointers move so weak_ptrs are unaffected. Returns
+  // the number of components moved.
+  virtual std::size_t CompactStep(std::size_t const budget) = 0;
+
+  bool HasHoles() const { return Size() != Capacity(); }
+};
+
+template <typename ComponentType>
+class ComponentPool : public ComponentPoolBase {
+  using Slot = std::size_t;
+  static constexpr Slot kNoSlot = ~Slot{0};
+  static constexpr std::size_t kPageSize = 1024;
+  static constexpr bool kFreezable =
+      std::is_trivially_copyable_v<ComponentType>;
+
+  // Data ids only ever grow, so the id to slot lookup is paged and a page is
+  // freed once every id in it has been removed
+  struct Page {
+    Page() { Slots.fill(kNoSlot); }
+    std::array<Slot, kPageSize> Slots;
+    std::size_t Count = 0;
+  };
+
+ public:
+  ComponentPool() : arena_(MakeArena()) {}
+
+  template <typename... Args>
+  DataId Emplace(Args&&... args) {
+    auto const dataId = nextDataId_++;
+    SetSlot(dataId, slots_.size());
+    slots_.push_back(std::allocate_shared<ComponentType>(
+        ArenaAllocator<ComponentType>{arena_}, std::forward<Args>(args)...));
+    slotIds_.push_back(dataId);
+    ++size_;
+    return dataId;
+  }
+
+  DataId Add(ComponentType&& data) { return Emplace(std::move(data)); }
+
+  bool Freeze(DataId const dataId,
+              std::vector<uint8_t>& bytes) const override {
+    if constexpr (kFreezable) {
+      auto const* component = Find(dataId);
+      if (!component) return false;
+      auto const* begin = reinterpret_cast<uint8_t const*>(component);
+      bytes.insert(bytes.end(), begin, begin + sizeof(ComponentType));
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  void Thaw(DataId const dataId, uint8_t const* bytes) override {
+    if constexpr (kFreezable) {
+      std::array<uint8_t, sizeof(ComponentType)> raw;
+      std::copy_n(bytes, raw.size(), raw.begin());
+      SetSlot(dataId, slots_.size());
+      slots_.push_back(std::allocate_shared<ComponentType>(
+          ArenaAllocator<ComponentType>{arena_},
+          std::bit_cast<ComponentType>(raw)));
+      slotIds_.push_back(dataId);
+      ++size_;
+    }
+  }
+
+  std::size_t FrozenSize() const override {
+    return kFreezable ? sizeof(ComponentType) : 0;
+  }
+
+  // Makes room for count more components without reallocating
+  void Reserve(std::size_t const count) {
+    slots_.reserve(slots_.size() + count);
+    slotIds_.reserve(slotIds_.size() + count);
+  }
+
+  std::weak_ptr<ComponentType> Get(DataId const dataId) const {
+    auto const slot = GetSlot(dataId);
+    if (slot != kNoSlot) {
+      return slots_[slot];
+    }
+    return {};
+  }
+
+  // Raw access without touching the shared_ptr reference count
+  ComponentType const* Find(DataId const dataId) const {
+    auto const slot = GetSlot(dataId);
+    return slot != kNoSlot ? slots_[slot].get() : nullptr;
+  }
+
+  ComponentType* Find(DataId const dataId) {
+    auto const slot = GetSlot(dataId);
+    return slot != kNoSlot ? slots_[slot].get() : nullptr;
+  }
+
+  bool Contains(DataId const dataId) const override {
+    return GetSlot(dataId) != kNoSlot;
+  }
+
+  // Component in a slot, nullptr for holes and slots past the end
+  std::shared_ptr<ComponentType> At(std::size_t const slot) const {
+    return slot < slots_.size() ? slots_[slot] : nullptr;
+  }
+
+  void Remove(DataId const dataId) override {
+    auto const slot = GetSlot(dataId);
+    if (slot == kNoSlot) return;
+
+    slots_[slot].reset();
+    slotIds_[slot] = -1;
+    ClearSlot(dataId);
+    --size_;
+    firstHole_ = std::min(firstHole_, slot);
+    TrimBack();
+  }
+
+  std::size_t Size() const override { return size_; }
+  std::size_t Capacity() const override { return slots_.size(); }
+
+  // Visits live components in slot order
+  template <typename Func>
+  void ForEach(Func&& func) const {
+    for (Slot slot = 0; slot < slots_.size(); ++slot) {
+      if (slots_[slot]) func(slotIds_[slot], *slots_[slot]);
+    }
+  }
+
+  void Compact(std::vector<DataId> const& order = {},
+               bool const relocate = true) override {
+    std::vector<DataId> ids;
+    ids.reserve(size_);
+    std::vector<bool> taken(slots_.size(), false);
+    for (auto const dataId : order) {
+      auto const slot = GetSlot(dataId);
+      if (slot != kNoSlot && !taken[slot]) {
+        taken[slot] = true;
+        ids.push_back(dataId);
+      }
+    }
+    for (Slot slot = 0; slot < slots_.size(); ++slot) {
+      if (slots_[slot] && !taken[slot]) ids.push_back(slotIds_[slot]);
+    }
+
+    auto arena = relocate ? MakeArena() : arena_;
+    std::vector<std::shared_ptr<ComponentType>> slots;
+    slots.reserve(ids.size());
+    for (Slot slot = 0; slot < ids.size(); ++slot) {
+      auto& old = slots_[GetSlot(ids[slot])];
+      slots.push_back(relocate ? Relocate(old, arena) : std::move(old));
+    }
+    for (Slot slot = 0; slot < ids.size(); ++slot) {
+      pages_[ids[slot] / kPageSize]->Slots[ids[slot] % kPageSize] = slot;
+    }
+
+    // Dropping the old slots releases the old arena once nothing observes it
+    slots_ = std::move(slots);
+    slotIds_ = std::move(ids);
+    slotIds_.shrink_to_fit();
+    arena_ = std::move(arena);
+    firstHole_ = slots_.size();
+  }
+
+  // Insertion sorts the slots by compare(lhs, rhs) over component values, so
+  // re-sorting a nearly sorted pool every tick is close to linear. Holes are
+  // filled first and only pointers move. Returns the number of shifts
+  template <typename Compare>
+  std::size_t Sort(Compare compare) {
+    CompactStep(Capacity());
+
+    std::size_t shifts = 0;
+    for (Slot slot = 1; slot < slots_.size(); ++slot) {
+      if (!compare(*slots_[slot], *slots_[slot - 1])) continue;
+
+      auto component = std::move(slots_[slot]);
+      auto const dataId = slotIds_[slot];
+      auto hole = slot;
+      for (; hole > 0 && compare(*component, *slots_[hole - 1]); --hole) {
+        slots_[hole] = std::move(slots_[hole - 1]);
+        slotIds_[hole] = slotIds_[hole - 1];
+        ++shifts;
+      }
+      slots_[hole] = std::move(component);
+      slotIds_[hole] = dataId;
+    }
+
+    if (shifts > 0) {
+      for (Slot slot = 0; slot < slots_.size(); ++slot) {
+        SetSlot(slotIds_[slot], slot);
+      }
+    }
+    return shifts;
+  }
+
+  // Moves the given live components to the front of the pool in that order,
+  // swapping out whatever was there. Holes are filled first
+  void Arrange(std::vector<DataId> const& front) {
+    CompactStep(Capacity());
+
+    for (Slot slot = 0; slot < front.size(); ++slot) {
+      auto const from = GetSlot(front[slot]);
+      assert(from != kNoSlot);
+      if (from == slot) continue;
+
+      std::swap(slots_[slot], slots_[from]);
+      std::swap(slotIds_[slot], slotIds_[from]);
+      SetSlot(slotIds_[slot], slot);
+      SetSlot(slotIds_[from], from);
+    }
+  }
+
+  std::size_t CompactStep(std::size_t const budget) override {
+    std::size_t moved = 0;
+    while (moved < budget && HasHoles()) {
+      while (slots_[firstHole_]) ++firstHole_;
+
+      auto const last = slots_.size() - 1;
+      slots_[firstHole_] = std::move(slots_[last]);
+      slotIds_[firstHole_] = slotIds_[last];
+      SetSlot(slotIds_[firstHole_], firstHole_);
+      slots_.pop_back();
+      slotIds_.pop_back();
+      TrimBack();
+      ++moved;
+    }
+
+    if (!HasHoles() && slots_.capacity() > 2 * slots_.size()) {
+      slots_.shrink_to_fit();
+      slotIds_.shrink_to_fit();
+    }
+    return moved;
+  }
+
+ protected:
+  static std::shared_ptr<std::pmr::memory_resource> MakeArena() {
+    return std::make_shared<std::pmr::synchronized_pool_resource>();
+  }
+
+  std::shared_ptr<ComponentType> Relocate(
+      std::shared_ptr<ComponentType> const& old,
+      std::shared_ptr<std::pmr::memory_resource> const& arena) {
+    // Someone still holds a locked pointer and may write through it, so the
+    // component stays where it is, keeping the old arena alive until then.
+    // Callers make sure no other thread can lock one after this check
+    if (old.use_count() > 1) return old;
+    return std::allocate_shared<ComponentType>(
+        ArenaAllocator<ComponentType>{arena}, std::move(*old));
+  }
+
+  Slot GetSlot(DataId const dataId) const {
+    if (dataId < 0) return kNoSlot;
+    auto const page = static_cast<std::size_t>(dataId) / kPageSize;
+    if (page >= pages_.size() || !pages_[page]) return kNoSlot;
+    return pages_[page]->Slots[dataId % kPageSize];
+  }
+
+  void SetSlot(DataId const dataId, Slot const slot) {
+    auto const page = static_cast<std::size_t>(dataId) / kPageSize;
+    if (page >= pages_.size()) pages_.resize(page + 1);
+    if (!pages_[page]) pages_[page] = std::make_unique<Page>();
+
+    auto& entry = pages_[page]->Slots[dataId % kPageSize];
+    if (entry == kNoSlot) ++pages_[page]->Count;
+    entry = slot;
+  }
+
+  void ClearSlot(DataId const dataId) {
+    auto const page = static_cast<std::size_t>(dataId) / kPageSize;
+    pages_[page]->Slots[dataId % kPageSize] = kNoSlot;
+    // Only free pages whose ids have all been handed out
+    if (--pages_[page]->Count == 0 &&
+        static_cast<DataId>((page + 1) * kPageSize) <= nextDataId_) {
+      pages_[page].reset();
+    }
+  }
+
+  void TrimBack() {
+    while (!slots_.empty() && !slots_.back()) {
+      slots_.pop_back();
+      slotIds_.pop_back();
+    }
+    firstHole_ = std::min(firstHole_, slots_.size());
+  }
+
+ private:
+  std::shared_ptr<std::pmr::memory_resource> arena_;
+  std::vector<std::shared_ptr<ComponentType>> slots_;
+  std::vector<DataId> slotIds_;
+  std::vector<std::unique_ptr<Page>> pages_;
+  DataId nextDataId_ = 0;
+  std::size_t size_ = 0;
+  Slot firstHole_ = 0;
+};
+
+// Membership bits for empty (tag) components, indexed by entity id. Tags have
+// no data so testing for one is a single bit test. Bits live in pages that
+// are only allocated while they hold a member, so memory and iteration follow
+// the ids in use rather than the largest one (see Shard::FirstEntityId)
+class TagSet {
+ public:
+  using EntityId = int32_t;
+
+  void Set(EntityId const entityId, bool const isEnabled) {
+    assert(entityId >= 0);
+    if (entityId < 0) return;
+    if (Contains(entityId, false)) Remove(entityId);
+    (isEnabled ? enabled_ : disabled_).Set(entityId, true);
+    ++size_;
+  }
+
+  void Remove(EntityId const entityId) {
+    if (Contains(entityId, false)) {
+      enabled_.Set(entityId, false);
+      disabled_.Set(entityId, false);
+      --size_;
+    }
+  }
+
+  bool Contains(EntityId const entityId,
+                bool const ignoreDisabled = true) const {
+    return enabled_.Test(entityId) ||
+           (!ignoreDisabled && disabled_.Test(entityId));
+  }
+
+  void SetIsEnabled(EntityId const entityId, bool const isEnabled) {
+    if (Contains(entityId, false)) Set(entityId, isEnabled);
+  }
+
+  std::size_t Size() const { return size_; }
+
+  // Pages currently allocated
+  std::size_t PageCount() const {
+    return enabled_.PageCount() + disabled_.PageCount();
+  }
+
+  template <typename Func>
+  void ForEach(Func&& func, bool const ignoreDisabled = true) const {
+    enabled_.ForEach(func);
+    if (!ignoreDisabled) disabled_.ForEach(func);
+  }
+
+ protected:
+  // Pages sorted by index. A world's ids come from one range, so there are
+  // few pages and finding one is a short binary search
+  class PagedBits {
+    static constexpr std::size_t kWords = 64;
+    static constexpr std::size_t kPageBits = kWords * 64;
+
+    struct Page {
+      uint32_t Index;
+      uint32_t Count = 0;
+      std::array<uint64_t, kWords> Words{};
+    };
+
+   public:
+    bool Test(EntityId const entityId) const {
+      if (entityId < 0) return false;
+      auto const bit = static_cast<std::size_t>(entityId);
+      auto const position = Find(bit / kPageBits);
+      if (position == pages_.size() ||
+          pages_[position]->Index != bit / kPageBits) {
+        return false;
+      }
+      return (pages_[position]->Words[bit % kPageBits / 64] >> (bit % 64)) & 1;
+    }
+
+    // Expects a non-negative id
+    void Set(EntityId const entityId, bool const value) {
+      auto const bit = static_cast<std::size_t>(entityId);
+      auto const index = static_cast<uint32_t>(bit / kPageBits);
+      auto const position = Find(index);
+      auto it = pages_.begin() + position;
+      if (position == pages_.size() || (*it)->Index != index) {
+        if (!value) return;
+        auto page = std::make_unique<Page>();
+        page->Index = index;
+        it = pages_.insert(it, std::move(page));
+      }
+
+      auto& page = **it;
+      auto& word = page.Words[bit % kPageBits / 64];
+      auto const mask = uint64_t{1} << (bit % 64);
+      if (static_cast<bool>(word & mask) == value) return;
+      word ^= mask;
+      if (value) {
+        ++page.Count;
+      } else if (--page.Count == 0) {
+        pages_.erase(it);
+      }
+    }
+
+    std::size_t PageCount() const { return pages_.size(); }
+
+    template <typename Func>
+    void ForEach(Func& func) const {
+      for (auto const& page : pages_) {
+        auto const base = static_cast<std::size_t>(page->Index) * kPageBits;
+        for (std::size_t word = 0; word < kWords; ++word) {
+          for (auto remaining = page->Words[word]; remaining != 0;
+               remaining &= remaining - 1) {
+            func(static_cast<EntityId>(base + word * 64 +
+                                       std::countr_zero(remaining)));
+          }
+        }
+      }
+    }
+
+   private:
+    using Pages = std::vector<std::unique_ptr<Page>>;
+
+    // Where the page with index is, or would be inserted
+    std::size_t Find(std::size_t const index) const {
+      auto it = std::lower_bound(pages_.begin(), pages_.end(), index,
+                                 [](auto const& page, std::size_t const i) {
+                                   return page->Index < i;
+                                 });
+      return static_cast<std::size_t>(it - pages_.begin());
+    }
+
+    Pages pages_;
+  };
+
+ private:
+  PagedBits enabled_;
+  PagedBits disabled_;
+  std::size_t size_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "component.hpp"
+
+// A set of component values to stamp onto new entities, e.g. a bullet or an
+// NPC type. Manager::Instantiate copies each value into its pool for a whole
+// batch of entities at once instead of adding components one at a time
+class Prefab {
+ public:
+  using EntityId = ComponentManager::EntityId;
+  using Handle = ComponentManager::Handle;
+  using TypeId = ComponentManager::TypeId;
+
+  // Adds the component or replaces its value
+  template <typename ComponentType>
+  Prefab& Set(ComponentType component) {
+    auto value = std::make_shared<ComponentType const>(std::move(component));
+    Entry entry{ComponentManager::GetTypeId<ComponentType>(),
+                [value](ComponentManager& componentManager,
+                        ComponentManager::WriteScope const& write,
+                        std::vector<EntityId> const& entityIds) {
+                  return componentManager.CreateMany(write, entityIds,
+                                                     *value);
+                }};
+
+    auto it = Find(entry.Type);
+    if (it != entries_.end()) {
+      *it = std::move(entry);
+    } else {
+      entries_.push_back(std::move(entry));
+    }
+    return *this;
+  }
+
+  template <typename ComponentType>
+  void Remove() {
+    auto it = Find(ComponentManager::GetTypeId<ComponentType>());
+    if (it != entries_.end()) entries_.erase(it);
+  }
+
+  template <typename ComponentType>
+  bool Has() const {
+    return std::any_of(entries_.begin(), entries_.end(), [](auto& entry) {
+      return entry.Type == ComponentManager::GetTypeId<ComponentType>();
+    });
+  }
+
+  std::size_t Size() const { return entries_.size(); }
+
+  // Creates every component for every entity, one type at a time, under the
+  // caller's write scope. Calls func(index into entityIds, Handle) for each
+  // component created
+  template <typename Func>
+  void Create(ComponentManager& componentManager,
+              ComponentManager::WriteScope const& write,
+              std::vector<EntityId> const& entityIds, Func&& func) const {
+    for (auto const& entry : entries_) {
+      auto const handles = entry.Create(componentManager, write, entityIds);
+      for (std::size_t i = 0; i < handles.size(); ++i) func(i, handles[i]);
+    }
+  }
+
+ protected:
+  struct Entry {
+    TypeId Type;
+    std::function<std::vector<Handle>(ComponentManager&,
+                                      ComponentManager::WriteScope const&,
+                                      std::vector<EntityId> const&)>
+        Create;
+  };
+
+  std::vector<Entry>::iterator Find(TypeId const typeId) {
+    return std::find_if(entries_.begin(), entries_.end(),
+                        [&](auto& entry) { return entry.Type == typeId; });
+  }
+
+ private:
+  std::vector<Entry> entries_;
+};
\ No newline at end of file
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Hooks into the manager are only compiled when CRYSTAL_ENTITY_PROFILING is
+// defined (cmake -DCRYSTAL_ENTITY_PROFILING=ON). The profiler itself can
+// always be used directly.
+#ifdef CRYSTAL_ENTITY_PROFILING
+#define CRYSTAL_PROFILE_COUNT(profiler, counter, n) \
+  (profiler)->Count(Profiler::Counter::counter, n)
+#define CRYSTAL_PROFILE_QUERY(profiler, queryId, name, n) \
+  (profiler)->RecordQuery(queryId, name, n)
+#define CRYSTAL_PROFILE_SCOPE(profiler, systemId) \
+  Profiler::SystemScope profilerScope_##systemId{(profiler).get(), systemId}
+#else
+#define CRYSTAL_PROFILE_COUNT(profiler, counter, n) ((void)0)
+#define CRYSTAL_PROFILE_QUERY(profiler, queryId, name, n) ((void)0)
+#define CRYSTAL_PROFILE_SCOPE(profiler, systemId) ((void)0)
+#endif
+
+class Profiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Id = uint64_t;
+
+  enum class Counter {
+    EntityCreated,
+    EntityDestroyed,
+    ComponentCreated,
+    ComponentRemoved,
+    EventNotified,
+    Count,
+  };
+
+  // Bucket i holds durations in [2^i, 2^(i+1)) nanoseconds
+  struct Histogram {
+    static constexpr std::size_t kBuckets = 40;
+
+    void Add(std::chrono::nanoseconds const duration) {
+      auto const ns =
+          static_cast<uint64_t>(std::max<int64_t>(duration.count(), 1));
+      ++Buckets[std::min<std::size_t>(std::bit_width(ns) - 1, kBuckets - 1)];
+      ++Samples;
+      Total += duration;
+      Min = Samples == 1 ? duration : std::min(Min, duration);
+      Max = std::max(Max, duration);
+    }
+
+    // Upper bound of the bucket containing the given percentile (0-100)
+    std::chrono::nanoseconds Percentile(double const percentile) const {
+      auto const target = static_cast<uint64_t>(Samples * percentile / 100.0);
+      uint64_t seen = 0;
+      for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += Buckets[i];
+        if (seen > target || seen == Samples) {
+          return std::min(Max, std::chrono::nanoseconds{int64_t{2} << i});
+        }
+      }
+      return Max;
+    }
+
+    std::array<uint64_t, kBuckets> Buckets{};
+    uint64_t Samples = 0;
+    std::chrono::nanoseconds Total{0};
+    std::chrono::nanoseconds Min{0};
+    std::chrono::nanoseconds Max{0};
+  };
+
+  struct QueryStats {
+    std::string Name;
+    uint64_t Calls = 0;
+    uint64_t Iterations = 0;
+  };
+
+  struct Stats {
+    std::unordered_map<Id, Histogram> Systems;
+    std::unordered_map<Id, QueryStats> Queries;
+    std::array<uint64_t, static_cast<std::size_t>(Counter::Count)> Counters{};
+
+    uint64_t Get(Counter const counter) const {
+      return Counters[static_cast<std::size_t>(counter)];
+    }
+  };
+
+  // Times a system tick for as long as it is in scope
+  class SystemScope {
+   public:
+    SystemScope(Profiler* profiler, Id const systemId)
+        : profiler_(profiler), systemId_(systemId), start_(Clock::now()) {}
+    ~SystemScope() {
+      if (profiler_) profiler_->RecordSystem(systemId_, start_, Clock::now());
+    }
+
+   private:
+    Profiler* profiler_;
+    Id systemId_;
+    Clock::time_point start_;
+  };
+
+  void SetSystemName(Id const systemId, std::string const& name) {
+    std::lock_guard lock(mutex_);
+    systemNames_.insert_or_assign(systemId, name);
+  }
+
+  void Count(Counter const counter, uint64_t const n = 1) {
+    counters_[static_cast<std::size_t>(counter)].fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  void RecordQuery(Id const queryId, char const* name,
+                   uint64_t const iterations) {
+    std::lock_guard lock(mutex_);
+    auto& query = queries_[queryId];
+    if (query.Name.empty()) query.Name = name;
+    ++query.Calls;
+    query.Iterations += iterations;
+  }
+
+  void RecordSystem(Id const systemId, Clock::time_point const start,
+                    Clock::time_point const end) {
+    std::lock_guard lock(mutex_);
+    systems_[systemId].Add(end - start);
+    if (tracing_) {
+      auto const thread =
+          std::hash<std::thread::id>{}(std::this_thread::get_id());
+      trace_.push_back({systemId, start, end - start, thread});
+    }
+  }
+
+  Stats GetStats() const {
+    std::lock_guard lock(mutex_);
+    Stats stats{systems_, queries_, {}};
+    for (std::size_t i = 0; i < stats.Counters.size(); ++i) {
+      stats.Counters[i] = counters_[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+  void Reset() {
+    std::lock_guard lock(mutex_);
+    systems_.clear();
+    queries_.clear();
+    trace_.clear();
+    for (auto& counter : counters_) counter = 0;
+  }
+
+  // Records every system tick until the trace is written
+  void StartTrace() {
+    std::lock_guard lock(mutex_);
+    tracing_ = true;
+    trace_.clear();
+    traceStart_ = Clock::now();
+  }
+
+  // Writes recorded ticks in Chrome trace-event format (chrome://tracing)
+  void WriteChromeTrace(std::ostream& out) {
+    std::lock_guard lock(mutex_);
+    out << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < trace_.size(); ++i) {
+      auto const& event = trace_[i];
+      out << (i == 0 ? "" : ",") << "{\"name\":\"" << SystemName(event.System)
+          << "\",\"cat\":\"system\",\"ph\":\"X\",\"ts\":"
+          << ToMicroseconds(event.Start - traceStart_)
+          << ",\"dur\":" << ToMicroseconds(event.Duration)
+          << ",\"pid\":0,\"tid\":" << event.Thread % 1000000 << "}";
+    }
+    out << "]}";
+    tracing_ = false;
+    trace_.clear();
+  }
+
+ protected:
+  struct TraceEvent {
+    Id System;
+    Clock::time_point Start;
+    Clock::duration Duration;
+    std::size_t Thread;
+  };
+
+  static double ToMicroseconds(Clock::duration const duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+
+  std::string SystemName(Id const systemId) const {
+    if (systemNames_.contains(systemId)) {
+      std::string escaped;
+      for (auto const c : systemNames_.at(systemId)) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+      }
+      return escaped;
+    }
+    return "System " + std::to_string(systemId);
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_map<Id, Histogram> systems_;
+  std::unordered_map<Id, QueryStats> queries_;
+  std::unordered_map<Id, std::string> systemNames_;
+  std::array<std::atomic<uint64_t>, static_cast<std::size_t>(Counter::Count)>
+      counters_{};
+
+  bool tracing_ = false;
+  Clock::time_point traceStart_;
+  std::vector<TraceEvent> trace_;
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "shared.hpp"
+
+// Query terms for Manager::ForEach and ComponentManager::Query. A plain
+// component type must be present and is passed to the callback.
+//   With<T>     must be present, but isn't fetched
+//   Without<T>  must not be present
+//   Optional<T> is passed to the callback, nullptr when absent
+template <typename ComponentType>
+struct With {};
+template <typename ComponentType>
+struct Without {};
+template <typename ComponentType>
+struct Optional {};
+
+template <typename Term>
+struct QueryTerm {
+  using Component = Term;
+  static constexpr bool Required = true;
+  static constexpr bool Excluded = false;
+  static constexpr bool Fetched = true;
+};
+
+template <typename ComponentType>
+struct QueryTerm<With<ComponentType>> {
+  using Component = ComponentType;
+  static constexpr bool Required = true;
+  static constexpr bool Excluded = false;
+  static constexpr bool Fetched = false;
+};
+
+template <typename ComponentType>
+struct QueryTerm<Without<ComponentType>> {
+  using Component = ComponentType;
+  static constexpr bool Required = false;
+  static constexpr bool Excluded = true;
+  static constexpr bool Fetched = false;
+};
+
+template <typename ComponentType>
+struct QueryTerm<Optional<ComponentType>> {
+  using Component = ComponentType;
+  static constexpr bool Required = false;
+  static constexpr bool Excluded = false;
+  static constexpr bool Fetched = true;
+};
+
+// Callback arguments contributed by a term: shared_ptr for ForEach (to const
+// for shared components) and a const reference (const pointer for Optional)
+// inside a read phase
+template <typename Term>
+using QueryArgs = std::conditional_t<
+    QueryTerm<Term>::Fetched,
+    std::tuple<std::shared_ptr<
+        ComponentAccess<typename QueryTerm<Term>::Component>>>,
+    std::tuple<>>;
+
+template <typename Term>
+using ReadQueryArgs = std::conditional_t<
+    QueryTerm<Term>::Fetched,
+    std::tuple<std::conditional_t<
+        QueryTerm<Term>::Required, typename QueryTerm<Term>::Component const&,
+        typename QueryTerm<Term>::Component const*>>,
+    std::tuple<>>;
+
+template <typename First, typename Args>
+struct QueryFunction;
+
+template <typename First, typename... Args>
+struct QueryFunction<First, std::tuple<Args...>> {
+  using type = std::function<void(First, Args...)>;
+};
+
+template <typename EntityType, typename... Terms>
+using QueryCallback = typename QueryFunction<
+    std::shared_ptr<EntityType>,
+    decltype(std::tuple_cat(std::declval<QueryArgs<Terms>>()...))>::type;
+
+template <typename EntityType, typename... Terms>
+using ReadQueryCallback = typename QueryFunction<
+    EntityType const&,
+    decltype(std::tuple_cat(std::declval<ReadQueryArgs<Terms>>()...))>::type;
+
+template <typename... Terms>
+inline constexpr bool HasRequiredTerm = (QueryTerm<Terms>::Required || ...);
\ No newline at end of file
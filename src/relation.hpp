@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Typed pairs between entities (Likes, Targets, DockedTo...). The relation
+// type is only a marker. Both directions are stored, so finding the targets of
+// a source or the sources of a target is a single lookup.
+class RelationStore {
+ public:
+  using EntityId = int32_t;
+  using Index = std::size_t;
+
+  template <typename RelationType>
+  static Index GetIndex() {
+    static Index const index = nextIndex_++;
+    return index;
+  }
+
+  // Returns false if the pair already exists
+  template <typename RelationType>
+  bool Add(EntityId const source, EntityId const target) {
+    auto const index = GetIndex<RelationType>();
+    if (index >= tables_.size()) tables_.resize(index + 1);
+
+    auto& targets = tables_[index].Targets[source];
+    if (std::find(targets.begin(), targets.end(), target) != targets.end()) {
+      return false;
+    }
+    targets.push_back(target);
+    tables_[index].Sources[target].push_back(source);
+    return true;
+  }
+
+  template <typename RelationType>
+  bool Remove(EntityId const source, EntityId const target) {
+    auto const index = GetIndex<RelationType>();
+    if (index >= tables_.size()) return false;
+
+    auto& table = tables_[index];
+    if (Erase(table.Targets, source, target)) {
+      Erase(table.Sources, target, source);
+      return true;
+    }
+    return false;
+  }
+
+  template <typename RelationType>
+  bool Contains(EntityId const source, EntityId const target) const {
+    auto const& targets = GetTargets<RelationType>(source);
+    return std::find(targets.begin(), targets.end(), target) != targets.end();
+  }
+
+  template <typename RelationType>
+  std::vector<EntityId> const& GetTargets(EntityId const source) const {
+    return Find(GetIndex<RelationType>(), &Table::Targets, source);
+  }
+
+  template <typename RelationType>
+  std::vector<EntityId> const& GetSources(EntityId const target) const {
+    return Find(GetIndex<RelationType>(), &Table::Sources, target);
+  }
+
+  // Drops every relation the entity is part of, in either direction
+  void RemoveEntity(EntityId const entityId) {
+    for (auto& table : tables_) {
+      if (auto it = table.Targets.find(entityId); it != table.Targets.end()) {
+        for (auto const target : it->second) {
+          Erase(table.Sources, target, entityId);
+        }
+        table.Targets.erase(it);
+      }
+      if (auto it = table.Sources.find(entityId); it != table.Sources.end()) {
+        for (auto const source : it->second) {
+          Erase(table.Targets, source, entityId);
+        }
+        table.Sources.erase(it);
+      }
+    }
+  }
+
+ protected:
+  using Links = std::unordered_map<EntityId, std::vector<EntityId>>;
+
+  struct Table {
+    Links Targets;
+    Links Sources;
+  };
+
+  static bool Erase(Links& links, EntityId const from, EntityId const to) {
+    auto it = links.find(from);
+    if (it == links.end() || std::erase(it->second, to) == 0) return false;
+    if (it->second.empty()) links.erase(it);
+    return true;
+  }
+
+  std::vector<EntityId> const& Find(Index const index, Links Table::*links,
+                                    EntityId const entityId) const {
+    static std::vector<EntityId> const empty;
+    if (index >= tables_.size()) return empty;
+
+    auto const& map = tables_[index].*links;
+    auto it = map.find(entityId);
+    return it != map.end() ? it->second : empty;
+  }
+
+ private:
+  std::vector<Table> tables_;
+
+  inline static std::atomic<Index> nextIndex_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Holds one instance per type (time, input, physics world...) outside the
+// entity pools. Every type gets a dense index the first time it is used, so
+// lookups are a vector index rather than a hash.
+class ResourceStore {
+ public:
+  using Index = std::size_t;
+
+  template <typename ResourceType>
+  static Index GetIndex() {
+    static Index const index = nextIndex_++;
+    return index;
+  }
+
+  template <typename ResourceType, typename... Args>
+  ResourceType& Emplace(Args&&... args) {
+    auto const index = GetIndex<ResourceType>();
+    if (index >= resources_.size()) resources_.resize(index + 1);
+
+    auto resource =
+        std::make_shared<ResourceType>(std::forward<Args>(args)...);
+    auto& ref = *resource;
+    resources_[index] = std::move(resource);
+    return ref;
+  }
+
+  template <typename ResourceType>
+  ResourceType* Get() {
+    return const_cast<ResourceType*>(std::as_const(*this).Get<ResourceType>());
+  }
+
+  template <typename ResourceType>
+  ResourceType const* Get() const {
+    auto const index = GetIndex<ResourceType>();
+    if (index < resources_.size()) {
+      return static_cast<ResourceType const*>(resources_[index].get());
+    }
+    return nullptr;
+  }
+
+  template <typename ResourceType>
+  bool Contains() const {
+    return Get<ResourceType>() != nullptr;
+  }
+
+  template <typename ResourceType>
+  void Remove() {
+    auto const index = GetIndex<ResourceType>();
+    if (index < resources_.size()) resources_[index].reset();
+  }
+
+ private:
+  std::vector<std::shared_ptr<void>> resources_;
+
+  inline static std::atomic<Index> nextIndex_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "hash.hpp"
+#include "manager.hpp"
+#include "snapshot.hpp"
+#include "transport.hpp"
+
+// One of several worlds, usually in separate processes, that together make up
+// a larger one. Each shard hands out entity ids from its own range (build its
+// ComponentManager with FirstEntityId) so entities keep their ids wherever
+// they go. Entities move between shards with Migrate and can be read on other
+// shards through ghosts, read-only copies sent with Publish.
+//
+// Only the listed components travel, so entities with any other component
+// would lose it. Like RegionStreamer, Migrate leaves them where they are and
+// reports them through GetSkipped. Hierarchy links and relations should be
+// removed before an entity leaves.
+// Entities frozen by cold storage are thawed to be sent and frozen again if
+// they stay.
+// Messages carry components as raw bytes, so every shard must run the same
+// build of the program. Not thread safe, call from the tick thread
+template <typename... ComponentTypes>
+class Shard {
+ public:
+  using ShardId = Transport::ShardId;
+  using EntityId = Entity::Id;
+
+  // Leaves 128 shards of 16M ids each. Higher shard ids would wrap to
+  // negative entity ids
+  static constexpr int kRangeBits = 24;
+  static constexpr ShardId kMaxShards = ShardId{1} << (31 - kRangeBits);
+
+  static EntityId FirstEntityId(ShardId const shard) {
+    assert(shard < kMaxShards);
+    return static_cast<EntityId>(shard << kRangeBits);
+  }
+  static ShardId HomeOf(EntityId const entityId) {
+    return static_cast<ShardId>(entityId) >> kRangeBits;
+  }
+
+  Shard(ShardId const id, Manager& manager,
+        std::shared_ptr<ComponentManager> componentManager,
+        std::unique_ptr<Transport> transport)
+      : id_(id),
+        manager_(manager),
+        componentManager_(std::move(componentManager)),
+        transport_(std::move(transport)) {
+    assert(id < kMaxShards);
+  }
+
+  Shard(Shard const&) = delete;
+  Shard& operator=(Shard const&) = delete;
+
+  ShardId GetId() const { return id_; }
+
+  // Sends the entities to shard to in one message and evicts them, dropping
+  // their ghosts elsewhere. Entities that don't exist here are skipped, and
+  // those with unlisted components are kept and reported by GetSkipped.
+  // Returns the number moved, none if the message couldn't be sent or a read
+  // phase is active
+  std::size_t Migrate(std::vector<EntityId> const& entityIds,
+                      ShardId const to) {
+    skipped_.clear();
+    if (to == id_) return 0;
+    // Evicting under this scope means a read phase starting after the message
+    // has gone can't reject it
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return 0;
+
+    std::vector<EntityId> movable;
+    movable.reserve(entityIds.size());
+    for (auto const entityId : entityIds) {
+      auto const entity = manager_.GetEntity(entityId).lock();
+      if (!entity) continue;
+      if (entity->template HasOnlyComponents<ComponentTypes...>()) {
+        movable.push_back(entityId);
+      } else {
+        skipped_.push_back(entityId);
+      }
+    }
+
+    std::vector<EntityId> thawed;
+    auto const snapshot = Capture(write, movable, thawed);
+    if (snapshot.Empty()) return 0;
+    auto message = Header(Kind::Migrate);
+    snapshot.Encode(message);
+    if (!transport_->Send(to, message)) {
+      Refreeze(write, thawed);
+      return 0;
+    }
+
+    manager_.Evict(write, snapshot.Ids());
+    std::unordered_map<ShardId, std::vector<EntityId>> drops;
+    for (auto const entityId : snapshot.Ids()) {
+      auto it = subscribers_.find(entityId);
+      if (it == subscribers_.end()) continue;
+      for (auto const shard : it->second) {
+        if (shard != to) drops[shard].push_back(entityId);
+      }
+      subscribers_.erase(it);
+    }
+    for (auto const& [shard, ids] : drops) SendDrop(ids, shard);
+    return snapshot.Ids().size();
+  }
+
+  // Sends copies of the entities' components to shard to, replacing any it
+  // already has. Publish again whenever to should see new values. Returns the
+  // number sent, none if a read phase is active
+  std::size_t Publish(std::vector<EntityId> const& entityIds,
+                      ShardId const to) {
+    if (to == id_) return 0;
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return 0;
+
+    std::vector<EntityId> thawed;
+    auto const snapshot = Capture(write, entityIds, thawed);
+    Refreeze(write, thawed);
+    if (snapshot.Empty()) return 0;
+    auto message = Header(Kind::Ghost);
+    snapshot.Encode(message);
+    if (!transport_->Send(to, message)) return 0;
+
+    for (auto const entityId : snapshot.Ids()) {
+      subscribers_[entityId].insert(to);
+    }
+    return snapshot.Ids().size();
+  }
+
+  // Drops the ghosts of the entities on shard to. Needed for entities
+  // destroyed here
+  bool Unpublish(std::vector<EntityId> const& entityIds, ShardId const to) {
+    for (auto const entityId : entityIds) {
+      auto it = subscribers_.find(entityId);
+      if (it == subscribers_.end()) continue;
+      it->second.erase(to);
+      if (it->second.empty()) subscribers_.erase(it);
+    }
+    return SendDrop(entityIds, to);
+  }
+
+  // Handles every message that has arrived. Migrations rejected by a read
+  // phase are kept and retried on the next call. Returns the number of
+  // entities migrated in
+  std::size_t Poll() {
+    std::size_t restored = 0;
+    auto retry = std::move(pending_);
+    pending_.clear();
+    for (auto& snapshot : retry) restored += Restore(std::move(snapshot));
+
+    while (auto message = transport_->Receive()) {
+      restored += Handle(*message);
+    }
+    return restored;
+  }
+
+  // Entities the last Migrate left here because they have components that
+  // don't travel
+  std::vector<EntityId> const& GetSkipped() const { return skipped_; }
+
+  bool HasGhost(EntityId const entityId) const {
+    return ghosts_.contains(entityId);
+  }
+
+  // The ghost's copy of ComponentType, nullptr if there is no ghost or it
+  // doesn't have one. Valid until the next Poll
+  template <typename ComponentType>
+  ComponentType const* GetGhost(EntityId const entityId) const {
+    auto it = ghosts_.find(entityId);
+    if (it == ghosts_.end()) return nullptr;
+    auto const& component =
+        std::get<std::optional<ComponentType>>(it->second.Components);
+    return component ? &*component : nullptr;
+  }
+
+  bool GetGhostIsEnabled(EntityId const entityId) const {
+    auto it = ghosts_.find(entityId);
+    return it != ghosts_.end() && it->second.IsEnabled;
+  }
+
+  std::size_t GhostCount() const { return ghosts_.size(); }
+
+  // Messages thrown away because they were malformed, came from a different
+  // build or would have overwritten entities living here
+  std::size_t RejectedCount() const { return rejected_; }
+
+ protected:
+  using Payload = Snapshot<ComponentTypes...>;
+
+  enum class Kind : uint32_t { Migrate, Ghost, Drop };
+
+  // magic, kind, sender and schema
+  static constexpr uint32_t kMagic = 0x44485243;  // "CRHD"
+  static constexpr std::size_t kHeaderSize = 3 * sizeof(uint32_t) + 8;
+
+  struct Ghost {
+    ShardId Owner;
+    bool IsEnabled;
+    std::tuple<std::optional<ComponentTypes>...> Components;
+  };
+
+  // Guards against shards built with different component types
+  static uint64_t Schema() {
+    uint64_t schema = kMagic;
+    ((schema = MixHash(schema ^ ComponentManager::GetTypeId<ComponentTypes>() ^
+                       sizeof(ComponentTypes))),
+     ...);
+    return schema;
+  }
+
+  Transport::Message Header(Kind const kind) const {
+    uint32_t const words[] = {kMagic, static_cast<uint32_t>(kind), id_};
+    uint64_t const schema = Schema();
+    Transport::Message message(kHeaderSize);
+    std::memcpy(message.data(), words, sizeof(words));
+    std::memcpy(message.data() + sizeof(words), &schema, sizeof(schema));
+    return message;
+  }
+
+  // Frozen entities are thawed first, or their cold components would be
+  // missed, and added to thawed
+  Payload Capture(ComponentManager::WriteScope const& write,
+                  std::vector<EntityId> const& entityIds,
+                  std::vector<EntityId>& thawed) {
+    std::vector<EntityId> present;
+    present.reserve(entityIds.size());
+    for (auto const entityId : entityIds) {
+      if (manager_.GetEntity(entityId).expired()) continue;
+      if (componentManager_->IsFrozen(entityId)) {
+        componentManager_->Unfreeze(write, entityId);
+        thawed.push_back(entityId);
+      }
+      present.push_back(entityId);
+    }
+    return Payload::Capture(manager_, *componentManager_, std::move(present));
+  }
+
+  void Refreeze(ComponentManager::WriteScope const& write,
+                std::vector<EntityId> const& entityIds) {
+    for (auto const entityId : entityIds) {
+      componentManager_->SetEntityEnabled(write, entityId, false);
+    }
+  }
+
+  bool SendDrop(std::vector<EntityId> const& entityIds, ShardId const to) {
+    auto message = Header(Kind::Drop);
+    auto const* begin = reinterpret_cast<uint8_t const*>(entityIds.data());
+    message.insert(message.end(), begin,
+                   begin + entityIds.size() * sizeof(EntityId));
+    return transport_->Send(to, message);
+  }
+
+  std::size_t Handle(Transport::Message const& message) {
+    uint32_t words[3];
+    uint64_t schema;
+    if (message.size() < kHeaderSize) return Reject();
+    std::memcpy(words, message.data(), sizeof(words));
+    std::memcpy(&schema, message.data() + sizeof(words), sizeof(schema));
+    if (words[0] != kMagic || schema != Schema()) return Reject();
+
+    auto const from = words[2];
+    auto const body = std::span(message).subspan(kHeaderSize);
+    switch (static_cast<Kind>(words[1])) {
+      case Kind::Migrate:
+        if (auto snapshot = Payload::Decode(body)) {
+          return Restore(std::move(*snapshot));
+        }
+        break;
+      case Kind::Ghost:
+        if (auto snapshot = Payload::Decode(body)) {
+          snapshot->ForEach([&](EntityId const entityId, bool const isEnabled,
+                                ComponentTypes const*... components) {
+            // Lives here now, so the ghost would be out of date
+            if (!manager_.GetEntity(entityId).expired()) return;
+            ghosts_[entityId] =
+                Ghost{from, isEnabled, {ToOptional(components)...}};
+          });
+          return 0;
+        }
+        break;
+      case Kind::Drop:
+        if (body.size() % sizeof(EntityId) == 0) {
+          for (std::size_t offset = 0; offset < body.size();
+               offset += sizeof(EntityId)) {
+            EntityId entityId;
+            std::memcpy(&entityId, body.data() + offset, sizeof(entityId));
+            // The entity may have moved and been published again since
+            auto it = ghosts_.find(entityId);
+            if (it != ghosts_.end() && it->second.Owner == from) {
+              ghosts_.erase(it);
+            }
+          }
+          return 0;
+        }
+        break;
+    }
+    return Reject();
+  }
+
+  std::size_t Restore(Payload snapshot) {
+    if (snapshot.Empty()) return 0;
+    for (auto const entityId : snapshot.Ids()) {
+      if (!manager_.GetEntity(entityId).expired()) return Reject();
+    }
+    auto const count = snapshot.Restore(manager_).size();
+    if (count == 0) {
+      pending_.push_back(std::move(snapshot));
+      return 0;
+    }
+    for (auto const entityId : snapshot.Ids()) ghosts_.erase(entityId);
+    return count;
+  }
+
+  std::size_t Reject() {
+    ++rejected_;
+    return 0;
+  }
+
+  template <typename ComponentType>
+  static std::optional<ComponentType> ToOptional(
+      ComponentType const* component) {
+    if (!component) return {};
+    return *component;
+  }
+
+ private:
+  ShardId const id_;
+  Manager& manager_;
+  std::shared_ptr<ComponentManager> componentManager_;
+  std::unique_ptr<Transport> transport_;
+  // Shards holding ghosts of entities living here
+  std::unordered_map<EntityId, std::unordered_set<ShardId>> subscribers_;
+  std::unordered_map<EntityId, Ghost> ghosts_;
+  std::vector<Payload> pending_;
+  std::vector<EntityId> skipped_;
+  std::size_t rejected_ = 0;
+};
\ No newline at end of file
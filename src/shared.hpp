@@ -0,0 +1,210 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hash.hpp"
+#include "pool.hpp"
+
+// Opt-in trait that stores each distinct value of a component once, for
+// large immutable data many entities have in common (mesh descriptors, AI
+// configs):
+//
+//   template <>
+//   struct ShareValues<MeshDesc> : std::true_type {};
+//
+// Values need operator== and either a std::hash specialisation or a byte
+// representation without padding
+template <typename ComponentType>
+struct ShareValues : std::false_type {};
+
+template <typename ComponentType>
+concept SharedComponent = ShareValues<ComponentType>::value &&
+                          std::equality_comparable<ComponentType>;
+
+// What pointers handed out for a component point at. A shared value is used
+// by many entities and indexed by its hash, so it is read only and can only
+// be changed by replacing the entity's component
+template <typename ComponentType>
+using ComponentAccess =
+    std::conditional_t<SharedComponent<ComponentType>, ComponentType const,
+                       ComponentType>;
+
+template <typename ComponentType>
+std::size_t HashShared(ComponentType const& value) {
+  if constexpr (requires { std::hash<ComponentType>{}(value); }) {
+    return std::hash<ComponentType>{}(value);
+  } else {
+    static_assert(std::has_unique_object_representations_v<ComponentType>,
+                  "Specialise std::hash for this shared component");
+    return HashBytes(&value, sizeof(ComponentType), 0);
+  }
+}
+
+// Hash-consed pool: adding a value equal to one already stored only records
+// an index to it. Each value remembers which data ids use it so queries can
+// visit entities grouped by value, and is freed with its last user.
+// Values are only handed out const, so they are changed through Assign
+template <typename ComponentType>
+class SharedPool : public ComponentPoolBase {
+  using ValueIndex = uint32_t;
+
+  struct Value {
+    std::shared_ptr<ComponentType const> Component;
+    std::size_t Hash = 0;
+    std::vector<DataId> Users;
+  };
+
+  // What each component amounts to: its value and where it sits in the
+  // value's user list
+  struct Slot {
+    ValueIndex Value;
+    uint32_t Position;
+  };
+
+ public:
+  template <typename... Args>
+  DataId Emplace(Args&&... args) {
+    auto const dataId = nextDataId_++;
+    Attach(dataId, Intern(ComponentType(std::forward<Args>(args)...)));
+    return dataId;
+  }
+
+  DataId Add(ComponentType&& data) { return Emplace(std::move(data)); }
+
+  void Reserve(std::size_t const count) {
+    slots_.reserve(slots_.size() + count);
+  }
+
+  // Points the component at another value, keeping its data id
+  void Assign(DataId const dataId, ComponentType&& component) {
+    // Checked first, so a stale id doesn't intern a value nothing uses
+    auto it = slots_.find(dataId);
+    if (it == slots_.end()) return;
+    auto const value = Intern(std::move(component));
+    if (it->second.Value == value) return;
+    Detach(dataId);
+    Attach(dataId, value);
+  }
+
+  std::weak_ptr<ComponentType const> Get(DataId const dataId) const {
+    auto it = slots_.find(dataId);
+    if (it == slots_.end()) return {};
+    return values_[it->second.Value].Component;
+  }
+
+  ComponentType const* Find(DataId const dataId) const {
+    auto it = slots_.find(dataId);
+    if (it == slots_.end()) return nullptr;
+    return values_[it->second.Value].Component.get();
+  }
+
+  bool Contains(DataId const dataId) const override {
+    return slots_.contains(dataId);
+  }
+
+  void Remove(DataId const dataId) override { Detach(dataId); }
+
+  std::size_t Size() const override { return slots_.size(); }
+  // Nothing is laid out by slot, so there are never holes
+  std::size_t Capacity() const override { return slots_.size(); }
+  void Compact(std::vector<DataId> const& = {}, bool const = true) override {}
+  std::size_t CompactStep(std::size_t const) override { return 0; }
+
+  // Number of distinct values stored
+  std::size_t Distinct() const { return values_.size() - free_.size(); }
+
+  // Visits components grouped by value
+  template <typename Func>
+  void ForEach(Func&& func) const {
+    for (auto const& value : values_) {
+      for (auto const dataId : value.Users) func(dataId, *value.Component);
+    }
+  }
+
+  // Calls func(ComponentType const&, std::span<DataId const>) per value
+  template <typename Func>
+  void ForEachValue(Func&& func) const {
+    for (auto const& value : values_) {
+      if (!value.Users.empty()) {
+        func(*value.Component, std::span<DataId const>(value.Users));
+      }
+    }
+  }
+
+ protected:
+  ValueIndex Intern(ComponentType&& component) {
+    auto const hash = HashShared(component);
+    auto [begin, end] = index_.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+      if (*values_[it->second].Component == component) return it->second;
+    }
+
+    auto const value = NewValue();
+    values_[value].Component =
+        std::make_shared<ComponentType const>(std::move(component));
+    values_[value].Hash = hash;
+    index_.insert({hash, value});
+    return value;
+  }
+
+  ValueIndex NewValue() {
+    if (!free_.empty()) {
+      auto const value = free_.back();
+      free_.pop_back();
+      return value;
+    }
+    values_.emplace_back();
+    return static_cast<ValueIndex>(values_.size() - 1);
+  }
+
+  void Attach(DataId const dataId, ValueIndex const value) {
+    auto& users = values_[value].Users;
+    slots_.insert_or_assign(
+        dataId, Slot{value, static_cast<uint32_t>(users.size())});
+    users.push_back(dataId);
+  }
+
+  // Swaps the last user into the hole and frees the value with its last user
+  void Detach(DataId const dataId) {
+    auto it = slots_.find(dataId);
+    if (it == slots_.end()) return;
+
+    auto const [value, position] = it->second;
+    slots_.erase(it);
+    auto& entry = values_[value];
+    if (position + 1 != entry.Users.size()) {
+      auto const moved = entry.Users.back();
+      entry.Users[position] = moved;
+      slots_.at(moved).Position = position;
+    }
+    entry.Users.pop_back();
+    if (!entry.Users.empty()) return;
+
+    auto [begin, end] = index_.equal_range(entry.Hash);
+    for (auto indexIt = begin; indexIt != end; ++indexIt) {
+      if (indexIt->second == value) {
+        index_.erase(indexIt);
+        break;
+      }
+    }
+    // Pointers already locked from Get keep the value alive
+    entry.Component.reset();
+    entry.Users.shrink_to_fit();
+    free_.push_back(value);
+  }
+
+ private:
+  std::vector<Value> values_;
+  std::vector<ValueIndex> free_;
+  std::unordered_multimap<std::size_t, ValueIndex> index_;
+  std::unordered_map<DataId, Slot> slots_;
+  DataId nextDataId_ = 0;
+};
\ No newline at end of file
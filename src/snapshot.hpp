@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "manager.hpp"
+
+// Copies of the listed components of a set of entities, one column per type,
+// that can be turned into bytes and recreated later or in another world under
+// the same ids. Components are copied as raw bytes tagged with their type's
+// hash, so the bytes are only meaningful to the same build of the program
+template <typename... ComponentTypes>
+class Snapshot {
+  static_assert((std::is_trivially_copyable_v<ComponentTypes> && ...),
+                "Snapshot components are copied as raw bytes");
+
+ public:
+  using EntityId = Entity::Id;
+
+  // Entities that don't exist are recorded without components
+  static Snapshot Capture(Manager& manager,
+                          ComponentManager& componentManager,
+                          std::vector<EntityId> ids) {
+    Snapshot snapshot;
+    snapshot.ids_ = std::move(ids);
+    snapshot.enabled_.reserve(snapshot.ids_.size());
+    for (auto const entityId : snapshot.ids_) {
+      auto const entity = manager.GetEntity(entityId).lock();
+      snapshot.enabled_.push_back(entity && entity->GetIsEnabled());
+    }
+    std::apply(
+        [&](auto&... columns) {
+          (snapshot.Gather(componentManager, columns), ...);
+        },
+        snapshot.columns_);
+    return snapshot;
+  }
+
+  std::vector<EntityId> const& Ids() const { return ids_; }
+  bool Empty() const { return ids_.empty(); }
+
+  // Calls func(EntityId, bool isEnabled, ComponentTypes const*...) per
+  // entity, with nullptr for components it doesn't have
+  template <typename Func>
+  void ForEach(Func&& func) const {
+    std::array<std::size_t, sizeof...(ComponentTypes)> cursors{};
+    for (uint32_t row = 0; row < ids_.size(); ++row) {
+      auto next = [&]<std::size_t Index>() {
+        auto const& column = std::get<Index>(columns_);
+        auto& cursor = cursors[Index];
+        if (cursor < column.Rows.size() && column.Rows[cursor] == row) {
+          return &column.Values[cursor++];
+        }
+        return static_cast<decltype(&column.Values[0])>(nullptr);
+      };
+      [&]<std::size_t... Indices>(std::index_sequence<Indices...>) {
+        func(ids_[row], enabled_[row] != 0,
+             next.template operator()<Indices>()...);
+      }(std::index_sequence_for<ComponentTypes...>{});
+    }
+  }
+
+  // Recreates the entities in manager under their ids, adding each component
+  // type in one bulk insert, and moves the values out. Returns the entities,
+  // or none if rejected because a read phase is active
+  std::vector<std::weak_ptr<Entity>> Restore(Manager& manager) {
+    auto const entities = manager.Restore(
+        ids_, [&](ComponentManager& componentManager,
+                  ComponentManager::WriteScope const& write, auto&& attach) {
+          std::apply(
+              [&](auto&... columns) {
+                (Insert(componentManager, write, columns, attach), ...);
+              },
+              columns_);
+        });
+
+    for (std::size_t i = 0; i < entities.size(); ++i) {
+      if (enabled_[i]) continue;
+      if (auto entity = entities[i].lock()) entity->SetIsEnabled(false);
+    }
+    return entities;
+  }
+
+  void Encode(std::vector<uint8_t>& bytes) const {
+    auto put = [&](void const* data, std::size_t const size) {
+      auto const* begin = static_cast<uint8_t const*>(data);
+      bytes.insert(bytes.end(), begin, begin + size);
+    };
+    auto const count = static_cast<uint32_t>(ids_.size());
+    put(&count, sizeof(count));
+    put(ids_.data(), count * sizeof(EntityId));
+    put(enabled_.data(), count);
+
+    auto encode = [&]<typename ComponentType>(
+                      Column<ComponentType> const& column) {
+      uint64_t const type = ComponentManager::GetTypeId<ComponentType>();
+      uint32_t const size = sizeof(ComponentType);
+      auto const rows = static_cast<uint32_t>(column.Rows.size());
+      put(&type, sizeof(type));
+      put(&size, sizeof(size));
+      put(&rows, sizeof(rows));
+      put(column.Rows.data(), rows * sizeof(uint32_t));
+      put(column.Values.data(), rows * sizeof(ComponentType));
+    };
+    std::apply([&](auto const&... columns) { (encode(columns), ...); },
+               columns_);
+  }
+
+  // Fails unless bytes hold exactly one snapshot of the same types
+  static std::optional<Snapshot> Decode(std::span<uint8_t const> bytes) {
+    auto take = [&](void* data, std::size_t const size) {
+      if (bytes.size() < size) return false;
+      if (size > 0) std::memcpy(data, bytes.data(), size);
+      bytes = bytes.subspan(size);
+      return true;
+    };
+
+    Snapshot snapshot;
+    uint32_t count;
+    if (!take(&count, sizeof(count)) ||
+        bytes.size() < std::size_t{count} * (sizeof(EntityId) + 1)) {
+      return {};
+    }
+    snapshot.ids_.resize(count);
+    snapshot.enabled_.resize(count);
+    take(snapshot.ids_.data(), count * sizeof(EntityId));
+    take(snapshot.enabled_.data(), count);
+
+    auto decode = [&]<typename ComponentType>(Column<ComponentType>& column) {
+      uint64_t type;
+      uint32_t size;
+      uint32_t rows;
+      if (!take(&type, sizeof(type)) || !take(&size, sizeof(size)) ||
+          !take(&rows, sizeof(rows)) ||
+          type != ComponentManager::GetTypeId<ComponentType>() ||
+          size != sizeof(ComponentType) ||
+          bytes.size() < std::size_t{rows} * (sizeof(uint32_t) + size)) {
+        return false;
+      }
+      column.Rows.resize(rows);
+      take(column.Rows.data(), rows * sizeof(uint32_t));
+      column.Values.reserve(rows);
+      for (uint32_t i = 0; i < rows; ++i) {
+        // Rows must ascend for ForEach to find them
+        if (column.Rows[i] >= count ||
+            (i > 0 && column.Rows[i] <= column.Rows[i - 1])) {
+          return false;
+        }
+        std::array<uint8_t, sizeof(ComponentType)> raw;
+        take(raw.data(), raw.size());
+        column.Values.push_back(std::bit_cast<ComponentType>(raw));
+      }
+      return true;
+    };
+    auto const valid = std::apply(
+        [&](auto&... columns) { return (decode(columns) && ...); },
+        snapshot.columns_);
+    if (!valid || !bytes.empty()) return {};
+    return snapshot;
+  }
+
+ protected:
+  template <typename ComponentType>
+  struct Column {
+    // Indices into ids_ of the entities that have the component, ascending
+    std::vector<uint32_t> Rows;
+    std::vector<ComponentType> Values;
+  };
+
+  template <typename ComponentType>
+  void Gather(ComponentManager& componentManager,
+              Column<ComponentType>& column) const {
+    for (uint32_t row = 0; row < ids_.size(); ++row) {
+      auto const value =
+          componentManager.GetByEntity<ComponentType>(ids_[row], false)
+              .lock();
+      if (!value) continue;
+      column.Rows.push_back(row);
+      column.Values.push_back(*value);
+    }
+  }
+
+  template <typename ComponentType, typename Attach>
+  void Insert(ComponentManager& componentManager,
+              ComponentManager::WriteScope const& write,
+              Column<ComponentType>& column, Attach& attach) const {
+    std::vector<EntityId> entityIds;
+    entityIds.reserve(column.Rows.size());
+    for (auto const row : column.Rows) entityIds.push_back(ids_[row]);
+
+    auto const handles = componentManager.InsertMany<ComponentType>(
+        write, entityIds, std::move(column.Values));
+    for (std::size_t i = 0; i < handles.size(); ++i) {
+      attach(column.Rows[i], handles[i]);
+    }
+  }
+
+ private:
+  std::vector<EntityId> ids_;
+  std::vector<uint8_t> enabled_;
+  std::tuple<Column<ComponentTypes>...> columns_;
+};
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pool.hpp"
+
+// Opt-in trait that stores a component field by field. Specialise it with a
+// tuple of member pointers covering every field:
+//
+//   template <>
+//   struct SoaLayout<Transform> {
+//     static constexpr auto Fields = std::make_tuple(
+//         &Transform::Position, &Transform::Rotation, &Transform::Scale);
+//   };
+template <typename ComponentType>
+struct SoaLayout {};
+
+template <typename ComponentType>
+concept SoaComponent = requires { SoaLayout<ComponentType>::Fields; };
+
+template <auto Member>
+struct MemberField;
+template <typename Class, typename Field, Field Class::*Member>
+struct MemberField<Member> {
+  using type = Field;
+};
+
+template <typename ComponentType>
+class SoaPool;
+
+// Stands in for a component stored in a SoaPool. Valid until a component of
+// the type is added, removed, enabled or disabled
+template <typename ComponentType>
+class SoaRef {
+ public:
+  SoaRef() = default;
+  SoaRef(SoaPool<ComponentType>* pool, std::size_t const slot)
+      : pool_(pool), slot_(slot) {}
+
+  explicit operator bool() const { return pool_ != nullptr; }
+
+  template <auto Member>
+  typename MemberField<Member>::type& Get() const {
+    return pool_->template Column<Member>()[slot_];
+  }
+
+  ComponentType Load() const { return pool_->Load(slot_); }
+  void Store(ComponentType const& component) const {
+    pool_->Store(slot_, component);
+  }
+
+ private:
+  SoaPool<ComponentType>* pool_ = nullptr;
+  std::size_t slot_ = 0;
+};
+
+// Keeps each field of a component in its own array, so kernels touching one
+// field only stream that field. Always packed, with enabled components before
+// disabled ones; removing swaps the last component into the hole
+template <typename ComponentType>
+class SoaPool : public ComponentPoolBase {
+  static constexpr auto const& kFields = SoaLayout<ComponentType>::Fields;
+  using Fields = std::remove_cvref_t<decltype(kFields)>;
+  static constexpr auto kFieldCount = std::tuple_size_v<Fields>;
+
+  template <std::size_t... Indices>
+  static auto MakeColumns(std::index_sequence<Indices...>)
+      -> std::tuple<std::vector<typename MemberField<
+          std::get<Indices>(SoaLayout<ComponentType>::Fields)>::type>...>;
+
+ public:
+  using EntityId = int32_t;
+
+  template <typename... Args>
+  DataId Emplace(Args&&... args) {
+    auto const dataId = nextDataId_++;
+    ComponentType const component(std::forward<Args>(args)...);
+    ForEachField([&]<std::size_t Index>() {
+      std::get<Index>(columns_).push_back(
+          component.*std::get<Index>(kFields));
+    });
+    slots_.insert({dataId, dataIds_.size()});
+    dataIds_.push_back(dataId);
+    entities_.push_back(EntityId{-1});
+    return dataId;
+  }
+
+  void Reserve(std::size_t const count) {
+    ForEachField([&]<std::size_t Index>() {
+      std::get<Index>(columns_).reserve(dataIds_.size() + count);
+    });
+    dataIds_.reserve(dataIds_.size() + count);
+    entities_.reserve(entities_.size() + count);
+  }
+
+  // Owner of each slot, so spans can be handed out with their entities
+  void SetEntity(DataId const dataId, EntityId const entityId) {
+    entities_[slots_.at(dataId)] = entityId;
+  }
+
+  bool Contains(DataId const dataId) const override {
+    return slots_.contains(dataId);
+  }
+
+  void Remove(DataId const dataId) override {
+    auto it = slots_.find(dataId);
+    if (it == slots_.end()) return;
+
+    auto slot = it->second;
+    if (slot < enabled_) {
+      Swap(slot, --enabled_);
+      slot = enabled_;
+    }
+    Swap(slot, dataIds_.size() - 1);
+    ForEachField(
+        [&]<std::size_t Index>() { std::get<Index>(columns_).pop_back(); });
+    dataIds_.pop_back();
+    entities_.pop_back();
+    slots_.erase(dataId);
+  }
+
+  void SetIsEnabled(DataId const dataId, bool const isEnabled) override {
+    auto it = slots_.find(dataId);
+    if (it == slots_.end()) return;
+
+    auto const slot = it->second;
+    if (isEnabled && slot >= enabled_) {
+      Swap(slot, enabled_++);
+    } else if (!isEnabled && slot < enabled_) {
+      Swap(slot, --enabled_);
+    }
+  }
+
+  std::size_t Size() const override { return dataIds_.size(); }
+  std::size_t Capacity() const override { return dataIds_.size(); }
+  std::size_t EnabledSize() const { return enabled_; }
+
+  // Always packed
+  void Compact(std::vector<DataId> const& = {}, bool const = true) override {}
+  std::size_t CompactStep(std::size_t const) override { return 0; }
+
+  SoaRef<ComponentType> Get(DataId const dataId) {
+    auto it = slots_.find(dataId);
+    return it != slots_.end() ? SoaRef<ComponentType>{this, it->second}
+                              : SoaRef<ComponentType>{};
+  }
+
+  template <auto Member>
+  std::vector<typename MemberField<Member>::type>& Column() {
+    return std::get<IndexOf<Member>()>(columns_);
+  }
+
+  // Entities of the first count slots
+  std::span<EntityId const> Entities(std::size_t const count) const {
+    return {entities_.data(), count};
+  }
+
+  template <auto Member>
+  std::span<typename MemberField<Member>::type> Span(std::size_t const count) {
+    return {Column<Member>().data(), count};
+  }
+
+  ComponentType Load(std::size_t const slot) const {
+    ComponentType component{};
+    ForEachField([&]<std::size_t Index>() {
+      component.*std::get<Index>(kFields) = std::get<Index>(columns_)[slot];
+    });
+    return component;
+  }
+
+  void Store(std::size_t const slot, ComponentType const& component) {
+    ForEachField([&]<std::size_t Index>() {
+      std::get<Index>(columns_)[slot] = component.*std::get<Index>(kFields);
+    });
+  }
+
+ protected:
+  template <typename Func>
+  static void ForEachField(Func&& func) {
+    [&]<std::size_t... Indices>(std::index_sequence<Indices...>) {
+      (func.template operator()<Indices>(), ...);
+    }(std::make_index_sequence<kFieldCount>{});
+  }
+
+  template <auto Member, std::size_t Index = 0>
+  static constexpr std::size_t IndexOf() {
+    static_assert(Index < kFieldCount, "Member is not in the SoaLayout");
+    if constexpr (std::is_same_v<decltype(Member),
+                                 std::tuple_element_t<Index, Fields>>) {
+      if constexpr (Member == std::get<Index>(kFields)) {
+        return Index;
+      } else {
+        return IndexOf<Member, Index + 1>();
+      }
+    } else {
+      return IndexOf<Member, Index + 1>();
+    }
+  }
+
+  void Swap(std::size_t const lhs, std::size_t const rhs) {
+    if (lhs == rhs) return;
+    ForEachField([&]<std::size_t Index>() {
+      auto& column = std::get<Index>(columns_);
+      std::swap(column[lhs], column[rhs]);
+    });
+    std::swap(dataIds_[lhs], dataIds_[rhs]);
+    std::swap(entities_[lhs], entities_[rhs]);
+    slots_[dataIds_[lhs]] = lhs;
+    slots_[dataIds_[rhs]] = rhs;
+  }
+
+ private:
+  decltype(MakeColumns(std::make_index_sequence<kFieldCount>{})) columns_;
+  std::vector<DataId> dataIds_;
+  std::vector<EntityId> entities_;
+  std::unordered_map<DataId, std::size_t> slots_;
+  std::size_t enabled_ = 0;
+  DataId nextDataId_ = 0;
+};
\ No newline at end of file
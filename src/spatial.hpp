@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.hpp"
+
+// Uniform grid over entity positions for radius queries. Cells are hashed so
+// the world needs no bounds, and an entity only moves between cell lists when
+// it crosses a cell boundary, so refreshing mostly static positions is cheap.
+class SpatialGrid {
+ public:
+  using EntityId = int32_t;
+  using Point = std::array<float, 3>;
+
+  explicit SpatialGrid(float const cellSize = 1.0f) : cellSize_(cellSize) {}
+
+  float GetCellSize() const { return cellSize_; }
+
+  // Inserts the entity or moves it to a new position
+  void Set(EntityId const entityId, Point const& position) {
+    auto const cell = GetCoords(position);
+    auto it = entries_.find(entityId);
+    if (it != entries_.end()) {
+      it->second.Position = position;
+      if (it->second.Cell == cell) return;
+      RemoveFromCell(entityId, it->second);
+    } else {
+      it = entries_.insert({entityId, {cell, position, 0}}).first;
+    }
+
+    auto& entities = cells_[cell];
+    it->second.Cell = cell;
+    it->second.Index = entities.size();
+    entities.push_back(entityId);
+  }
+
+  void Remove(EntityId const entityId) {
+    auto it = entries_.find(entityId);
+    if (it != entries_.end()) {
+      RemoveFromCell(entityId, it->second);
+      entries_.erase(it);
+    }
+  }
+
+  bool Contains(EntityId const entityId) const {
+    return entries_.contains(entityId);
+  }
+
+  std::size_t Size() const { return entries_.size(); }
+
+  void Clear() {
+    cells_.clear();
+    entries_.clear();
+  }
+
+  // Calls func(EntityId, Point) for every entity within radius of center.
+  // Visits the cells the radius overlaps, or every occupied cell when there
+  // are fewer of those
+  template <typename Func>
+  void ForEachInRadius(Point const& center, float const radius,
+                       Func&& func) const {
+    auto const low = GetCoords({center[0] - radius, center[1] - radius,
+                                center[2] - radius});
+    auto const high = GetCoords({center[0] + radius, center[1] + radius,
+                                 center[2] + radius});
+    auto const radiusSquared = radius * radius;
+    auto visit = [&](std::vector<EntityId> const& entities) {
+      for (auto const entityId : entities) {
+        auto const& position = entries_.at(entityId).Position;
+        if (DistanceSquared(center, position) <= radiusSquared) {
+          func(entityId, position);
+        }
+      }
+    };
+
+    double boxCells = 1.0;
+    for (int axis = 0; axis < 3; ++axis) {
+      boxCells *= static_cast<double>(high[axis]) - low[axis] + 1.0;
+    }
+    if (boxCells > static_cast<double>(cells_.size())) {
+      for (auto const& [cell, entities] : cells_) {
+        if (Inside(cell, low, high)) visit(entities);
+      }
+      return;
+    }
+
+    for (int64_t x = low[0]; x <= high[0]; ++x) {
+      for (int64_t y = low[1]; y <= high[1]; ++y) {
+        for (int64_t z = low[2]; z <= high[2]; ++z) {
+          auto it = cells_.find({static_cast<int32_t>(x),
+                                 static_cast<int32_t>(y),
+                                 static_cast<int32_t>(z)});
+          if (it != cells_.end()) visit(it->second);
+        }
+      }
+    }
+  }
+
+ protected:
+  using Coords = std::array<int32_t, 3>;
+
+  struct CoordsHash {
+    std::size_t operator()(Coords const& coords) const {
+      auto const xy = static_cast<uint64_t>(static_cast<uint32_t>(coords[0]))
+                          << 32 |
+                      static_cast<uint32_t>(coords[1]);
+      return MixHash(xy ^ MixHash(static_cast<uint32_t>(coords[2])));
+    }
+  };
+
+  struct Entry {
+    Coords Cell;
+    Point Position;
+    // Position in the cell's entity list
+    std::size_t Index;
+  };
+
+  static float DistanceSquared(Point const& lhs, Point const& rhs) {
+    auto const dx = lhs[0] - rhs[0];
+    auto const dy = lhs[1] - rhs[1];
+    auto const dz = lhs[2] - rhs[2];
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  static bool Inside(Coords const& cell, Coords const& low,
+                     Coords const& high) {
+    for (int axis = 0; axis < 3; ++axis) {
+      if (cell[axis] < low[axis] || cell[axis] > high[axis]) return false;
+    }
+    return true;
+  }
+
+  // Positions beyond the int32 range of cells are clamped to the edge cells
+  Coords GetCoords(Point const& position) const {
+    Coords coords;
+    for (int axis = 0; axis < 3; ++axis) {
+      coords[axis] = static_cast<int32_t>(
+          std::clamp(std::floor(double{position[axis]} / cellSize_),
+                     double{INT32_MIN}, double{INT32_MAX}));
+    }
+    return coords;
+  }
+
+  // Swaps the last entity of the cell into the gap
+  void RemoveFromCell(EntityId const entityId, Entry const& entry) {
+    auto it = cells_.find(entry.Cell);
+    auto& entities = it->second;
+    auto const last = entities.back();
+    entities[entry.Index] = last;
+    if (last != entityId) entries_.at(last).Index = entry.Index;
+    entities.pop_back();
+    if (entities.empty()) cells_.erase(it);
+  }
+
+ private:
+  float cellSize_;
+  std::unordered_map<Coords, std::vector<EntityId>, CoordsHash> cells_;
+  std::unordered_map<EntityId, Entry> entries_;
+};
\ No newline at end of file
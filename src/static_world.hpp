@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "query.hpp"
+#include "system.hpp"
+
+// Sparse set storage for one component type of a StaticWorld. Components are
+// packed densely and found through an entity indexed table, so lookups are an
+// array index rather than a hash
+template <typename ComponentType>
+class StaticStorage {
+ public:
+  using EntityId = int32_t;
+
+  bool Contains(EntityId const entityId) const {
+    auto const index = static_cast<std::size_t>(entityId);
+    return index < sparse_.size() && sparse_[index] != kNone;
+  }
+
+  // Replaces the component in place if the entity already has one
+  template <typename... Args>
+  ComponentType& Emplace(EntityId const entityId, Args&&... args) {
+    if (auto* component = Find(entityId)) {
+      *component = ComponentType(std::forward<Args>(args)...);
+      return *component;
+    }
+
+    auto const index = static_cast<std::size_t>(entityId);
+    if (index >= sparse_.size()) sparse_.resize(index + 1, kNone);
+    sparse_[index] = dense_.size();
+    entities_.push_back(entityId);
+    return dense_.emplace_back(std::forward<Args>(args)...);
+  }
+
+  ComponentType* Find(EntityId const entityId) {
+    return Contains(entityId) ? &dense_[sparse_[entityId]] : nullptr;
+  }
+
+  ComponentType const* Find(EntityId const entityId) const {
+    return Contains(entityId) ? &dense_[sparse_[entityId]] : nullptr;
+  }
+
+  // Moves the last component into the hole
+  void Remove(EntityId const entityId) {
+    if (!Contains(entityId)) return;
+
+    auto const index = sparse_[entityId];
+    if (index != dense_.size() - 1) {
+      dense_[index] = std::move(dense_.back());
+      entities_[index] = entities_.back();
+      sparse_[entities_[index]] = index;
+    }
+    dense_.pop_back();
+    entities_.pop_back();
+    sparse_[entityId] = kNone;
+  }
+
+  std::size_t Size() const { return dense_.size(); }
+
+  // Entities in the same order as their components
+  std::vector<EntityId> const& Entities() const { return entities_; }
+
+ private:
+  static constexpr std::size_t kNone = ~std::size_t{0};
+
+  std::vector<ComponentType> dense_;
+  std::vector<EntityId> entities_;
+  std::vector<std::size_t> sparse_;
+};
+
+// A world whose component types are fixed at compile time. Storages live in a
+// tuple and queries are resolved by template, so there is no type erasure,
+// hashing or event dispatch and a system's ForEach can inline down to array
+// accesses. Using a type outside Components is a compile error.
+//
+// ForEach takes the same terms as Manager::ForEach (see query.hpp) and calls
+// func(EntityId, T&...) with T* for Optional terms. func may change or remove
+// the current entity's components, or destroy it, but not those of others.
+//
+// Systems derive from System like Manager's and are constructed with
+// (StaticWorld&, args...)
+template <typename... Components>
+class StaticWorld {
+ public:
+  using EntityId = int32_t;
+
+  EntityId CreateEntity() {
+    alive_.push_back(true);
+    ++size_;
+    return static_cast<EntityId>(alive_.size() - 1);
+  }
+
+  void DestroyEntity(EntityId const entityId) {
+    if (!IsAlive(entityId)) return;
+    (GetStorage<Components>().Remove(entityId), ...);
+    alive_[entityId] = false;
+    --size_;
+  }
+
+  bool IsAlive(EntityId const entityId) const {
+    return entityId >= 0 &&
+           static_cast<std::size_t>(entityId) < alive_.size() &&
+           alive_[entityId];
+  }
+
+  // Live entities
+  std::size_t Size() const { return size_; }
+
+  template <typename ComponentType, typename... Args>
+  ComponentType* Emplace(EntityId const entityId, Args&&... args) {
+    if (!IsAlive(entityId)) return nullptr;
+    return &GetStorage<ComponentType>().Emplace(entityId,
+                                                std::forward<Args>(args)...);
+  }
+
+  template <typename ComponentType>
+  ComponentType* Add(EntityId const entityId, ComponentType component) {
+    return Emplace<ComponentType>(entityId, std::move(component));
+  }
+
+  template <typename ComponentType>
+  ComponentType* Get(EntityId const entityId) {
+    return GetStorage<ComponentType>().Find(entityId);
+  }
+
+  template <typename ComponentType>
+  bool Has(EntityId const entityId) const {
+    return GetStorage<ComponentType>().Contains(entityId);
+  }
+
+  template <typename ComponentType>
+  void Remove(EntityId const entityId) {
+    GetStorage<ComponentType>().Remove(entityId);
+  }
+
+  // Walks the smallest required storage backwards, so removing the current
+  // entity's components only moves already visited ones
+  template <typename... Terms, typename Func>
+  void ForEach(Func&& func) {
+    static_assert(HasRequiredTerm<Terms...>,
+                  "ForEach needs at least one required component");
+
+    std::vector<EntityId> const* driver = nullptr;
+    auto consider = [&]<typename Term>() {
+      if constexpr (QueryTerm<Term>::Required) {
+        auto const& entities =
+            GetStorage<typename QueryTerm<Term>::Component>().Entities();
+        if (!driver || entities.size() < driver->size()) driver = &entities;
+      }
+    };
+    (consider.template operator()<Terms>(), ...);
+
+    for (auto i = driver->size(); i-- > 0;) {
+      if (i >= driver->size()) continue;
+      auto const entityId = (*driver)[i];
+      if ((Matches<Terms>(entityId) && ...)) {
+        std::apply(func, std::tuple_cat(std::make_tuple(entityId),
+                                        Fetch<Terms>(entityId)...));
+      }
+    }
+  }
+
+  template <typename SystemClass, typename... Args>
+  System::Id AddSystem(Args&&... args) {
+    auto const id = System::GetId<SystemClass>();
+    for (auto const& system : systems_) {
+      if (system->GetId() == id) return id;
+    }
+    auto system =
+        std::make_unique<SystemClass>(*this, std::forward<Args>(args)...);
+    system->systemId_ = id;
+    systems_.push_back(std::move(system));
+    return id;
+  }
+
+  template <typename SystemClass>
+  void RemoveSystem() {
+    std::erase_if(systems_, [](auto const& system) {
+      return system->GetId() == System::GetId<SystemClass>();
+    });
+  }
+
+  // Ticks all systems in the order they were added
+  void Tick(double const deltaTime) {
+    for (auto const& system : systems_) system->Tick(deltaTime);
+  }
+
+  template <typename ComponentType>
+  StaticStorage<ComponentType>& GetStorage() {
+    static_assert((std::is_same_v<ComponentType, Components> || ...),
+                  "Component type is not part of this world");
+    return std::get<StaticStorage<ComponentType>>(storages_);
+  }
+
+  template <typename ComponentType>
+  StaticStorage<ComponentType> const& GetStorage() const {
+    static_assert((std::is_same_v<ComponentType, Components> || ...),
+                  "Component type is not part of this world");
+    return std::get<StaticStorage<ComponentType>>(storages_);
+  }
+
+ protected:
+  template <typename Term>
+  bool Matches(EntityId const entityId) const {
+    auto const& storage = GetStorage<typename QueryTerm<Term>::Component>();
+    if constexpr (QueryTerm<Term>::Required) {
+      return storage.Contains(entityId);
+    } else if constexpr (QueryTerm<Term>::Excluded) {
+      return !storage.Contains(entityId);
+    } else {
+      return true;
+    }
+  }
+
+  template <typename Term>
+  auto Fetch(EntityId const entityId) {
+    using ComponentType = typename QueryTerm<Term>::Component;
+    if constexpr (!QueryTerm<Term>::Fetched) {
+      return std::tuple<>{};
+    } else if constexpr (QueryTerm<Term>::Required) {
+      return std::tuple<ComponentType&>{*Get<ComponentType>(entityId)};
+    } else {
+      return std::tuple<ComponentType*>{Get<ComponentType>(entityId)};
+    }
+  }
+
+ private:
+  std::tuple<StaticStorage<Components>...> storages_;
+  std::vector<bool> alive_;
+  std::size_t size_ = 0;
+  std::vector<std::unique_ptr<System>> systems_;
+};
\ No newline at end of file
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "compression.hpp"
+#include "manager.hpp"
+#include "snapshot.hpp"
+#include "thread_pool.hpp"
+
+// Pages whole regions of the world out to disk and back. An entity belongs to
+// region regionOf(key) of its KeyType component, and paging a region out
+// evicts its entities, keeping their ids, and writes their KeyType and
+// ComponentTypes components to the region's file. Entities with any other
+// component would lose it, so they aren't paged out but stay in the world
+// and are reported by GetSkipped. Compression and file I/O
+// run on a background thread, and regions read back in are only restored by
+// Update, so the tick thread never waits on the disk.
+//
+// Regions are written as Snapshots, so the files are a cache for the running
+// program rather than a save format
+template <typename KeyType, typename... ComponentTypes>
+class RegionStreamer {
+ public:
+  using RegionId = uint64_t;
+  using EntityId = Entity::Id;
+  using RegionOf = std::function<RegionId(KeyType const&)>;
+
+  RegionStreamer(Manager& manager,
+                 std::shared_ptr<ComponentManager> componentManager,
+                 std::filesystem::path directory, RegionOf regionOf)
+      : manager_(manager),
+        componentManager_(std::move(componentManager)),
+        directory_(std::move(directory)),
+        regionOf_(std::move(regionOf)) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+  }
+
+  // Finishes outstanding writes, regions read but not yet restored are lost
+  ~RegionStreamer() { Flush(); }
+
+  RegionStreamer(RegionStreamer const&) = delete;
+  RegionStreamer& operator=(RegionStreamer const&) = delete;
+
+  // Evicts the region's entities and queues them to be written out. Entities
+  // frozen by cold storage are already compressed and stay where they are.
+  // Returns the number of entities paged out, none if a read phase is active
+  std::size_t PageOut(RegionId const region) {
+    ComponentManager::WriteScope write(*componentManager_);
+    if (!write) return 0;
+
+    std::vector<EntityId> inRegion;
+    componentManager_->ForEachComponent<KeyType>(
+        [&](EntityId const entityId, KeyType const& key) {
+          if (regionOf_(key) == region) inRegion.push_back(entityId);
+        },
+        false);
+
+    std::vector<EntityId> ids;
+    skipped_.clear();
+    for (auto const entityId : inRegion) {
+      auto const entity = manager_.GetEntity(entityId).lock();
+      // A key that can't be frozen (e.g. Soa) keeps the entity in the region
+      // while its other components sit in cold storage, out of capture's reach
+      if (!entity || componentManager_->IsFrozen(entityId)) continue;
+      if (entity->template HasOnlyComponents<KeyType, ComponentTypes...>()) {
+        ids.push_back(entityId);
+      } else {
+        skipped_.push_back(entityId);
+      }
+    }
+    if (ids.empty()) return 0;
+
+    auto block = Block::Capture(manager_, *componentManager_, std::move(ids));
+    auto const count = block.Ids().size();
+    manager_.Evict(write, block.Ids());
+    {
+      std::lock_guard lock(mutex_);
+      pagedOut_.insert(region);
+      ++writing_[region];
+    }
+    Submit([this, region, block = std::move(block)]() mutable {
+      bool const written = Write(region, block);
+      std::lock_guard lock(mutex_);
+      // Nothing reached the disk, so hand the entities straight back
+      if (!written) loaded_.push_back(std::move(block));
+      // Once the last write for the region is done, a region with no file
+      // has nothing left to page in
+      if (--writing_[region] == 0) {
+        writing_.erase(region);
+        std::error_code error;
+        if (!std::filesystem::exists(PathOf(region), error)) {
+          pagedOut_.erase(region);
+        }
+      }
+    });
+    return count;
+  }
+
+  // Queues the region's file to be read back. Its entities reappear on the
+  // first Update after the read finishes. If the file can't be read it is
+  // left alone and the region counts as paged out again. Returns false if the
+  // region isn't paged out
+  bool PageIn(RegionId const region) {
+    {
+      std::lock_guard lock(mutex_);
+      if (pagedOut_.erase(region) == 0) return false;
+    }
+    Submit([this, region] {
+      auto blocks = Read(region);
+      std::lock_guard lock(mutex_);
+      if (!blocks) {
+        unreadable_.push_back(region);
+        return;
+      }
+      for (auto& block : *blocks) loaded_.push_back(std::move(block));
+    });
+    return true;
+  }
+
+  bool IsPagedOut(RegionId const region) const {
+    std::lock_guard lock(mutex_);
+    return pagedOut_.contains(region);
+  }
+
+  // Entities the last PageOut left behind because they have components that
+  // aren't streamed
+  std::vector<EntityId> const& GetSkipped() const { return skipped_; }
+
+  // Restores every region that has finished reading, creating each region's
+  // components in bulk. Call from the tick thread, e.g. after Manager::Tick.
+  // Returns the number of entities restored
+  std::size_t Update() {
+    std::vector<Block> blocks;
+    {
+      std::lock_guard lock(mutex_);
+      blocks.swap(loaded_);
+      pagedOut_.insert(unreadable_.begin(), unreadable_.end());
+      unreadable_.clear();
+    }
+
+    std::size_t restored = 0;
+    for (auto& block : blocks) {
+      auto const count = block.Restore(manager_).size();
+      if (count == 0) {
+        // Rejected during a read phase, so try again next time
+        std::lock_guard lock(mutex_);
+        loaded_.push_back(std::move(block));
+      }
+      restored += count;
+    }
+    return restored;
+  }
+
+  // Waits for every queued write and read
+  void Flush() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&] { return pending_ == 0; });
+  }
+
+ protected:
+  using Block = Snapshot<KeyType, ComponentTypes...>;
+
+  static constexpr uint32_t kMagic = 0x47525243;  // "CRRG"
+
+  void Submit(std::function<void()> job) {
+    {
+      std::lock_guard lock(mutex_);
+      ++pending_;
+    }
+    io_.Submit([this, job = std::move(job)] {
+      job();
+      std::lock_guard lock(mutex_);
+      if (--pending_ == 0) idle_.notify_all();
+    });
+  }
+
+  std::filesystem::path PathOf(RegionId const region) const {
+    return directory_ / ("region_" + std::to_string(region) + ".bin");
+  }
+
+  // Each page out appends one compressed block to the region's file. A failed
+  // append is cut off again, so the blocks already there stay readable and
+  // later page outs don't land behind a torn block
+  bool Write(RegionId const region, Block const& block) const {
+    std::vector<uint8_t> raw;
+    block.Encode(raw);
+    auto const compressed = LzCompress(raw);
+    uint32_t const header[] = {kMagic, static_cast<uint32_t>(raw.size()),
+                               static_cast<uint32_t>(compressed.size())};
+
+    auto const path = PathOf(region);
+    std::error_code error;
+    auto const size = std::filesystem::file_size(path, error);
+    bool const existed = !error;
+    {
+      std::ofstream file(path, std::ios::binary | std::ios::app);
+      file.write(reinterpret_cast<char const*>(header), sizeof(header));
+      file.write(reinterpret_cast<char const*>(compressed.data()),
+                 compressed.size());
+      file.close();
+      if (file) return true;
+    }
+
+    if (existed) {
+      std::filesystem::resize_file(path, size, error);
+    } else {
+      std::filesystem::remove(path, error);
+    }
+    return false;
+  }
+
+  // The file is only deleted once every block in it has been decoded
+  std::optional<std::vector<Block>> Read(RegionId const region) const {
+    auto const path = PathOf(region);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return {};
+    std::vector<Block> blocks;
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> raw;
+
+    uint32_t header[3];
+    while (file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+      if (header[0] != kMagic) return {};
+      compressed.resize(header[2]);
+      if (!file.read(reinterpret_cast<char*>(compressed.data()),
+                     compressed.size()) ||
+          !LzDecompress(compressed, header[1], raw)) {
+        return {};
+      }
+      auto block = Block::Decode(raw);
+      if (!block) return {};
+      blocks.push_back(std::move(*block));
+    }
+    // Anything but a clean end means a torn or foreign trailing block
+    if (!file.eof() || file.gcount() != 0) return {};
+
+    file.close();
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return blocks;
+  }
+
+ private:
+  Manager& manager_;
+  std::shared_ptr<ComponentManager> componentManager_;
+  std::filesystem::path const directory_;
+  RegionOf const regionOf_;
+  std::vector<EntityId> skipped_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable idle_;
+  std::size_t pending_ = 0;
+  // A region whose writes all fail is dropped again by the I/O thread
+  std::unordered_set<RegionId> pagedOut_;
+  std::unordered_map<RegionId, std::size_t> writing_;
+  std::vector<Block> loaded_;
+  std::vector<RegionId> unreadable_;
+  // Last so the thread stops before anything it uses is destroyed
+  ThreadPool io_{1};
+};
\ No newline at end of file
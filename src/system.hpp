@@ -6,6 +6,17 @@ class System {
  public:
   using Id = uint64_t;
 
+  // Runs a system at a fixed rate instead of once per Manager::Tick. Each
+  // tick adds its delta to an accumulator and the system ticks with a delta
+  // of 1 / Hz for every whole step owed, at most MaxSteps times so one slow
+  // frame can't snowball. Staggered systems start at spread out phases so low
+  // rate systems don't all land on the same frame
+  struct Rate {
+    double Hz = 60.0;
+    unsigned MaxSteps = 4;
+    bool Stagger = true;
+  };
+
   virtual ~System() = default;
 
   virtual void Tick(double const deltaTime) = 0;
@@ -22,5 +33,7 @@ class System {
 
  private:
   friend class Manager;
+  template <typename... Components>
+  friend class StaticWorld;
   Id systemId_;
 };
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted jobs in order. Jobs not yet
+// started when the pool is destroyed are dropped.
+class ThreadPool {
+ public:
+  explicit ThreadPool(unsigned const threadCount) {
+    for (unsigned i = 0; i < threadCount; ++i) {
+      threads_.emplace_back([this] { Run(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  void Submit(std::function<void()> job) {
+    {
+      std::lock_guard lock(mutex_);
+      jobs_.push_back(std::move(job));
+    }
+    condition_.notify_one();
+  }
+
+  std::size_t Size() const { return threads_.size(); }
+
+ protected:
+  void Run() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock lock(mutex_);
+        condition_.wait(lock, [&] { return stopping_ || !jobs_.empty(); });
+        if (stopping_) return;
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      job();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> jobs_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// Every worker has its own queue. Jobs submitted from a worker go on its own
+// queue and are taken newest first, while idle workers steal the oldest jobs
+// from the others, so uneven jobs (a busy world next to an empty one) spread
+// over all threads. Jobs not yet started when the pool is destroyed are
+// dropped.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(unsigned const threadCount)
+      : queues_(std::max(threadCount, 1u)) {
+    for (auto& queue : queues_) queue = std::make_unique<Queue>();
+    for (std::size_t i = 0; i < queues_.size(); ++i) {
+      threads_.emplace_back([this, i] { Run(i); });
+    }
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  WorkStealingPool(WorkStealingPool const&) = delete;
+  WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+
+  void Submit(std::function<void()> job) {
+    auto const index = currentPool_ == this
+                           ? currentIndex_
+                           : nextQueue_++ % queues_.size();
+    {
+      std::lock_guard lock(queues_[index]->Mutex);
+      queues_[index]->Jobs.push_back(std::move(job));
+    }
+    {
+      std::lock_guard lock(mutex_);
+      ++pending_;
+    }
+    condition_.notify_one();
+  }
+
+  std::size_t Size() const { return threads_.size(); }
+
+ protected:
+  struct Queue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Jobs;
+  };
+
+  void Run(std::size_t const index) {
+    currentPool_ = this;
+    currentIndex_ = index;
+    while (true) {
+      {
+        std::unique_lock lock(mutex_);
+        condition_.wait(lock, [&] { return stopping_ || pending_ > 0; });
+        if (stopping_) return;
+      }
+
+      if (auto job = Take(index)) {
+        {
+          std::lock_guard lock(mutex_);
+          --pending_;
+        }
+        job();
+      }
+    }
+  }
+
+  // Own queue from the back, then the front of everyone else's
+  std::function<void()> Take(std::size_t const index) {
+    for (std::size_t i = 0; i < queues_.size(); ++i) {
+      auto& queue = *queues_[(index + i) % queues_.size()];
+      std::lock_guard lock(queue.Mutex);
+      if (queue.Jobs.empty()) continue;
+
+      std::function<void()> job;
+      if (i == 0) {
+        job = std::move(queue.Jobs.back());
+        queue.Jobs.pop_back();
+      } else {
+        job = std::move(queue.Jobs.front());
+        queue.Jobs.pop_front();
+      }
+      return job;
+    }
+    return {};
+  }
+
+ private:
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::atomic<std::size_t> nextQueue_ = 0;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::size_t pending_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+
+  inline static thread_local WorkStealingPool* currentPool_ = nullptr;
+  inline static thread_local std::size_t currentIndex_ = 0;
+};
\ No newline at end of file
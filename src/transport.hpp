@@ -0,0 +1,203 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Carries byte messages between shards. Messages between two shards arrive
+// in the order they were sent, but nothing is ordered across senders
+class Transport {
+ public:
+  using ShardId = uint32_t;
+  using Message = std::vector<uint8_t>;
+
+  virtual ~Transport() = default;
+
+  // Returns false if the message can't be delivered to shard to. True only
+  // means the transport has taken it
+  virtual bool Send(ShardId const to, Message const& message) = 0;
+  // Next message for this shard, never blocks
+  virtual std::optional<Message> Receive() = 0;
+};
+
+// Mailboxes for shards living in the same process, e.g. for tests
+class LoopbackNetwork {
+ public:
+  // Transport for shard, connect each shard once. Messages sent to a shard
+  // before it connects or after its transport is destroyed are refused
+  std::unique_ptr<Transport> Connect(Transport::ShardId const shard) {
+    {
+      std::lock_guard lock(state_->Mutex);
+      state_->Mailboxes[shard];
+    }
+    return std::make_unique<Endpoint>(state_, shard);
+  }
+
+ private:
+  struct State {
+    std::mutex Mutex;
+    std::unordered_map<Transport::ShardId, std::deque<Transport::Message>>
+        Mailboxes;
+  };
+
+  class Endpoint : public Transport {
+   public:
+    Endpoint(std::shared_ptr<State> state, ShardId const shard)
+        : state_(std::move(state)), shard_(shard) {}
+
+    ~Endpoint() override {
+      std::lock_guard lock(state_->Mutex);
+      state_->Mailboxes.erase(shard_);
+    }
+
+    bool Send(ShardId const to, Message const& message) override {
+      std::lock_guard lock(state_->Mutex);
+      auto it = state_->Mailboxes.find(to);
+      if (it == state_->Mailboxes.end()) return false;
+      it->second.push_back(message);
+      return true;
+    }
+
+    std::optional<Message> Receive() override {
+      std::lock_guard lock(state_->Mutex);
+      auto& mailbox = state_->Mailboxes[shard_];
+      if (mailbox.empty()) return {};
+      auto message = std::move(mailbox.front());
+      mailbox.pop_front();
+      return message;
+    }
+
+   private:
+    std::shared_ptr<State> state_;
+    ShardId const shard_;
+  };
+
+  std::shared_ptr<State> state_ = std::make_shared<State>();
+};
+
+// Sends length prefixed messages over connected stream sockets, one per peer.
+// Any connected socket will do (Unix or TCP, from connect or accept). Sockets
+// are non-blocking, so messages the kernel won't take yet are buffered and
+// written out on later calls to Send or Receive
+class SocketTransport : public Transport {
+ public:
+  SocketTransport() = default;
+  ~SocketTransport() override {
+    for (auto& [_, peer] : peers_) ::close(peer.Fd);
+  }
+
+  SocketTransport(SocketTransport const&) = delete;
+  SocketTransport& operator=(SocketTransport const&) = delete;
+
+  // Takes ownership of fd as the connection to shard peer
+  void Connect(ShardId const peer, int const fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (auto it = peers_.find(peer); it != peers_.end()) {
+      ::close(it->second.Fd);
+      peers_.erase(it);
+    }
+    peers_.insert({peer, Peer{fd}});
+  }
+
+  // Connects two transports with a Unix socket pair
+  static bool ConnectPair(SocketTransport& lhs, ShardId const lhsId,
+                          SocketTransport& rhs, ShardId const rhsId) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+    lhs.Connect(rhsId, fds[0]);
+    rhs.Connect(lhsId, fds[1]);
+    return true;
+  }
+
+  bool Send(ShardId const to, Message const& message) override {
+    auto it = peers_.find(to);
+    if (it == peers_.end() || it->second.Broken) return false;
+
+    auto& out = it->second.Out;
+    auto const size = static_cast<uint32_t>(message.size());
+    auto const* prefix = reinterpret_cast<uint8_t const*>(&size);
+    out.insert(out.end(), prefix, prefix + sizeof(size));
+    out.insert(out.end(), message.begin(), message.end());
+    Flush(it->second);
+    return !it->second.Broken;
+  }
+
+  std::optional<Message> Receive() override {
+    for (auto& [_, peer] : peers_) {
+      Flush(peer);
+      Fill(peer);
+      if (auto message = Pop(peer)) return message;
+    }
+    return {};
+  }
+
+ protected:
+  struct Peer {
+    int Fd;
+    bool Broken = false;
+    std::vector<uint8_t> In{};
+    std::vector<uint8_t> Out{};
+  };
+
+  static void Flush(Peer& peer) {
+    std::size_t written = 0;
+    while (!peer.Broken && written < peer.Out.size()) {
+      auto const sent =
+          ::send(peer.Fd, peer.Out.data() + written,
+                 peer.Out.size() - written, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (sent > 0) {
+        written += sent;
+      } else if (sent < 0 && errno == EINTR) {
+        continue;
+      } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      } else {
+        peer.Broken = true;
+      }
+    }
+    peer.Out.erase(peer.Out.begin(), peer.Out.begin() + written);
+  }
+
+  static void Fill(Peer& peer) {
+    uint8_t buffer[4096];
+    while (!peer.Broken) {
+      auto const received = ::recv(peer.Fd, buffer, sizeof(buffer), 0);
+      if (received > 0) {
+        peer.In.insert(peer.In.end(), buffer, buffer + received);
+      } else if (received < 0 && errno == EINTR) {
+        continue;
+      } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      } else {
+        // Closed by the other end, whole messages already read still count
+        peer.Broken = true;
+      }
+    }
+  }
+
+  static std::optional<Message> Pop(Peer& peer) {
+    uint32_t size;
+    if (peer.In.size() < sizeof(size)) return {};
+    std::memcpy(&size, peer.In.data(), sizeof(size));
+    if (peer.In.size() - sizeof(size) < size) return {};
+
+    auto const begin = peer.In.begin() + sizeof(size);
+    Message message(begin, begin + size);
+    peer.In.erase(peer.In.begin(), begin + size);
+    return message;
+  }
+
+ private:
+  std::unordered_map<ShardId, Peer> peers_;
+};
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "manager.hpp"
+#include "thread_pool.hpp"
+
+// Owns a set of independent worlds and ticks them side by side. Each world is
+// a full Manager with its own component manager, entity id space, events and
+// pool arenas, so worlds share nothing but the thread pool and never need to
+// lock against each other.
+class WorldRunner {
+ public:
+  using Index = std::size_t;
+
+  explicit WorldRunner(
+      unsigned const threadCount = std::thread::hardware_concurrency())
+      : pool_(threadCount) {}
+
+  Manager& AddWorld() {
+    return *worlds_.emplace_back(std::make_unique<Manager>());
+  }
+
+  Manager& GetWorld(Index const index) { return *worlds_.at(index); }
+  std::size_t Size() const { return worlds_.size(); }
+
+  // Removing a world shifts the indices of the ones after it
+  void RemoveWorld(Index const index) {
+    if (index < worlds_.size()) {
+      worlds_.erase(worlds_.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+  }
+
+  // Ticks every world once, each as its own job, and returns when all have
+  // finished. Worlds must not be added or removed while this runs. If a world
+  // throws the others still tick, and the first exception is rethrown here
+  void Tick(double const deltaTime) {
+    if (worlds_.empty()) return;
+
+    remaining_ = worlds_.size();
+    failure_ = nullptr;
+    for (auto& world : worlds_) {
+      pool_.Submit([this, &world, deltaTime] {
+        try {
+          world->Tick(deltaTime);
+        } catch (...) {
+          std::lock_guard lock(mutex_);
+          if (!failure_) failure_ = std::current_exception();
+        }
+        if (--remaining_ == 0) {
+          std::lock_guard lock(mutex_);
+          condition_.notify_all();
+        }
+      });
+    }
+
+    std::unique_lock lock(mutex_);
+    condition_.wait(lock, [&] { return remaining_ == 0; });
+    if (failure_) std::rethrow_exception(std::exchange(failure_, nullptr));
+  }
+
+ private:
+  std::vector<std::unique_ptr<Manager>> worlds_;
+  std::atomic<std::size_t> remaining_ = 0;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::exception_ptr failure_;
+  WorkStealingPool pool_;
+};
\ No newline at end of file
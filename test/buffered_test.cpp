@@ -0,0 +1,89 @@
+#include "buffered.hpp"
+
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+TEST_CASE("Buffered components") {
+  std::atomic<BufferEpoch> epoch = 1;
+  Buffered<int> value(3);
+  value.Bind(&epoch);
+
+  SECTION("Reads the initial value") { REQUIRE(3 == value.Read()); }
+
+  SECTION("Writes are read after the epoch advances") {
+    value.Write() = 4;
+    REQUIRE(3 == value.Read());
+    ++epoch;
+    REQUIRE(4 == value.Read());
+  }
+
+  SECTION("First write of an epoch starts from the previous value") {
+    value.Write() += 1;
+    value.Write() += 1;
+    ++epoch;
+    REQUIRE(5 == value.Read());
+    value.Write() += 1;
+    REQUIRE(5 == value.Read());
+    ++epoch;
+    REQUIRE(6 == value.Read());
+  }
+
+  SECTION("Unwritten values carry over") {
+    value.Write() = 4;
+    ++epoch;
+    ++epoch;
+    REQUIRE(4 == value.Read());
+  }
+}
+
+TEST_CASE("Buffered components in a manager") {
+  Manager manager;
+  std::vector<std::shared_ptr<Entity>> entities;
+  for (int i = 0; i < 64; ++i) {
+    entities.push_back(manager.CreateEntity().lock());
+    entities.back()->AddComponent<Buffered<TestComponent>>({{i}});
+  }
+
+  SECTION("Tick flips the buffers") {
+    auto component =
+        entities[0]->GetComponent<Buffered<TestComponent>>().lock();
+    component->Write().a = 100;
+    REQUIRE(0 == component->Read().a);
+    manager.Tick(0.1);
+    REQUIRE(100 == component->Read().a);
+  }
+
+  SECTION("Replaced components stay buffered") {
+    entities[0]->ReplaceComponent<Buffered<TestComponent>>(TestComponent{7});
+    auto component =
+        entities[0]->GetComponent<Buffered<TestComponent>>().lock();
+    component->Write().a = 8;
+    REQUIRE(7 == component->Read().a);
+    manager.Tick(0.1);
+    REQUIRE(8 == component->Read().a);
+  }
+
+  SECTION("Threads can read neighbours while writing") {
+    auto const size = static_cast<int>(entities.size());
+    {
+      auto phase = manager.BeginReadPhase();
+      phase.ParallelForEach<Buffered<TestComponent>>(
+          [&](Entity const& entity, Buffered<TestComponent> const& component) {
+            auto const* next = phase.GetByEntity<Buffered<TestComponent>>(
+                (entity.GetId() + 1) % size);
+            component.Write().a = next->Read().a;
+          },
+          4);
+    }
+    manager.Tick(0.1);
+
+    for (int i = 0; i < size; ++i) {
+      auto component =
+          entities[i]->GetComponent<Buffered<TestComponent>>().lock();
+      REQUIRE((i + 1) % size == component->Read().a);
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "checksum.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+namespace {
+using Checksum = ChecksumSystem<TestComponent, TestComponent2, TestTag>;
+
+uint64_t FullChecksum(std::shared_ptr<ComponentManager> const& manager,
+                      unsigned const threadCount = 1) {
+  return Checksum(nullptr, manager, threadCount).Compute();
+}
+}  // namespace
+
+TEST_CASE("Hashing bytes") {
+  int const values[3] = {1, 2, 3};
+  REQUIRE(HashBytes(values, sizeof(values), 0) ==
+          HashBytes(values, sizeof(values), 0));
+  REQUIRE(HashBytes(values, sizeof(values), 0) !=
+          HashBytes(values, sizeof(values), 1));
+  REQUIRE(HashBytes(values, sizeof(int), 0) !=
+          HashBytes(values, sizeof(int) * 2, 0));
+}
+
+TEST_CASE("World checksums") {
+  auto componentManager = std::make_shared<ComponentManager>();
+  Manager manager(componentManager);
+  std::vector<uint64_t> ticked;
+  manager.AddSystem<Checksum>(componentManager, 1u,
+                              [&](uint64_t checksum) {
+                                ticked.push_back(checksum);
+                              });
+  std::vector<std::shared_ptr<Entity>> entities;
+  for (int i = 0; i < 600; ++i) {
+    entities.push_back(manager.CreateEntity().lock());
+    entities.back()->AddComponent<TestComponent>({i});
+    if (i % 3 == 0) entities.back()->AddComponent<TestTag>({});
+  }
+  manager.Tick(0.1);
+  auto const initial = ticked.back();
+
+  SECTION("Doesn't depend on pool order") {
+    auto other = std::make_shared<ComponentManager>();
+    for (int i = 599; i >= 0; --i) {
+      other->Create<TestComponent>(i, {i});
+      if (i % 3 == 0) other->Create<TestTag>(i, {});
+    }
+    REQUIRE(initial == FullChecksum(other));
+  }
+
+  SECTION("Parallel computation matches") {
+    REQUIRE(initial == FullChecksum(componentManager, 3));
+  }
+
+  SECTION("A parallel checksum stays correct across computes") {
+    Checksum parallel(nullptr, componentManager, 3);
+    REQUIRE(initial == parallel.Compute());
+    entities[5]->AddComponent<TestComponent2>({1});
+    parallel.MarkChanged(entities[5]->GetId());
+    REQUIRE(FullChecksum(componentManager) == parallel.Compute());
+  }
+
+  SECTION("Follows added, replaced and removed components") {
+    entities[5]->AddComponent<TestComponent2>({1});
+    manager.Tick(0.1);
+    REQUIRE(initial != ticked.back());
+    REQUIRE(FullChecksum(componentManager) == ticked.back());
+
+    entities[5]->RemoveComponent<TestComponent2>();
+    manager.Tick(0.1);
+    REQUIRE(initial == ticked.back());
+
+    entities[300]->ReplaceComponent<TestComponent>(1000);
+    manager.Tick(0.1);
+    REQUIRE(initial != ticked.back());
+    REQUIRE(FullChecksum(componentManager) == ticked.back());
+  }
+
+  SECTION("Direct writes are picked up once marked") {
+    entities[450]->GetComponent<TestComponent>().lock()->a = -1;
+    manager.Tick(0.1);
+    REQUIRE(initial == ticked.back());
+
+    Checksum checksum(nullptr, componentManager);
+    checksum.Compute();
+    entities[450]->GetComponent<TestComponent>().lock()->a = 450;
+    checksum.MarkChanged(450);
+    REQUIRE(initial == checksum.Compute());
+  }
+
+  SECTION("Follows bulk inserts and removes") {
+    Prefab prefab;
+    prefab.Set(TestComponent{7}).Set(TestTag{});
+    manager.Instantiate(prefab, 3);
+    manager.Tick(0.1);
+    REQUIRE(initial != ticked.back());
+    REQUIRE(FullChecksum(componentManager) == ticked.back());
+
+    manager.Evict({10, 11, 12, 300});
+    manager.Tick(0.1);
+    REQUIRE(FullChecksum(componentManager) == ticked.back());
+
+    manager.Restore({10}, [](ComponentManager& components,
+                             auto const& write, auto&& attach) {
+      auto const handles = components.InsertMany<TestComponent>(
+          write, {10}, std::vector<TestComponent>{{10}});
+      attach(0, handles[0]);
+    });
+    manager.Tick(0.1);
+    REQUIRE(FullChecksum(componentManager) == ticked.back());
+  }
+
+  SECTION("Follows components moved to cold storage") {
+    manager.SetColdStorage(true);
+    entities[20]->SetIsEnabled(false);
+    manager.Tick(0.1);
+    REQUIRE(initial != ticked.back());
+    REQUIRE(FullChecksum(componentManager) == ticked.back());
+
+    entities[20]->SetIsEnabled(true);
+    manager.Tick(0.1);
+    REQUIRE(initial == ticked.back());
+  }
+
+  SECTION("Tags count towards the checksum") {
+    entities[1]->AddComponent<TestTag>({});
+    manager.Tick(0.1);
+    REQUIRE(initial != ticked.back());
+  }
+}
+
+TEST_CASE("Checksums over a high id range") {
+  auto componentManager = std::make_shared<ComponentManager>(
+      ComponentManager::Concurrency::SingleThreaded, 1 << 30);
+  std::vector<ComponentManager::EntityId> ids;
+  for (int i = 0; i < 600; ++i) {
+    ids.push_back(componentManager->NewEntityId());
+    componentManager->Create<TestComponent>(ids.back(), {i});
+  }
+  Checksum checksum(nullptr, componentManager);
+  auto const initial = checksum.Compute();
+
+  componentManager->Create<TestComponent2>(ids[300], {1});
+  checksum.MarkChanged(ids[300]);
+  REQUIRE(initial != checksum.Compute());
+  REQUIRE(FullChecksum(componentManager) == checksum.Compute());
+}
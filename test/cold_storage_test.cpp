@@ -0,0 +1,135 @@
+#include "cold_store.hpp"
+
+#include <string>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "component.hpp"
+#include "data.hpp"
+#include "entity.hpp"
+
+TEST_CASE("Compression") {
+  auto roundTrip = [](std::vector<uint8_t> const& input) {
+    auto const compressed = LzCompress(input);
+    std::vector<uint8_t> output;
+    REQUIRE(LzDecompress(compressed, input.size(), output));
+    REQUIRE(input == output);
+    return compressed.size();
+  };
+
+  SECTION("Round trips empty and short input") {
+    roundTrip({});
+    roundTrip({1, 2, 3});
+  }
+
+  SECTION("Shrinks repetitive data") {
+    std::vector<uint8_t> input(4096, 0);
+    for (std::size_t i = 0; i < input.size(); i += 64) input[i] = i / 64;
+    REQUIRE(roundTrip(input) < input.size() / 8);
+  }
+
+  SECTION("Round trips data without repeats") {
+    std::vector<uint8_t> input;
+    uint32_t state = 12345;
+    for (int i = 0; i < 1000; ++i) {
+      state = state * 1664525 + 1013904223;
+      input.push_back(state >> 24);
+    }
+    roundTrip(input);
+  }
+
+  SECTION("Rejects truncated input") {
+    std::vector<uint8_t> input(300, 7);
+    auto compressed = LzCompress(input);
+    compressed.resize(compressed.size() / 2);
+    std::vector<uint8_t> output;
+    REQUIRE(!LzDecompress(compressed, input.size(), output));
+  }
+}
+
+TEST_CASE("Cold storage") {
+  auto componentManager = std::make_shared<ComponentManager>();
+  componentManager->SetColdStorage(true);
+  auto invalidationEvent = std::make_shared<Event<Entity::Id>>();
+  Entity entity(invalidationEvent, componentManager);
+  entity.AddComponent<TestComponent>({5});
+  entity.AddComponent<TestComponent2>({6});
+  entity.AddComponent<TestTag>({});
+
+  SECTION("Disabling an entity moves its components out of the pools") {
+    entity.SetIsEnabled(false);
+    REQUIRE(componentManager->IsFrozen(entity.GetId()));
+    REQUIRE(componentManager->ColdStorageBytes() > 0);
+    REQUIRE(entity.GetComponent<TestComponent>().expired());
+    REQUIRE(componentManager->GetByEntity<TestComponent>(entity.GetId(), false)
+                .expired());
+    REQUIRE(componentManager->GetEntitiesWithSharedComponents<TestComponent>(
+                                false)
+                .empty());
+  }
+
+  SECTION("Enabling an entity restores its components under their handles") {
+    entity.SetIsEnabled(false);
+    entity.SetIsEnabled(true);
+    REQUIRE(!componentManager->IsFrozen(entity.GetId()));
+    REQUIRE(0 == componentManager->ColdStorageBytes());
+    REQUIRE(5 == entity.GetComponent<TestComponent>().lock()->a);
+    REQUIRE(6 == entity.GetComponent<TestComponent2>().lock()->b);
+    REQUIRE(std::unordered_set<ComponentManager::EntityId>{entity.GetId()} ==
+            componentManager->GetEntitiesWithSharedComponents<
+                TestComponent, TestComponent2, TestTag>());
+  }
+
+  SECTION("Removing a frozen component sends its event") {
+    ComponentManager::EntityId removed = -1;
+    auto removeEvent =
+        std::make_shared<Event<ComponentManager::EntityId,
+                               ComponentManager::Handle>>();
+    componentManager->SetSystemEvents(nullptr, removeEvent);
+    auto observer = removeEvent->Subscribe(
+        [&](ComponentManager::EntityId const entityId,
+            ComponentManager::Handle const&) { removed = entityId; });
+    entity.SetIsEnabled(false);
+    entity.RemoveComponent<TestComponent>();
+    observer->Unsubscribe();
+    REQUIRE(entity.GetId() == removed);
+
+    entity.SetIsEnabled(true);
+    REQUIRE(!entity.HasComponent<TestComponent>());
+    REQUIRE(6 == entity.GetComponent<TestComponent2>().lock()->b);
+  }
+
+  SECTION("Adding a component to a frozen entity replaces the frozen one") {
+    entity.SetIsEnabled(false);
+    entity.AddComponent<TestComponent>({9});
+    entity.SetIsEnabled(true);
+    REQUIRE(9 == entity.GetComponent<TestComponent>().lock()->a);
+    REQUIRE(6 == entity.GetComponent<TestComponent2>().lock()->b);
+  }
+
+  SECTION("Destroying a frozen entity frees its cold storage") {
+    entity.SetIsEnabled(false);
+    entity.Invalidate();
+    REQUIRE(!componentManager->IsFrozen(entity.GetId()));
+    REQUIRE(0 == componentManager->ColdStorageBytes());
+  }
+
+  SECTION("Components added while frozen are frozen on the next disable") {
+    entity.RemoveComponent<TestComponent2>();
+    entity.SetIsEnabled(false);
+    entity.AddComponent<TestComponent2>({8});
+    entity.SetIsEnabled(false);
+    REQUIRE(entity.GetComponent<TestComponent2>().expired());
+    entity.SetIsEnabled(true);
+    REQUIRE(5 == entity.GetComponent<TestComponent>().lock()->a);
+    REQUIRE(8 == entity.GetComponent<TestComponent2>().lock()->b);
+  }
+
+  SECTION("Nothing is frozen with cold storage off") {
+    componentManager->SetColdStorage(false);
+    entity.SetIsEnabled(false);
+    REQUIRE(!componentManager->IsFrozen(entity.GetId()));
+    REQUIRE(!componentManager->GetByEntity<TestComponent>(entity.GetId(), false)
+                 .expired());
+  }
+}
\ No newline at end of file
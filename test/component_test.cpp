@@ -2,10 +2,35 @@
 #include "component.hpp"
 
 #include <memory>
+#include <unordered_set>
 
 #include "catch2/catch_test_macros.hpp"
 #include "data.hpp"
 
+namespace {
+// Records whether it was copied from an object that was still alive
+struct Tracked {
+  static inline std::unordered_set<Tracked const*> live;
+
+  explicit Tracked(int const value) noexcept : value(value) {
+    live.insert(this);
+  }
+  Tracked(Tracked const& other) noexcept
+      : value(other.value), fromLive(live.contains(&other)) {
+    live.insert(this);
+  }
+  Tracked& operator=(Tracked const& other) noexcept {
+    value = other.value;
+    fromLive = live.contains(&other);
+    return *this;
+  }
+  ~Tracked() { live.erase(this); }
+
+  int value;
+  bool fromLive = true;
+};
+}  // namespace
+
 TEST_CASE("Component Manager") {
   ComponentManager manager;
 
@@ -120,6 +145,117 @@ TEST_CASE("Component Manager") {
             false));
   }
 
+  SECTION("Query excludes entities with a Without component") {
+    manager.Create<TestComponent>(88, {1});
+    manager.Create<TestComponent>(99, {1});
+    manager.Create<TestComponent2>(99, {1});
+    REQUIRE(std::vector<ComponentManager::EntityId>{88} ==
+            manager.Query<TestComponent, Without<TestComponent2>>());
+  }
+
+  SECTION("Query ignores Optional components when matching") {
+    manager.Create<TestComponent>(88, {1});
+    manager.Create<TestComponent2>(99, {1});
+    REQUIRE(std::vector<ComponentManager::EntityId>{88} ==
+            manager.Query<With<TestComponent>, Optional<TestComponent2>>());
+  }
+
+  SECTION("Query is empty when a required component has no pool") {
+    manager.Create<TestComponent>(88, {1});
+    REQUIRE(manager.Query<TestComponent, TestComponent2>().empty());
+    REQUIRE(std::vector<ComponentManager::EntityId>{88} ==
+            manager.Query<TestComponent, Without<TestComponent2>>());
+  }
+
+  SECTION("Query can exclude tags") {
+    manager.Create<TestComponent>(88, {1});
+    manager.Create<TestComponent>(99, {1});
+    manager.Create<TestTag>(99, {});
+    REQUIRE(std::vector<ComponentManager::EntityId>{88} ==
+            manager.Query<TestComponent, Without<TestTag>>());
+  }
+
+  SECTION("Query filters entities from a high id range") {
+    ComponentManager::EntityId const high = 100 << 24;
+    manager.Create<TestComponent>(high + 2, {1});
+    manager.Create<TestComponent>(high + 1, {1});
+    manager.Create<TestComponent2>(high + 2, {1});
+    manager.Create<TestTag>(high + 1, {});
+    REQUIRE(std::vector<ComponentManager::EntityId>{high + 1} ==
+            manager.Query<TestComponent, Without<TestComponent2>>());
+    REQUIRE(std::vector<ComponentManager::EntityId>{high + 1, high + 2} ==
+            manager.Query<TestComponent>());
+    REQUIRE(std::vector<ComponentManager::EntityId>{high + 1} ==
+            manager.Query<TestComponent, With<TestTag>>());
+  }
+
+  SECTION("Negative entity ids have no components") {
+    manager.Create<TestComponent>(1, {1});
+    manager.Create<TestTag>(1, {});
+    REQUIRE(nullptr == manager.GetByEntity<TestComponent>(-1).lock());
+    REQUIRE(nullptr == manager.GetByEntity<TestTag>(-1).lock());
+    std::vector<ComponentManager::EntityId> entities{-1, 1};
+    manager.Filter<TestComponent, TestTag>(entities);
+    REQUIRE(std::vector<ComponentManager::EntityId>{1} == entities);
+  }
+
+  SECTION("Sorted pools drive queries in sorted order") {
+    manager.Create<TestComponent>(88, {2});
+    manager.Create<TestComponent>(99, {1});
+    manager.Create<TestComponent>(77, {3});
+    manager.Create<TestComponent2>(99, {1});
+    manager.Create<TestComponent2>(88, {1});
+    manager.SetSortOrder<TestComponent>(
+        [](TestComponent const& lhs, TestComponent const& rhs) {
+          return lhs.a < rhs.a;
+        });
+    REQUIRE(std::vector<ComponentManager::EntityId>{99, 88} ==
+            manager.Query<TestComponent2, TestComponent>());
+
+    manager.GetByEntity<TestComponent>(99).lock()->a = 5;
+    manager.SortIncremental();
+    REQUIRE(std::vector<ComponentManager::EntityId>{88, 77, 99} ==
+            manager.Query<TestComponent>());
+  }
+
+  SECTION("Groups visit matching entities in lockstep") {
+    struct Other {
+      int c;
+    };
+    REQUIRE(manager.AddGroup<TestComponent, TestComponent2>());
+    REQUIRE(!manager.AddGroup<TestComponent2, Other>());
+    manager.Create<TestComponent>(77, {7});
+    manager.Create<TestComponent>(88, {8});
+    manager.Create<TestComponent>(99, {9});
+    manager.Create<TestComponent2>(99, {90});
+    manager.Create<TestComponent2>(88, {80});
+    REQUIRE(manager.HasGroup<TestComponent, TestComponent2>());
+    REQUIRE(!manager.HasGroup<TestComponent>());
+
+    std::vector<ComponentManager::EntityId> entities;
+    manager.ForEachGroup<TestComponent, TestComponent2>(
+        [&](ComponentManager::EntityId const entityId,
+            std::shared_ptr<TestComponent> component,
+            std::shared_ptr<TestComponent2> component2) {
+          REQUIRE(component->a * 10 == component2->b);
+          entities.push_back(entityId);
+        });
+    REQUIRE(std::vector<ComponentManager::EntityId>{88, 99} == entities);
+  }
+
+  SECTION("Groups repack after their pools change") {
+    manager.AddGroup<TestComponent, TestComponent2>();
+    manager.Create<TestComponent>(88, {8});
+    manager.Create<TestComponent2>(88, {80});
+    auto count = 0;
+    auto visit = [&](ComponentManager::EntityId, auto, auto) { ++count; };
+    manager.ForEachGroup<TestComponent, TestComponent2>(visit);
+    manager.Create<TestComponent>(99, {9});
+    manager.Create<TestComponent2>(99, {90});
+    manager.ForEachGroup<TestComponent, TestComponent2>(visit);
+    REQUIRE(3 == count);
+  }
+
   SECTION("Removing component also removes disabled components") {
     auto handle = manager.Create<TestComponent>(99, {1});
     manager.SetEntityEnabled(99, false);
@@ -128,11 +264,175 @@ TEST_CASE("Component Manager") {
     REQUIRE(manager.GetEntitiesWithSharedComponents<TestComponent>().empty());
   }
 
+  SECTION("Compacting keeps handles valid") {
+    auto handle1 = manager.Create<TestComponent>(99, {1});
+    auto handle2 = manager.Create<TestComponent>(88, {2});
+    manager.Remove(handle1);
+    manager.Compact();
+    REQUIRE(2 == manager.Get<TestComponent>(handle2).lock()->a);
+    REQUIRE(2 == manager.GetByEntity<TestComponent>(88).lock()->a);
+  }
+
+  SECTION("Incremental compaction fills holes within budget") {
+    auto handle = manager.Create<TestComponent>(99, {1});
+    manager.Create<TestComponent>(88, {2});
+    manager.Create<TestComponent>(77, {3});
+    manager.Remove(handle);
+    REQUIRE(1 == manager.CompactIncremental(5));
+    auto stats = manager.GetPoolStats(typeid(TestComponent).hash_code());
+    REQUIRE(2 == stats.Size);
+    REQUIRE(2 == stats.Capacity);
+  }
+
+  SECTION("Can compact a pool sorted by a component value") {
+    manager.Create<TestComponent>(99, {3});
+    manager.Create<TestComponent>(88, {1});
+    manager.Create<TestComponent>(77, {2});
+    manager.CompactSorted<TestComponent>(
+        [](TestComponent const& lhs, TestComponent const& rhs) {
+          return lhs.a < rhs.a;
+        });
+    std::vector<ComponentManager::EntityId> order;
+    manager.ForEachComponent<TestComponent>(
+        [&](ComponentManager::EntityId const entityId, TestComponent const&) {
+          order.push_back(entityId);
+        });
+    REQUIRE(std::vector<ComponentManager::EntityId>{88, 77, 99} == order);
+    REQUIRE(3 == manager.GetByEntity<TestComponent>(99).lock()->a);
+    REQUIRE(1 == manager.GetByEntity<TestComponent>(88).lock()->a);
+  }
+
+  SECTION("Can find component without locking during a read phase") {
+    manager.Create<TestComponent>(99, {1});
+    manager.BeginReadPhase();
+    REQUIRE(1 == manager.Find<TestComponent>(99)->a);
+    REQUIRE(nullptr == manager.Find<TestComponent2>(99));
+    manager.EndReadPhase();
+  }
+
+  SECTION("Create returns an invalid handle during a read phase") {
+    manager.BeginReadPhase();
+    REQUIRE(!manager.Create<TestComponent>(99, {1}).IsValid());
+    manager.EndReadPhase();
+    REQUIRE(manager.GetEntitiesWithSharedComponents<TestComponent>().empty());
+  }
+
+  SECTION("Tag components are stored without a data pool") {
+    auto handle = manager.Create<TestTag>(99, {});
+    REQUIRE(99 == handle.Data);
+    REQUIRE(nullptr != manager.Get<TestTag>(handle).lock());
+    REQUIRE(nullptr != manager.GetByEntity<TestTag>(99).lock());
+    REQUIRE(manager.GetByEntity<TestTag>(88).expired());
+  }
+
+  SECTION("Can filter entities by tag") {
+    manager.Create<TestComponent>(88, {1});
+    manager.Create<TestComponent>(99, {1});
+    manager.Create<TestTag>(99, {});
+    REQUIRE(std::unordered_set<ComponentManager::EntityId>{99} ==
+            manager.GetEntitiesWithSharedComponents<TestComponent, TestTag>());
+  }
+
+  SECTION("Can remove a tag") {
+    auto handle = manager.Create<TestTag>(99, {});
+    manager.Remove(handle);
+    REQUIRE(manager.GetByEntity<TestTag>(99).expired());
+    REQUIRE(manager.GetEntitiesWithSharedComponents<TestTag>().empty());
+  }
+
+  SECTION("Tags follow entity enabled state") {
+    manager.Create<TestTag>(99, {});
+    manager.SetEntityEnabled(99, false);
+    REQUIRE(manager.GetByEntity<TestTag>(99).expired());
+    REQUIRE(!manager.GetByEntity<TestTag>(99, false).expired());
+    manager.SetEntityEnabled(99, true);
+    REQUIRE(!manager.GetByEntity<TestTag>(99).expired());
+  }
+
+  SECTION("Compacting skips tags") {
+    manager.Create<TestTag>(99, {});
+    manager.Create<TestComponent>(99, {1});
+    manager.Compact();
+    REQUIRE(0 == manager.CompactIncremental(1));
+    REQUIRE(1 ==
+            manager.GetPoolStats(ComponentManager::GetTypeId<TestTag>()).Size);
+  }
+
+  SECTION("Emplace constructs the component from arguments") {
+    auto handle = manager.Emplace<TestComponent>(99, true, 4);
+    REQUIRE(4 == manager.Get<TestComponent>(handle).lock()->a);
+  }
+
+  SECTION("Replace overwrites the component in place") {
+    auto handle = manager.Create<TestComponent>(99, {1});
+    auto component = manager.Get<TestComponent>(handle).lock();
+    auto replaced = manager.Replace<TestComponent>(99, 7);
+    REQUIRE(handle.Data == replaced.Data);
+    REQUIRE(7 == component->a);
+    REQUIRE(1 == manager.GetPoolStats(handle.Type).Capacity);
+  }
+
+  SECTION("Replace can copy from the component being replaced") {
+    manager.Emplace<Tracked>(99, true, 3);
+    auto component = manager.GetByEntity<Tracked>(99).lock();
+    REQUIRE(manager.Replace<Tracked>(99, *component).IsValid());
+    REQUIRE(component->fromLive);
+    REQUIRE(3 == component->value);
+  }
+
+  SECTION("Replace finds disabled components") {
+    manager.Create<TestComponent>(99, {1}, false);
+    REQUIRE(manager.Replace<TestComponent>(99, 7).IsValid());
+    REQUIRE(7 == manager.GetByEntity<TestComponent>(99, false).lock()->a);
+  }
+
+  SECTION("Replace fails if the entity doesn't have the component") {
+    REQUIRE(!manager.Replace<TestComponent>(99, 7).IsValid());
+    manager.Create<TestComponent>(88, {1});
+    REQUIRE(!manager.Replace<TestComponent>(99, 7).IsValid());
+  }
+
   auto componentAddEvent =
       EventManager::CreateSystemEvent<Entity::Id, ComponentManager::Handle>();
   auto componentRemoveEvent =
       EventManager::CreateSystemEvent<Entity::Id, ComponentManager::Handle>();
-  manager.SetSystemEvents(componentAddEvent, componentRemoveEvent);
+  auto componentChangeEvent =
+      EventManager::CreateSystemEvent<Entity::Id, ComponentManager::Handle>();
+  manager.SetSystemEvents(componentAddEvent, componentRemoveEvent,
+                          componentChangeEvent);
+
+  SECTION("Replace only sends a change event") {
+    manager.Create<TestComponent>(99, {1});
+    int added = 0;
+    int removed = 0;
+    int changed = 0;
+    auto addObserver = componentAddEvent->Subscribe(
+        [&](Entity::Id, ComponentManager::Handle) { ++added; });
+    auto removeObserver = componentRemoveEvent->Subscribe(
+        [&](Entity::Id, ComponentManager::Handle) { ++removed; });
+    auto changeObserver = componentChangeEvent->Subscribe(
+        [&](Entity::Id, ComponentManager::Handle) { ++changed; });
+    manager.Replace<TestComponent>(99, 2);
+    addObserver->Unsubscribe();
+    removeObserver->Unsubscribe();
+    changeObserver->Unsubscribe();
+    REQUIRE(0 == added);
+    REQUIRE(0 == removed);
+    REQUIRE(1 == changed);
+  }
+
+  SECTION("CreateMany replaces components entities already have") {
+    auto const old = manager.Create<TestComponent>(99, {1});
+    ComponentManager::Handle removed{0, {~0}};
+    auto observer = componentRemoveEvent->Subscribe(
+        [&](Entity::Id, ComponentManager::Handle handle) { removed = handle; });
+    auto const handles = manager.CreateMany<TestComponent>({99, 88}, {5});
+    observer->Unsubscribe();
+    REQUIRE(old.Data == removed.Data);
+    REQUIRE(5 == manager.Get<TestComponent>(handles[0]).lock()->a);
+    REQUIRE(5 == manager.GetByEntity<TestComponent>(99).lock()->a);
+    REQUIRE(2 == manager.GetPoolStats(old.Type).Size);
+  }
 
   SECTION("Can subscribe to component creation events") {
     int i = 0;
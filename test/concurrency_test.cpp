@@ -0,0 +1,169 @@
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+namespace {
+template <int Index>
+struct Counter {
+  int value;
+};
+}  // namespace
+
+TEST_CASE("Concurrent component changes") {
+  auto componentManager = std::make_shared<ComponentManager>(
+      ComponentManager::Concurrency::Sharded);
+  Manager manager(componentManager);
+
+  constexpr int kThreads = 8;
+  constexpr int kEntitiesPerThread = 500;
+
+  auto runThreads = [&](auto func) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+      threads.emplace_back(func, i);
+    }
+    for (auto& thread : threads) thread.join();
+  };
+
+  SECTION("Threads can create entities and add components concurrently") {
+    runThreads([&](int const thread) {
+      for (int i = 0; i < kEntitiesPerThread; ++i) {
+        auto entity = manager.CreateEntity().lock();
+        entity->AddComponent<TestComponent>({thread});
+        if (i % 2 == 0) entity->AddComponent<TestComponent2>({i});
+      }
+    });
+
+    REQUIRE(kThreads * kEntitiesPerThread ==
+            componentManager->GetEntitiesWithSharedComponents<TestComponent>()
+                .size());
+    REQUIRE(kThreads * kEntitiesPerThread / 2 ==
+            componentManager
+                ->GetEntitiesWithSharedComponents<TestComponent,
+                                                  TestComponent2>()
+                .size());
+  }
+
+  SECTION("Threads can add and remove components concurrently") {
+    runThreads([&](int const thread) {
+      for (int i = 0; i < kEntitiesPerThread; ++i) {
+        auto entity = manager.CreateEntity().lock();
+        entity->AddComponent<TestComponent>({thread});
+        entity->AddComponent<TestComponent2>({i});
+        entity->RemoveComponent<TestComponent>();
+        if (i % 2 == 0) manager.DestroyEntity(entity->GetId());
+      }
+    });
+
+    REQUIRE(componentManager->GetEntitiesWithSharedComponents<TestComponent>()
+                .empty());
+    REQUIRE(kThreads * kEntitiesPerThread / 2 ==
+            componentManager->GetEntitiesWithSharedComponents<TestComponent2>()
+                .size());
+  }
+
+  SECTION("Reads during a read phase see a consistent world") {
+    runThreads([&](int const thread) {
+      for (int i = 0; i < kEntitiesPerThread; ++i) {
+        manager.CreateEntity().lock()->AddComponent<TestComponent>({thread});
+      }
+    });
+
+    auto phase = manager.BeginReadPhase();
+    std::atomic<int> count = 0;
+    phase.ParallelForEach<TestComponent>(
+        [&](Entity const& entity, TestComponent const& component) {
+          if (phase.GetByEntity<TestComponent>(entity.GetId()) == &component) {
+            ++count;
+          }
+        },
+        kThreads);
+    REQUIRE(kThreads * kEntitiesPerThread == count);
+  }
+
+  SECTION("Writers let through before a read phase keep locking") {
+    std::atomic<bool> done = false;
+    std::thread reader([&] {
+      while (!done) {
+        auto phase = manager.BeginReadPhase();
+        phase.ForEach<TestComponent>(
+            [](Entity const&, TestComponent const&) {});
+      }
+    });
+    runThreads([&](int const thread) {
+      for (int i = 0; i < kEntitiesPerThread; ++i) {
+        auto const entityId = componentManager->NewEntityId();
+        while (!componentManager->Create(entityId, TestComponent{thread})
+                    .IsValid()) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    done = true;
+    reader.join();
+
+    auto stats = componentManager->GetPoolStats(
+        ComponentManager::GetTypeId<TestComponent>());
+    REQUIRE(kThreads * kEntitiesPerThread == stats.Size);
+  }
+
+  SECTION("Threads can set and get resources concurrently") {
+    auto useResources = [&]<int... Indices>(
+                            std::integer_sequence<int, Indices...>) {
+      runThreads([&](int const thread) {
+        for (int i = 0; i < kEntitiesPerThread; ++i) {
+          ((thread % 2 ? (void)manager.GetResource<Counter<Indices>>()
+                       : (void)manager.SetResource<Counter<Indices>>(i)),
+           ...);
+        }
+      });
+      REQUIRE((manager.GetResource<Counter<Indices>>() && ...));
+    };
+    useResources(std::make_integer_sequence<int, 16>{});
+  }
+
+  SECTION("Concurrent replacement on one entity leaves a consistent handle") {
+    auto entity = manager.CreateEntity().lock();
+    runThreads([&](int const thread) {
+      for (int i = 0; i < kEntitiesPerThread; ++i) {
+        entity->AddComponent<TestComponent>({thread});
+      }
+    });
+
+    auto stats = componentManager->GetPoolStats(
+        ComponentManager::GetTypeId<TestComponent>());
+    REQUIRE(1 == stats.Size);
+    REQUIRE(entity->GetComponent<TestComponent>().lock() ==
+            componentManager->GetByEntity<TestComponent>(entity->GetId())
+                .lock());
+  }
+
+  SECTION("Compacting doesn't lose writes made through weak pointers") {
+    std::vector<std::weak_ptr<TestComponent>> components;
+    std::vector<Entity::Id> holes;
+    for (int i = 0; i < kThreads; ++i) {
+      auto entity = manager.CreateEntity().lock();
+      entity->AddComponent<TestComponent>({0});
+      components.push_back(entity->GetComponent<TestComponent>());
+      auto hole = manager.CreateEntity().lock();
+      hole->AddComponent<TestComponent>({0});
+      holes.push_back(hole->GetId());
+    }
+    for (auto const id : holes) manager.DestroyEntity(id);
+
+    runThreads([&](int const thread) {
+      for (int i = 0; i < kEntitiesPerThread; ++i) {
+        if (thread == 0) componentManager->Compact<TestComponent>();
+        if (auto component = components[thread].lock()) ++component->a;
+      }
+    });
+    for (auto const& component : components) {
+      REQUIRE(kEntitiesPerThread == component.lock()->a);
+    }
+  }
+}
\ No newline at end of file
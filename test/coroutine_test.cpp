@@ -0,0 +1,119 @@
+
+#include "coroutine.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+Task CountTicks(int& count) {
+  while (true) {
+    ++count;
+    co_await NextTick();
+  }
+}
+
+Task Sleep(double const seconds, bool& done) {
+  co_await Delay(seconds);
+  done = true;
+}
+
+Task Listen(int& received) {
+  received = co_await WaitEvent<int>();
+}
+
+Task Compute(int& result) {
+  result = co_await RunAsync([] { return 6 * 7; });
+}
+
+Task Throw() {
+  co_await NextTick();
+  throw std::runtime_error("task failed");
+}
+
+// Ticks until the condition holds or a second has passed
+template <typename Condition>
+bool TickUntil(CoroutineSystem& system, Condition condition) {
+  for (int i = 0; i < 1000 && !condition(); ++i) {
+    system.Tick(0.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return condition();
+}
+}  // namespace
+
+TEST_CASE("Coroutine System") {
+  auto eventManager = std::make_shared<EventManager>(
+      std::unordered_map<SystemEvent, EventBasePtr>{});
+  CoroutineSystem system(eventManager);
+
+  SECTION("Runs to the first suspension on start") {
+    int count = 0;
+    system.Start(CountTicks(count));
+    REQUIRE(1 == count);
+    system.Tick(0.1);
+    system.Tick(0.1);
+    REQUIRE(3 == count);
+  }
+
+  SECTION("Delay waits for tick time to pass") {
+    bool done = false;
+    system.Start(Sleep(1.0, done));
+    system.Tick(0.6);
+    REQUIRE(!done);
+    system.Tick(0.6);
+    REQUIRE(done);
+    REQUIRE(0 == system.Size());
+  }
+
+  SECTION("Waits for an event and resumes on the next tick") {
+    int received = 0;
+    system.Start(Listen(received));
+    eventManager->CreateSubject<int>()->Notify(5);
+    REQUIRE(0 == received);
+    system.Tick(0.0);
+    REQUIRE(5 == received);
+  }
+
+  SECTION("Only the first event is received") {
+    int received = 0;
+    system.Start(Listen(received));
+    eventManager->CreateSubject<int>()->Notify(5);
+    eventManager->CreateSubject<int>()->Notify(6);
+    system.Tick(0.0);
+    REQUIRE(5 == received);
+  }
+
+  SECTION("Returns the result of background work") {
+    int result = 0;
+    system.Start(Compute(result));
+    REQUIRE(TickUntil(system, [&] { return result == 42; }));
+  }
+
+  SECTION("Exceptions escaping a task are rethrown from tick") {
+    system.Start(Throw());
+    REQUIRE_THROWS(system.Tick(0.0));
+    REQUIRE(0 == system.Size());
+  }
+
+  SECTION("Tasks due after a throwing one still run") {
+    int count = 0;
+    system.Start(Throw());
+    system.Start(CountTicks(count));
+    REQUIRE_THROWS(system.Tick(0.0));
+    REQUIRE(2 == count);
+    system.Tick(0.0);
+    REQUIRE(3 == count);
+    REQUIRE(1 == system.Size());
+  }
+
+  SECTION("Suspended tasks are destroyed with the system") {
+    int count = 0;
+    int received = 0;
+    system.Start(CountTicks(count));
+    system.Start(Listen(received));
+    REQUIRE(2 == system.Size());
+  }
+}
\ No newline at end of file
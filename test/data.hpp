@@ -96,4 +96,5 @@ struct TestComponent {
 };
 struct TestComponent2 {
   int b;
-};
\ No newline at end of file
+};
+struct TestTag {};
\ No newline at end of file
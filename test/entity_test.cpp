@@ -15,10 +15,13 @@ TEST_CASE("Entity Tests") {
 
   SECTION("Entity id iterates for each entity") {
     Entity entity2(invalidationEvent, componentManager);
-    // This does start at 0 because entity has been constructed already in
-    // previous test
-    REQUIRE(1 == entity.GetId());
-    REQUIRE(2 == entity2.GetId());
+    REQUIRE(0 == entity.GetId());
+    REQUIRE(1 == entity2.GetId());
+  }
+
+  SECTION("Each component manager has its own id space") {
+    Entity other(invalidationEvent, std::make_shared<ComponentManager>());
+    REQUIRE(0 == other.GetId());
   }
 
   SECTION("Returns false for invalid component") {
@@ -36,6 +39,27 @@ TEST_CASE("Entity Tests") {
     REQUIRE(5 == entity.GetComponent<TestComponent>().lock()->a);
   }
 
+  SECTION("Can emplace a component") {
+    entity.EmplaceComponent<TestComponent>(3);
+    REQUIRE(3 == entity.GetComponent<TestComponent>().lock()->a);
+  }
+
+  SECTION("Can replace a component in place") {
+    REQUIRE(!entity.ReplaceComponent<TestComponent>(2));
+    entity.AddComponent<TestComponent>({1});
+    auto component = entity.GetComponent<TestComponent>().lock();
+    REQUIRE(entity.ReplaceComponent<TestComponent>(2));
+    REQUIRE(2 == component->a);
+  }
+
+  SECTION("Can add a tag component to entity") {
+    entity.AddComponent<TestTag>({});
+    REQUIRE(entity.HasComponent<TestTag>());
+    REQUIRE(!entity.GetComponent<TestTag>().expired());
+    entity.RemoveComponent<TestTag>();
+    REQUIRE(!entity.HasComponent<TestTag>());
+  }
+
   SECTION("Has component return true if does have component") {
     entity.AddComponent<TestComponent>({1});
     REQUIRE(true == entity.HasComponent<TestComponent>());
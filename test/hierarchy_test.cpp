@@ -0,0 +1,65 @@
+
+#include "hierarchy.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+TEST_CASE("Hierarchy") {
+  Hierarchy hierarchy;
+
+  SECTION("Can set and get a parent") {
+    REQUIRE(hierarchy.SetParent(2, 1));
+    REQUIRE(1 == hierarchy.GetParent(2));
+    REQUIRE(Hierarchy::kNone == hierarchy.GetParent(1));
+    REQUIRE(std::vector<Hierarchy::EntityId>{2} == hierarchy.GetChildren(1));
+  }
+
+  SECTION("Setting a new parent moves the child") {
+    hierarchy.SetParent(3, 1);
+    hierarchy.SetParent(3, 2);
+    REQUIRE(hierarchy.GetChildren(1).empty());
+    REQUIRE(std::vector<Hierarchy::EntityId>{3} == hierarchy.GetChildren(2));
+  }
+
+  SECTION("Rejects cycles") {
+    hierarchy.SetParent(2, 1);
+    hierarchy.SetParent(3, 2);
+    REQUIRE(!hierarchy.SetParent(1, 3));
+    REQUIRE(!hierarchy.SetParent(1, 1));
+    REQUIRE(Hierarchy::kNone == hierarchy.GetParent(1));
+  }
+
+  SECTION("Unlinked entities are not stored") {
+    hierarchy.SetParent(2, 1);
+    hierarchy.RemoveParent(2);
+    REQUIRE(0 == hierarchy.Size());
+  }
+
+  SECTION("Order is sorted by depth with parents first") {
+    hierarchy.SetParent(4, 3);
+    hierarchy.SetParent(3, 1);
+    hierarchy.SetParent(2, 1);
+    hierarchy.SetParent(6, 5);
+
+    auto const& order = hierarchy.GetOrder();
+    REQUIRE(6 == order.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      if (i > 0) REQUIRE(order[i - 1].Depth <= order[i].Depth);
+      if (order[i].ParentIndex != Hierarchy::kNoIndex) {
+        REQUIRE(order[i].ParentIndex < i);
+        REQUIRE(order[order[i].ParentIndex].Entity == order[i].Parent);
+      }
+    }
+    REQUIRE(4 == order.back().Entity);
+    REQUIRE(2 == order.back().Depth);
+  }
+
+  SECTION("Removing a tree returns its descendants nearest first") {
+    hierarchy.SetParent(2, 1);
+    hierarchy.SetParent(3, 2);
+    hierarchy.SetParent(4, 1);
+    hierarchy.SetParent(1, 0);
+    REQUIRE(std::vector<Hierarchy::EntityId>{2, 4, 3} ==
+            hierarchy.RemoveTree(1));
+    REQUIRE(0 == hierarchy.Size());
+  }
+}
\ No newline at end of file
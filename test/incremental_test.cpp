@@ -0,0 +1,67 @@
+
+#include "incremental.hpp"
+
+#include <unordered_map>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+
+TEST_CASE("Incremental System") {
+  Manager manager;
+  std::vector<std::shared_ptr<Entity>> entities;
+  for (int i = 0; i < 10; ++i) {
+    entities.push_back(manager.CreateEntity().lock());
+    entities.back()->AddComponent<TestComponent>({i});
+  }
+
+  std::unordered_map<Entity::Id, int> visits;
+  using TestIncremental = IncrementalSystem<TestComponent>;
+  manager.AddSystem<TestIncremental>(
+      &manager, TestIncremental::Budget{4, {}},
+      [&](std::shared_ptr<Entity> entity, std::shared_ptr<TestComponent>) {
+        ++visits[entity->GetId()];
+      });
+
+  SECTION("Processes at most the entity budget per tick") {
+    manager.Tick(0.0);
+    REQUIRE(4 == visits.size());
+    manager.Tick(0.0);
+    REQUIRE(8 == visits.size());
+  }
+
+  SECTION("A pass visits every entity once") {
+    for (int i = 0; i < 3; ++i) manager.Tick(0.0);
+    REQUIRE(10 == visits.size());
+    for (auto const& [_, count] : visits) REQUIRE(1 == count);
+  }
+
+  SECTION("Destroyed entities are skipped") {
+    manager.Tick(0.0);
+    manager.DestroyEntity(entities[9]->GetId());
+    for (int i = 0; i < 2; ++i) manager.Tick(0.0);
+    REQUIRE(9 == visits.size());
+    REQUIRE(!visits.contains(entities[9]->GetId()));
+  }
+
+  SECTION("Entities added mid pass are picked up by the next pass") {
+    manager.Tick(0.0);
+    auto entity = manager.CreateEntity().lock();
+    entity->AddComponent<TestComponent>({10});
+    for (int i = 0; i < 2; ++i) manager.Tick(0.0);
+    REQUIRE(!visits.contains(entity->GetId()));
+    for (int i = 0; i < 3; ++i) manager.Tick(0.0);
+    REQUIRE(visits.contains(entity->GetId()));
+  }
+
+  SECTION("Starts a new pass after finishing") {
+    for (int i = 0; i < 6; ++i) manager.Tick(0.0);
+    for (auto const& [_, count] : visits) REQUIRE(2 == count);
+  }
+
+  SECTION("Removing the component mid pass skips the entity") {
+    manager.Tick(0.0);
+    entities[8]->RemoveComponent<TestComponent>();
+    for (int i = 0; i < 2; ++i) manager.Tick(0.0);
+    REQUIRE(!visits.contains(entities[8]->GetId()));
+  }
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 
 #include "manager.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 
 #include "catch2/catch_test_macros.hpp"
@@ -37,6 +39,35 @@ TEST_CASE("Manager tests") {
     }
   }
 
+  SECTION("Manager resource tests") {
+    SECTION("Can set and get a resource") {
+      manager.SetResource<TestComponent>(1);
+      REQUIRE(1 == manager.GetResource<TestComponent>()->a);
+    }
+
+    SECTION("Resources can be modified in place") {
+      manager.SetResource<TestComponent>(1)->a = 3;
+      REQUIRE(3 == manager.GetResource<TestComponent>()->a);
+    }
+
+    SECTION("Can remove a resource") {
+      manager.SetResource<TestComponent>(1);
+      manager.RemoveResource<TestComponent>();
+      REQUIRE(nullptr == manager.GetResource<TestComponent>());
+    }
+
+    SECTION("Resources are separate from components") {
+      manager.SetResource<TestComponent>(1);
+      REQUIRE(manager.GetResource<TestComponent2>() == nullptr);
+      auto i = 0;
+      manager.ForEach<TestComponent>(
+          [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent>) {
+            ++i;
+          });
+      REQUIRE(0 == i);
+    }
+  }
+
   SECTION("Manager foreach tests") {
     auto weakEntity1 = manager.CreateEntity();
     if (auto entity = weakEntity1.lock()) {
@@ -89,6 +120,347 @@ TEST_CASE("Manager tests") {
     }
   }
 
+  SECTION("Manager query filter tests") {
+    auto entity1 = manager.CreateEntity().lock();
+    entity1->AddComponent<TestComponent>({1});
+    entity1->AddComponent<TestComponent2>({2});
+    auto entity2 = manager.CreateEntity().lock();
+    entity2->AddComponent<TestComponent>({3});
+
+    SECTION("Without skips entities that have the component") {
+      auto i = 0;
+      manager.ForEach<TestComponent, Without<TestComponent2>>(
+          [&](std::shared_ptr<Entity> entity,
+              std::shared_ptr<TestComponent> component) {
+            REQUIRE(entity2 == entity);
+            REQUIRE(3 == component->a);
+            ++i;
+          });
+      REQUIRE(1 == i);
+    }
+
+    SECTION("With filters without passing the component") {
+      auto i = 0;
+      manager.ForEach<With<TestComponent2>, TestComponent>(
+          [&](std::shared_ptr<Entity> entity, std::shared_ptr<TestComponent>) {
+            REQUIRE(entity1 == entity);
+            ++i;
+          });
+      REQUIRE(1 == i);
+    }
+
+    SECTION("Optional components are null when absent") {
+      auto sum = 0;
+      manager.ForEach<TestComponent, Optional<TestComponent2>>(
+          [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent>,
+              std::shared_ptr<TestComponent2> component) {
+            sum += component ? component->b : 10;
+          });
+      REQUIRE(12 == sum);
+    }
+
+    SECTION("Read phases accept query terms") {
+      auto phase = manager.BeginReadPhase();
+      auto sum = 0;
+      phase.ForEach<TestComponent, Optional<TestComponent2>>(
+          [&](Entity const&, TestComponent const& component,
+              TestComponent2 const* component2) {
+            sum += component.a + (component2 ? component2->b : 0);
+          });
+      REQUIRE(6 == sum);
+    }
+  }
+
+  SECTION("Manager ordering tests") {
+    std::vector<int> values;
+    for (int i : {3, 1, 2}) {
+      auto entity = manager.CreateEntity().lock();
+      entity->AddComponent<TestComponent>({i});
+      entity->AddComponent<TestComponent2>({i * 10});
+    }
+
+    SECTION("ForEach follows the sort order") {
+      manager.SetSortOrder<TestComponent>(
+          [](TestComponent const& lhs, TestComponent const& rhs) {
+            return lhs.a < rhs.a;
+          });
+      manager.ForEach<TestComponent>(
+          [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent> c) {
+            values.push_back(c->a);
+          });
+      REQUIRE(std::vector<int>{1, 2, 3} == values);
+    }
+
+    SECTION("Sort order is restored after a tick") {
+      manager.SetSortOrder<TestComponent>(
+          [](TestComponent const& lhs, TestComponent const& rhs) {
+            return lhs.a < rhs.a;
+          });
+      manager.ForEach<TestComponent>(
+          [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent> c) {
+            c->a = -c->a;
+          });
+      manager.Tick(0.0);
+      manager.ForEach<TestComponent>(
+          [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent> c) {
+            values.push_back(c->a);
+          });
+      REQUIRE(std::vector<int>{-3, -2, -1} == values);
+    }
+
+    SECTION("ForEach over a group passes matching components") {
+      REQUIRE(manager.AddGroup<TestComponent, TestComponent2>());
+      manager.ForEach<TestComponent, TestComponent2>(
+          [&](std::shared_ptr<Entity> entity, std::shared_ptr<TestComponent> c,
+              std::shared_ptr<TestComponent2> c2) {
+            REQUIRE(c->a * 10 == c2->b);
+            REQUIRE(c == entity->GetComponent<TestComponent>().lock());
+            values.push_back(c->a);
+          });
+      REQUIRE(3 == values.size());
+    }
+  }
+
+  SECTION("Manager spatial index tests") {
+    auto toPoint = [](TestComponent const& position) {
+      return SpatialGrid::Point{static_cast<float>(position.a), 0.0f, 0.0f};
+    };
+    auto near = manager.CreateEntity().lock();
+    near->AddComponent<TestComponent>({1});
+    near->AddComponent<TestComponent2>({1});
+    manager.EnableSpatialIndex<TestComponent>(4.0f, toPoint);
+
+    auto far = manager.CreateEntity().lock();
+    far->AddComponent<TestComponent>({20});
+
+    auto inRadius = [&]() {
+      std::vector<Entity::Id> entities;
+      manager.ForEachInRadius<TestComponent>(
+          {0.0f, 0.0f, 0.0f}, 5.0f,
+          [&](std::shared_ptr<Entity> entity, std::shared_ptr<TestComponent>) {
+            entities.push_back(entity->GetId());
+          });
+      return entities;
+    };
+
+    SECTION("Finds entities added before and after enabling") {
+      REQUIRE(std::vector<Entity::Id>{near->GetId()} == inRadius());
+    }
+
+    SECTION("Moved positions are picked up once marked") {
+      far->GetComponent<TestComponent>().lock()->a = 3;
+      manager.Tick(0.0);
+      REQUIRE(1 == inRadius().size());
+      manager.MarkMoved(far->GetId());
+      REQUIRE(2 == inRadius().size());
+    }
+
+    SECTION("Replaced positions are picked up") {
+      far->ReplaceComponent<TestComponent>(3);
+      REQUIRE(2 == inRadius().size());
+      near->ReplaceComponent<TestComponent>(30);
+      REQUIRE(std::vector<Entity::Id>{far->GetId()} == inRadius());
+    }
+
+    SECTION("Removed components leave the index") {
+      near->RemoveComponent<TestComponent>();
+      REQUIRE(inRadius().empty());
+    }
+
+    SECTION("Follows bulk removes and inserts") {
+      auto const id = near->GetId();
+      manager.Evict({id});
+      manager.Restore({id}, [&](ComponentManager& components,
+                                auto const& write, auto&& attach) {
+        attach(0, components.InsertMany<TestComponent>(
+                      write, {id}, std::vector<TestComponent>{{30}})[0]);
+      });
+      REQUIRE(inRadius().empty());
+
+      Prefab prefab;
+      prefab.Set(TestComponent{2});
+      auto const created = manager.Instantiate(prefab, 2);
+      REQUIRE(2 == inRadius().size());
+    }
+
+    SECTION("Can combine with component filters") {
+      far->GetComponent<TestComponent>().lock()->a = 3;
+      manager.RefreshSpatialIndex();
+      auto i = 0;
+      manager.ForEachInRadius<TestComponent, Without<TestComponent2>>(
+          {0.0f, 0.0f, 0.0f}, 5.0f,
+          [&](std::shared_ptr<Entity> entity, std::shared_ptr<TestComponent>) {
+            REQUIRE(far == entity);
+            ++i;
+          });
+      REQUIRE(1 == i);
+    }
+  }
+
+  SECTION("Manager hierarchy tests") {
+    auto parent = manager.CreateEntity().lock();
+    auto child = manager.CreateEntity().lock();
+    auto grandchild = manager.CreateEntity().lock();
+    manager.SetParent(child->GetId(), parent->GetId());
+    manager.SetParent(grandchild->GetId(), child->GetId());
+
+    SECTION("Destroying a parent destroys its descendants") {
+      manager.DestroyEntity(parent->GetId());
+      REQUIRE(manager.GetEntity(child->GetId()).expired());
+      REQUIRE(manager.GetEntity(grandchild->GetId()).expired());
+    }
+
+    SECTION("Invalidating a parent destroys its descendants") {
+      parent->Invalidate();
+      REQUIRE(manager.GetEntity(grandchild->GetId()).expired());
+    }
+
+    SECTION("Destroying a child detaches it from its parent") {
+      manager.DestroyEntity(child->GetId());
+      REQUIRE(manager.GetChildren(parent->GetId()).empty());
+      REQUIRE(!manager.GetEntity(parent->GetId()).expired());
+    }
+
+    SECTION("Can't parent to an entity that doesn't exist") {
+      REQUIRE(!manager.SetParent(child->GetId(), 9999));
+      REQUIRE(parent->GetId() == manager.GetParent(child->GetId()));
+    }
+
+    SECTION("Hierarchy iteration passes the parent component") {
+      parent->AddComponent<TestComponent>({1});
+      child->AddComponent<TestComponent>({2});
+      grandchild->AddComponent<TestComponent>({3});
+
+      // Accumulate down the tree the way transforms are propagated
+      manager.ForEachInHierarchy<TestComponent>(
+          [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent> component,
+              std::shared_ptr<TestComponent> parentComponent) {
+            if (parentComponent) component->a += parentComponent->a;
+          });
+      REQUIRE(6 == grandchild->GetComponent<TestComponent>().lock()->a);
+    }
+
+    SECTION("Hierarchy iteration follows component and parent changes") {
+      parent->AddComponent<TestComponent>({1});
+      grandchild->AddComponent<TestComponent>({3});
+
+      auto const visit = [&] {
+        std::vector<std::pair<Entity::Id, int>> visited;
+        manager.ForEachInHierarchy<TestComponent>(
+            [&](std::shared_ptr<Entity> entity,
+                std::shared_ptr<TestComponent>,
+                std::shared_ptr<TestComponent> parentComponent) {
+              visited.emplace_back(entity->GetId(),
+                                   parentComponent ? parentComponent->a : 0);
+            });
+        return visited;
+      };
+      REQUIRE(visit() == std::vector<std::pair<Entity::Id, int>>{
+                             {parent->GetId(), 0}, {grandchild->GetId(), 0}});
+
+      child->AddComponent<TestComponent>({2});
+      REQUIRE(visit() == std::vector<std::pair<Entity::Id, int>>{
+                             {parent->GetId(), 0},
+                             {child->GetId(), 1},
+                             {grandchild->GetId(), 2}});
+
+      child->RemoveComponent<TestComponent>();
+      REQUIRE(manager.SetParent(grandchild->GetId(), parent->GetId()));
+      REQUIRE(visit() == std::vector<std::pair<Entity::Id, int>>{
+                             {parent->GetId(), 0}, {grandchild->GetId(), 1}});
+    }
+  }
+
+  SECTION("Manager relation tests") {
+    struct Likes {};
+    auto entity1 = manager.CreateEntity().lock();
+    auto entity2 = manager.CreateEntity().lock();
+    REQUIRE(manager.AddRelation<Likes>(entity1->GetId(), entity2->GetId()));
+
+    SECTION("Can query relations") {
+      REQUIRE(manager.HasRelation<Likes>(entity1->GetId(), entity2->GetId()));
+      REQUIRE(std::vector<Entity::Id>{entity1->GetId()} ==
+              manager.GetRelationSources<Likes>(entity2->GetId()));
+    }
+
+    SECTION("Destroying an entity removes its relations") {
+      manager.DestroyEntity(entity2->GetId());
+      REQUIRE(manager.GetRelationTargets<Likes>(entity1->GetId()).empty());
+    }
+  }
+
+  SECTION("Manager read phase tests") {
+    auto entity1 = manager.CreateEntity().lock();
+    entity1->AddComponent<TestComponent>({1});
+    entity1->AddComponent<TestComponent2>({2});
+    auto entity2 = manager.CreateEntity().lock();
+    entity2->AddComponent<TestComponent>({3});
+
+    SECTION("Can read components during a read phase") {
+      auto phase = manager.BeginReadPhase();
+      REQUIRE(3 == phase.GetByEntity<TestComponent>(entity2->GetId())->a);
+      REQUIRE(nullptr == phase.GetByEntity<TestComponent2>(entity2->GetId()));
+    }
+
+    SECTION("Can iterate over const components during a read phase") {
+      auto phase = manager.BeginReadPhase();
+      auto sum = 0;
+      phase.ForEach<TestComponent>(
+          [&](Entity const&, TestComponent const& component) {
+            sum += component.a;
+          });
+      REQUIRE(4 == sum);
+    }
+
+    SECTION("Can iterate in parallel during a read phase") {
+      auto phase = manager.BeginReadPhase();
+      std::atomic<int> sum = 0;
+      phase.ParallelForEach<TestComponent>(
+          [&](Entity const&, TestComponent const& component) {
+            sum += component.a;
+          },
+          4);
+      REQUIRE(4 == sum);
+    }
+
+    SECTION("Parallel iteration with no threads runs on one") {
+      auto phase = manager.BeginReadPhase();
+      std::atomic<int> sum = 0;
+      phase.ParallelForEach<TestComponent>(
+          [&](Entity const&, TestComponent const& component) {
+            sum += component.a;
+          },
+          0);
+      REQUIRE(4 == sum);
+    }
+
+    SECTION("Structural changes are rejected during a read phase") {
+      {
+        auto phase = manager.BeginReadPhase();
+        REQUIRE(manager.CreateEntity().expired());
+        entity2->AddComponent<TestComponent2>({4});
+        entity1->RemoveComponent<TestComponent>();
+        manager.DestroyEntity(entity2->GetId());
+      }
+      REQUIRE(!entity2->HasComponent<TestComponent2>());
+      REQUIRE(entity1->HasComponent<TestComponent>());
+      REQUIRE(!manager.GetEntity(entity2->GetId()).expired());
+    }
+
+    SECTION("Can read resources during a read phase") {
+      manager.SetResource<TestComponent>(7);
+      auto phase = manager.BeginReadPhase();
+      REQUIRE(7 == phase.GetResource<TestComponent>()->a);
+      REQUIRE(nullptr == manager.SetResource<TestComponent>(8));
+    }
+
+    SECTION("Structural changes are allowed after the read phase") {
+      { auto phase = manager.BeginReadPhase(); }
+      entity2->AddComponent<TestComponent2>({4});
+      REQUIRE(entity2->HasComponent<TestComponent2>());
+    }
+  }
+
   SECTION("Manager system tests") {
     SECTION("Add a system returns SystemId") {
       auto id = manager.AddSystem<TestSystem>(nullptr, nullptr, nullptr);
@@ -146,6 +518,64 @@ TEST_CASE("Manager tests") {
       REQUIRE(std::vector<System::Id>{id2} == manager.GetSystemOrder());
     }
 
+    SECTION("Tick compacts pools when given a budget") {
+      auto entity1 = manager.CreateEntity().lock();
+      auto entity2 = manager.CreateEntity().lock();
+      entity1->AddComponent<TestComponent>({1});
+      entity2->AddComponent<TestComponent>({2});
+      entity1->RemoveComponent<TestComponent>();
+      manager.SetCompactionBudget(10);
+      manager.Tick(60.0f);
+      REQUIRE(2 == entity2->GetComponent<TestComponent>().lock()->a);
+    }
+
+    SECTION("Fixed rate systems tick once per whole step owed") {
+      manager.SetSystemRate(id2, {10.0, 4, false});
+      manager.Tick(0.25);
+      REQUIRE(2 == std::count(executionOrder.begin(), executionOrder.end(),
+                              id2));
+      manager.Tick(0.06);
+      REQUIRE(3 == std::count(executionOrder.begin(), executionOrder.end(),
+                              id2));
+      REQUIRE(2 == std::count(executionOrder.begin(), executionOrder.end(),
+                              id));
+    }
+
+    SECTION("Fixed rate systems stop catching up at their step limit") {
+      manager.SetSystemRate(id2, {10.0, 2, false});
+      manager.Tick(10.05);
+      manager.Tick(0.01);
+      REQUIRE(2 == std::count(executionOrder.begin(), executionOrder.end(),
+                              id2));
+    }
+
+    SECTION("Can add a system with a rate") {
+      manager.RemoveSystem(id2);
+      manager.AddSystem<TestSystem2>(System::Rate{10.0, 4, false}, &state2,
+                                     &executionOrder);
+      manager.Tick(0.05);
+      REQUIRE(SystemState::Initialised == state2);
+      manager.Tick(0.05);
+      REQUIRE(SystemState::Ticked == state2);
+    }
+
+    SECTION("Staggered systems start at different phases") {
+      manager.SetSystemRate(id, {1.0, 1, true});
+      manager.SetSystemRate(id2, {1.0, 1, true});
+      auto ticked = 0;
+      for (int frame = 0; frame < 10; ++frame) {
+        auto const before = executionOrder.size();
+        manager.Tick(0.1);
+        ticked = std::max(ticked, int(executionOrder.size() - before));
+      }
+      REQUIRE(1 == ticked);
+    }
+
+    SECTION("Rejects rates for missing systems") {
+      REQUIRE(!manager.SetSystemRate(99, {10.0}));
+      REQUIRE(!manager.SetSystemRate(id, {0.0}));
+    }
+
     SECTION("Adding same system multiple times doesn't add multiple to order") {
       std::vector<System::Id> order{id, id2};
       manager.SetSystemOrder(order);
@@ -188,3 +618,45 @@ TEST_CASE("Manager tests") {
     }
   }
 }
+
+TEST_CASE("Evicting under a held write scope") {
+  auto componentManager = std::make_shared<ComponentManager>();
+  Manager manager(componentManager);
+  auto const id = manager.CreateEntity().lock()->GetId();
+  manager.GetEntity(id).lock()->AddComponent<TestComponent>({1});
+
+  SECTION("A read phase starting part way through can't reject it") {
+    std::thread reader;
+    {
+      ComponentManager::WriteScope write(*componentManager);
+      REQUIRE(write);
+      reader = std::thread([&] { auto phase = manager.BeginReadPhase(); });
+      while (!componentManager->InReadPhase()) std::this_thread::yield();
+      REQUIRE(manager.Evict(write, {id}));
+    }
+    reader.join();
+    REQUIRE(manager.GetEntity(id).expired());
+    REQUIRE(manager.Query<TestComponent>(false).empty());
+  }
+
+  SECTION("A read phase can't start inside the thread's own change") {
+    {
+      ComponentManager::WriteScope write(*componentManager);
+      auto phase = manager.BeginReadPhase();
+      REQUIRE(!phase);
+      REQUIRE(!componentManager->InReadPhase());
+      REQUIRE(nullptr == phase.GetEntity(id));
+    }
+    auto phase = manager.BeginReadPhase();
+    REQUIRE(phase);
+    REQUIRE(nullptr != phase.GetEntity(id));
+  }
+
+  SECTION("Rejected evictions leave the entity alone") {
+    {
+      auto phase = manager.BeginReadPhase();
+      REQUIRE(!manager.Evict({id}));
+    }
+    REQUIRE(manager.GetEntity(id).lock()->HasComponent<TestComponent>());
+  }
+}
\ No newline at end of file
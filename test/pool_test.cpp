@@ -0,0 +1,251 @@
+#include "pool.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+
+namespace {
+std::vector<int> PoolValues(ComponentPool<TestComponent> const& pool) {
+  std::vector<int> values;
+  pool.ForEach([&](ComponentPoolBase::DataId, TestComponent const& component) {
+    values.push_back(component.a);
+  });
+  return values;
+}
+}  // namespace
+
+TEST_CASE("Tag Set") {
+  TagSet tags;
+
+  SECTION("Can set and test membership") {
+    tags.Set(3, true);
+    tags.Set(130, true);
+    REQUIRE(tags.Contains(3));
+    REQUIRE(tags.Contains(130));
+    REQUIRE(!tags.Contains(4));
+    REQUIRE(2 == tags.Size());
+  }
+
+  SECTION("Disabled members are only found when asked for") {
+    tags.Set(3, false);
+    REQUIRE(!tags.Contains(3));
+    REQUIRE(tags.Contains(3, false));
+  }
+
+  SECTION("Can move a member between enabled and disabled") {
+    tags.Set(3, true);
+    tags.SetIsEnabled(3, false);
+    REQUIRE(!tags.Contains(3));
+    tags.SetIsEnabled(3, true);
+    REQUIRE(tags.Contains(3));
+    REQUIRE(1 == tags.Size());
+  }
+
+  SECTION("Can remove a member") {
+    tags.Set(3, true);
+    tags.Remove(3);
+    tags.Remove(500);
+    REQUIRE(!tags.Contains(3));
+    REQUIRE(0 == tags.Size());
+  }
+
+  SECTION("Visits members in entity order") {
+    tags.Set(70, true);
+    tags.Set(2, true);
+    tags.Set(5, false);
+    std::vector<TagSet::EntityId> members;
+    tags.ForEach([&](TagSet::EntityId const id) { members.push_back(id); });
+    REQUIRE(std::vector<TagSet::EntityId>{2, 70} == members);
+  }
+
+  SECTION("Only allocates pages for ids in use") {
+    TagSet::EntityId const high = 100 << 24;
+    tags.Set(high + 1, true);
+    tags.Set(high + 2, true);
+    REQUIRE(1 == tags.PageCount());
+    std::vector<TagSet::EntityId> members;
+    tags.ForEach([&](TagSet::EntityId const id) { members.push_back(id); });
+    REQUIRE(std::vector<TagSet::EntityId>{high + 1, high + 2} == members);
+  }
+
+  SECTION("Frees a page with its last member") {
+    tags.Set(3, true);
+    tags.Set(1 << 20, false);
+    REQUIRE(2 == tags.PageCount());
+    tags.Remove(1 << 20);
+    tags.SetIsEnabled(3, false);
+    REQUIRE(1 == tags.PageCount());
+    REQUIRE(tags.Contains(3, false));
+  }
+
+  SECTION("Negative ids are never members") {
+    tags.Set(3, true);
+    tags.Remove(-1);
+    REQUIRE(!tags.Contains(-1, false));
+    REQUIRE(1 == tags.Size());
+  }
+}
+
+TEST_CASE("Component Pool") {
+  ComponentPool<TestComponent> pool;
+  std::vector<ComponentPoolBase::DataId> ids;
+  for (int i = 0; i < 6; ++i) {
+    ids.push_back(pool.Add({i}));
+  }
+
+  SECTION("Data ids are handed out in order") {
+    REQUIRE(std::vector<ComponentPoolBase::DataId>{0, 1, 2, 3, 4, 5} == ids);
+  }
+
+  SECTION("Removing a component leaves a hole") {
+    pool.Remove(ids[1]);
+    REQUIRE(5 == pool.Size());
+    REQUIRE(6 == pool.Capacity());
+    REQUIRE(pool.Get(ids[1]).expired());
+  }
+
+  SECTION("Removing from the back does not leave a hole") {
+    pool.Remove(ids[5]);
+    REQUIRE(5 == pool.Capacity());
+  }
+
+  pool.Remove(ids[1]);
+  pool.Remove(ids[3]);
+
+  SECTION("Compact step fills holes from the back") {
+    REQUIRE(2 == pool.CompactStep(10));
+    REQUIRE(4 == pool.Capacity());
+    REQUIRE(std::vector<int>{0, 5, 2, 4} == PoolValues(pool));
+  }
+
+  SECTION("Compact step respects budget") {
+    REQUIRE(1 == pool.CompactStep(1));
+    REQUIRE(pool.HasHoles());
+  }
+
+  SECTION("Compact step keeps weak pointers valid") {
+    auto component = pool.Get(ids[5]);
+    pool.CompactStep(10);
+    REQUIRE(5 == component.lock()->a);
+  }
+
+  SECTION("Compact removes all holes") {
+    pool.Compact();
+    REQUIRE(4 == pool.Capacity());
+    REQUIRE(std::vector<int>{0, 2, 4, 5} == PoolValues(pool));
+  }
+
+  SECTION("Compact without relocating only reorders slots") {
+    auto component = pool.Get(ids[0]);
+    pool.Compact({ids[5]}, false);
+    REQUIRE(4 == pool.Capacity());
+    REQUIRE(std::vector<int>{5, 0, 2, 4} == PoolValues(pool));
+    REQUIRE(component.lock() == pool.Get(ids[0]).lock());
+  }
+
+  SECTION("Compact keeps data ids valid") {
+    pool.Compact();
+    REQUIRE(4 == pool.Get(ids[4]).lock()->a);
+    REQUIRE(!pool.Contains(ids[3]));
+  }
+
+  SECTION("Compact can reorder components") {
+    pool.Compact({ids[5], ids[0]});
+    REQUIRE(std::vector<int>{5, 0, 2, 4} == PoolValues(pool));
+    REQUIRE(2 == pool.Get(ids[2]).lock()->a);
+  }
+
+  SECTION("Compact expires outstanding weak pointers") {
+    auto component = pool.Get(ids[0]);
+    pool.Compact();
+    REQUIRE(component.expired());
+  }
+
+  SECTION("Compact leaves locked pointers intact") {
+    auto component = pool.Get(ids[0]).lock();
+    pool.Compact();
+    REQUIRE(0 == component->a);
+    REQUIRE(0 == pool.Get(ids[0]).lock()->a);
+  }
+
+  SECTION("Compact keeps locked components in place") {
+    auto component = pool.Get(ids[0]).lock();
+    pool.Compact();
+    REQUIRE(component == pool.Get(ids[0]).lock());
+    component->a = 7;
+    REQUIRE(7 == pool.Find(ids[0])->a);
+  }
+
+  SECTION("A later compact moves components once unlocked") {
+    auto component = pool.Get(ids[0]).lock();
+    pool.Compact();
+    auto const observer = pool.Get(ids[0]);
+    component.reset();
+    pool.Compact();
+    REQUIRE(observer.expired());
+    REQUIRE(0 == pool.Find(ids[0])->a);
+  }
+
+  SECTION("Can add after compaction") {
+    pool.Compact();
+    auto id = pool.Add({9});
+    REQUIRE(6 == id);
+    REQUIRE(9 == pool.Get(id).lock()->a);
+  }
+
+  auto const descending = [](TestComponent const& lhs,
+                             TestComponent const& rhs) {
+    return lhs.a > rhs.a;
+  };
+
+  SECTION("Sort fills holes and orders components") {
+    pool.Sort(descending);
+    REQUIRE(std::vector<int>{5, 4, 2, 0} == PoolValues(pool));
+    REQUIRE(2 == pool.Get(ids[2]).lock()->a);
+  }
+
+  SECTION("Sorting a sorted pool moves nothing") {
+    pool.Sort(descending);
+    REQUIRE(0 == pool.Sort(descending));
+  }
+
+  SECTION("Sort keeps weak pointers valid") {
+    auto component = pool.Get(ids[0]);
+    pool.Sort(descending);
+    REQUIRE(0 == component.lock()->a);
+  }
+
+  SECTION("Arrange moves components to the front in order") {
+    pool.Arrange({ids[4], ids[0]});
+    REQUIRE(4 == pool.At(0)->a);
+    REQUIRE(0 == pool.At(1)->a);
+    REQUIRE(nullptr == pool.At(10));
+    REQUIRE(4 == pool.Get(ids[4]).lock()->a);
+  }
+}
+
+TEST_CASE("Component Pool of move-only components") {
+  ComponentPool<std::unique_ptr<int>> pool;
+  std::vector<ComponentPoolBase::DataId> ids;
+  for (int i = 0; i < 3; ++i) {
+    ids.push_back(pool.Add(std::make_unique<int>(i)));
+  }
+  pool.Remove(ids[0]);
+
+  SECTION("Compact leaves locked components in place") {
+    auto component = pool.Get(ids[1]).lock();
+    auto const* value = component->get();
+    pool.Compact();
+    REQUIRE(value == component->get());
+    REQUIRE(component == pool.Get(ids[1]).lock());
+    REQUIRE(2 == **pool.Get(ids[2]).lock());
+    REQUIRE(2 == pool.Capacity());
+  }
+
+  SECTION("Compact moves unlocked components") {
+    pool.Compact();
+    REQUIRE(1 == **pool.Get(ids[1]).lock());
+  }
+}
\ No newline at end of file
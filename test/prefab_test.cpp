@@ -0,0 +1,86 @@
+#include "prefab.hpp"
+
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+namespace {
+class CreateCounter : public System {
+ public:
+  CreateCounter(std::shared_ptr<EventManager> eventManager,
+                std::size_t* created)
+      : observer_(
+            eventManager->SubscribeSystem<std::shared_ptr<Entity>>(
+                SystemEvent::CreateEntity,
+                [created](std::shared_ptr<Entity> const&) { ++*created; })) {}
+  ~CreateCounter() { observer_->Unsubscribe(); }
+
+  void Tick(double const) override {}
+
+ private:
+  ObserverPtr observer_;
+};
+}  // namespace
+
+TEST_CASE("Prefabs") {
+  Manager manager;
+  Prefab prefab;
+  prefab.Set(TestComponent{3}).Set(TestComponent2{4}).Set(TestTag{});
+
+  SECTION("Setting a component again replaces its value") {
+    prefab.Set(TestComponent{7});
+    REQUIRE(3 == prefab.Size());
+    auto entity = manager.Instantiate(prefab)[0].lock();
+    REQUIRE(7 == entity->GetComponent<TestComponent>().lock()->a);
+  }
+
+  SECTION("Can remove a component") {
+    prefab.Remove<TestTag>();
+    REQUIRE(!prefab.Has<TestTag>());
+    REQUIRE(prefab.Has<TestComponent>());
+  }
+
+  SECTION("Instantiates entities with every component") {
+    auto entities = manager.Instantiate(prefab, 10);
+    REQUIRE(10 == entities.size());
+    std::size_t found = 0;
+    manager.ForEach<TestComponent, TestComponent2, With<TestTag>>(
+        [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent> first,
+            std::shared_ptr<TestComponent2> second) {
+          REQUIRE(3 == first->a);
+          REQUIRE(4 == second->b);
+          ++found;
+        });
+    REQUIRE(10 == found);
+  }
+
+  SECTION("Each entity gets its own copy") {
+    auto entities = manager.Instantiate(prefab, 2);
+    entities[0].lock()->GetComponent<TestComponent>().lock()->a = 9;
+    REQUIRE(3 == entities[1].lock()->GetComponent<TestComponent>().lock()->a);
+  }
+
+  SECTION("Instantiated entities behave like any other") {
+    auto entity = manager.Instantiate(prefab)[0].lock();
+    REQUIRE(entity->HasComponent<TestTag>());
+    entity->RemoveComponent<TestComponent>();
+    REQUIRE(!entity->HasComponent<TestComponent>());
+    REQUIRE(!manager.GetEntity(entity->GetId()).expired());
+    manager.DestroyEntity(entity->GetId());
+    REQUIRE(manager.Query<TestComponent2>().empty());
+  }
+
+  SECTION("Sends a create event per entity") {
+    std::size_t created = 0;
+    manager.AddSystem<CreateCounter>(&created);
+    manager.Instantiate(prefab, 5);
+    REQUIRE(5 == created);
+  }
+
+  SECTION("Rejected during a read phase") {
+    auto phase = manager.BeginReadPhase();
+    REQUIRE(manager.Instantiate(prefab, 5).empty());
+  }
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "profiler.hpp"
+
+#include <sstream>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+TEST_CASE("Profiler") {
+  Profiler profiler;
+
+  SECTION("Counters start at zero") {
+    REQUIRE(0 == profiler.GetStats().Get(Profiler::Counter::EntityCreated));
+  }
+
+  SECTION("Can count events") {
+    profiler.Count(Profiler::Counter::ComponentCreated, 3);
+    REQUIRE(3 == profiler.GetStats().Get(Profiler::Counter::ComponentCreated));
+  }
+
+  SECTION("Records system tick durations") {
+    auto start = Profiler::Clock::now();
+    profiler.RecordSystem(1, start, start + std::chrono::microseconds{5});
+    profiler.RecordSystem(1, start, start + std::chrono::microseconds{15});
+    auto const stats = profiler.GetStats();
+    auto const& histogram = stats.Systems.at(1);
+    REQUIRE(2 == histogram.Samples);
+    REQUIRE(std::chrono::microseconds{5} == histogram.Min);
+    REQUIRE(std::chrono::microseconds{15} == histogram.Max);
+    REQUIRE(histogram.Percentile(50) <= std::chrono::microseconds{15});
+  }
+
+  SECTION("Records query iterations") {
+    profiler.RecordQuery(7, "query", 10);
+    profiler.RecordQuery(7, "query", 5);
+    auto const stats = profiler.GetStats();
+    auto const& query = stats.Queries.at(7);
+    REQUIRE(2 == query.Calls);
+    REQUIRE(15 == query.Iterations);
+  }
+
+  SECTION("Reset clears all stats") {
+    profiler.Count(Profiler::Counter::EventNotified, 1);
+    profiler.RecordQuery(7, "query", 10);
+    profiler.Reset();
+    REQUIRE(0 == profiler.GetStats().Get(Profiler::Counter::EventNotified));
+    REQUIRE(profiler.GetStats().Queries.empty());
+  }
+
+  SECTION("Writes system ticks as chrome trace events") {
+    profiler.SetSystemName(1, "Physics");
+    profiler.StartTrace();
+    auto start = Profiler::Clock::now();
+    profiler.RecordSystem(1, start, start + std::chrono::microseconds{5});
+    std::stringstream trace;
+    profiler.WriteChromeTrace(trace);
+    REQUIRE(trace.str().starts_with("{\"traceEvents\":[{\"name\":\"Physics\""));
+    REQUIRE(trace.str().ends_with("}]}"));
+  }
+
+  SECTION("Does not trace unless started") {
+    auto start = Profiler::Clock::now();
+    profiler.RecordSystem(1, start, start);
+    std::stringstream trace;
+    profiler.WriteChromeTrace(trace);
+    REQUIRE("{\"traceEvents\":[]}" == trace.str());
+  }
+}
+
+#ifdef CRYSTAL_ENTITY_PROFILING
+TEST_CASE("Manager profiling") {
+  Manager manager;
+  auto const& profiler = manager.GetProfiler();
+
+  SECTION("Counts entity and component churn") {
+    auto entity = manager.CreateEntity().lock();
+    entity->AddComponent<TestComponent>({1});
+    manager.DestroyEntity(entity->GetId());
+    auto stats = profiler->GetStats();
+    REQUIRE(1 == stats.Get(Profiler::Counter::EntityCreated));
+    REQUIRE(1 == stats.Get(Profiler::Counter::EntityDestroyed));
+    REQUIRE(1 == stats.Get(Profiler::Counter::ComponentCreated));
+    REQUIRE(1 == stats.Get(Profiler::Counter::ComponentRemoved));
+  }
+
+  SECTION("Times each system tick") {
+    auto id = manager.AddSystem<TestSystem2>(nullptr, nullptr);
+    manager.Tick(60.0f);
+    manager.Tick(60.0f);
+    REQUIRE(2 == profiler->GetStats().Systems.at(id).Samples);
+  }
+
+  SECTION("Counts query iterations") {
+    manager.CreateEntity().lock()->AddComponent<TestComponent>({1});
+    manager.ForEach<TestComponent>(
+        [](std::shared_ptr<Entity>, std::shared_ptr<TestComponent>) {});
+    auto stats = profiler->GetStats();
+    REQUIRE(1 == stats.Queries.size());
+    REQUIRE(1 == stats.Queries.begin()->second.Iterations);
+  }
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+
+#include "relation.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+struct Likes {};
+struct Targets {};
+}  // namespace
+
+TEST_CASE("Relation Store") {
+  RelationStore store;
+
+  SECTION("Can add and query a relation in both directions") {
+    REQUIRE(store.Add<Likes>(1, 2));
+    REQUIRE(store.Contains<Likes>(1, 2));
+    REQUIRE(!store.Contains<Likes>(2, 1));
+    REQUIRE(std::vector<RelationStore::EntityId>{2} ==
+            store.GetTargets<Likes>(1));
+    REQUIRE(std::vector<RelationStore::EntityId>{1} ==
+            store.GetSources<Likes>(2));
+  }
+
+  SECTION("Adding the same pair twice fails") {
+    store.Add<Likes>(1, 2);
+    REQUIRE(!store.Add<Likes>(1, 2));
+  }
+
+  SECTION("Relation types are independent") {
+    store.Add<Likes>(1, 2);
+    REQUIRE(!store.Contains<Targets>(1, 2));
+    REQUIRE(store.GetTargets<Targets>(1).empty());
+  }
+
+  SECTION("Can remove a relation") {
+    store.Add<Likes>(1, 2);
+    REQUIRE(store.Remove<Likes>(1, 2));
+    REQUIRE(!store.Remove<Likes>(1, 2));
+    REQUIRE(store.GetSources<Likes>(2).empty());
+  }
+
+  SECTION("Removing an entity drops relations in both directions") {
+    store.Add<Likes>(1, 2);
+    store.Add<Likes>(2, 3);
+    store.Add<Targets>(3, 2);
+    store.RemoveEntity(2);
+    REQUIRE(store.GetTargets<Likes>(1).empty());
+    REQUIRE(store.GetSources<Likes>(3).empty());
+    REQUIRE(store.GetTargets<Targets>(3).empty());
+  }
+}
\ No newline at end of file
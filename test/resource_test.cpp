@@ -0,0 +1,44 @@
+#include "resource.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+
+TEST_CASE("Resource Store") {
+  ResourceStore store;
+
+  SECTION("Returns nullptr for missing resource") {
+    REQUIRE(nullptr == store.Get<TestComponent>());
+    REQUIRE(!store.Contains<TestComponent>());
+  }
+
+  SECTION("Can add and get a resource") {
+    store.Emplace<TestComponent>(1);
+    REQUIRE(1 == store.Get<TestComponent>()->a);
+  }
+
+  SECTION("Emplacing again replaces the resource") {
+    store.Emplace<TestComponent>(1);
+    store.Emplace<TestComponent>(5);
+    REQUIRE(5 == store.Get<TestComponent>()->a);
+  }
+
+  SECTION("Resources of different types are independent") {
+    store.Emplace<TestComponent>(1);
+    store.Emplace<TestComponent2>(2);
+    REQUIRE(1 == store.Get<TestComponent>()->a);
+    REQUIRE(2 == store.Get<TestComponent2>()->b);
+  }
+
+  SECTION("Can remove a resource") {
+    store.Emplace<TestComponent>(1);
+    store.Remove<TestComponent>();
+    REQUIRE(nullptr == store.Get<TestComponent>());
+  }
+
+  SECTION("Index is stable per type") {
+    REQUIRE(ResourceStore::GetIndex<TestComponent>() ==
+            ResourceStore::GetIndex<TestComponent>());
+    REQUIRE(ResourceStore::GetIndex<TestComponent>() !=
+            ResourceStore::GetIndex<TestComponent2>());
+  }
+}
\ No newline at end of file
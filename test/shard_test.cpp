@@ -0,0 +1,229 @@
+#include "shard.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+namespace {
+struct Position {
+  float x;
+  float y;
+};
+
+struct Health {
+  int value;
+};
+
+using TestShard = Shard<Position, Health>;
+
+struct Node {
+  explicit Node(Transport::ShardId const id,
+                std::unique_ptr<Transport> transport)
+      : componentManager(std::make_shared<ComponentManager>(
+            ComponentManager::Concurrency::SingleThreaded,
+            TestShard::FirstEntityId(id))),
+        manager(componentManager),
+        shard(id, manager, componentManager, std::move(transport)) {}
+
+  std::shared_ptr<ComponentManager> componentManager;
+  Manager manager;
+  TestShard shard;
+};
+
+std::vector<Entity::Id> Populate(Manager& manager, int const count) {
+  std::vector<Entity::Id> ids;
+  for (int i = 0; i < count; ++i) {
+    auto entity = manager.CreateEntity().lock();
+    entity->AddComponent<Position>({float(i), float(-i)});
+    if (i % 2 == 0) entity->AddComponent<Health>({i * 10});
+    ids.push_back(entity->GetId());
+  }
+  return ids;
+}
+
+void CheckMigration(Node& from, Node& to) {
+  auto const ids = Populate(from.manager, 6);
+  from.manager.GetEntity(ids[1]).lock()->SetIsEnabled(false);
+  from.manager.GetEntity(ids[3]).lock()->AddComponent<TestComponent>({1});
+
+  REQUIRE(from.shard.Migrate({ids[0], ids[1], ids[2], ids[3]},
+                             to.shard.GetId()) == 3);
+  // Only the shard's listed components travel, so it would lose one
+  CHECK(from.shard.GetSkipped() == std::vector{ids[3]});
+  CHECK(from.manager.GetEntity(ids[3]).lock()->HasComponent<TestComponent>());
+  CHECK(from.manager.GetEntity(ids[0]).expired());
+  CHECK(from.manager.Query<Position>(false).size() == 3);
+  CHECK(to.manager.GetEntity(ids[0]).expired());
+
+  REQUIRE(to.shard.Poll() == 3);
+  auto const entity = to.manager.GetEntity(ids[0]).lock();
+  REQUIRE(entity);
+  CHECK(entity->GetId() == ids[0]);
+  CHECK(entity->GetComponent<Position>().lock()->x == 0.0f);
+  CHECK(entity->GetComponent<Health>().lock()->value == 0);
+  CHECK(!to.manager.GetEntity(ids[1]).lock()->GetIsEnabled());
+  CHECK(!to.manager.GetEntity(ids[1]).lock()->HasComponent<Health>());
+  CHECK(to.manager.GetEntity(ids[2]).lock()->GetIsEnabled());
+  CHECK(to.manager.Query<Position>(false).size() == 3);
+
+  // And back home again
+  REQUIRE(to.shard.Migrate({ids[0]}, from.shard.GetId()) == 1);
+  REQUIRE(from.shard.Poll() == 1);
+  CHECK(from.manager.GetEntity(ids[0]).lock()->GetComponent<Health>()
+            .lock()->value == 0);
+}
+}  // namespace
+
+TEST_CASE("Shard entity ranges") {
+  CHECK(TestShard::FirstEntityId(0) == 0);
+  CHECK(TestShard::HomeOf(TestShard::FirstEntityId(3) + 5) == 3);
+  auto const last = TestShard::kMaxShards - 1;
+  CHECK(TestShard::FirstEntityId(last) > 0);
+  CHECK(TestShard::HomeOf(TestShard::FirstEntityId(last)) == last);
+
+  LoopbackNetwork network;
+  Node node(2, network.Connect(2));
+  auto const ids = Populate(node.manager, 2);
+  CHECK(ids[0] == TestShard::FirstEntityId(2));
+  CHECK(TestShard::HomeOf(ids[1]) == 2);
+}
+
+TEST_CASE("Shard migration over loopback") {
+  LoopbackNetwork network;
+  Node first(0, network.Connect(0));
+  Node second(1, network.Connect(1));
+  CheckMigration(first, second);
+
+  SECTION("Unknown shards and missing entities aren't sent") {
+    auto const ids = Populate(first.manager, 1);
+    CHECK(first.shard.Migrate(ids, 7) == 0);
+    CHECK(!first.manager.GetEntity(ids[0]).expired());
+    CHECK(first.shard.Migrate({12345}, 1) == 0);
+    CHECK(first.shard.Migrate(ids, 0) == 0);
+  }
+
+  SECTION("Frozen components travel too") {
+    auto const ids = Populate(first.manager, 1);
+    first.manager.SetColdStorage(true);
+    first.manager.GetEntity(ids[0]).lock()->SetIsEnabled(false);
+    REQUIRE(first.componentManager->IsFrozen(ids[0]));
+
+    REQUIRE(first.shard.Migrate(ids, 1) == 1);
+    REQUIRE(second.shard.Poll() == 1);
+    auto const entity = second.manager.GetEntity(ids[0]).lock();
+    REQUIRE(!entity->GetIsEnabled());
+    CHECK(entity->GetComponent<Health>().lock()->value == 0);
+    CHECK(first.componentManager->ColdStorageBytes() == 0);
+  }
+
+  SECTION("Migrations are held back during a read phase") {
+    auto const ids = Populate(first.manager, 2);
+    REQUIRE(first.shard.Migrate(ids, 1) == 2);
+    {
+      auto phase = second.manager.BeginReadPhase();
+      CHECK(second.shard.Poll() == 0);
+    }
+    CHECK(second.shard.Poll() == 2);
+    CHECK(!second.manager.GetEntity(ids[1]).expired());
+  }
+}
+
+TEST_CASE("Shard migration between high shard ids") {
+  LoopbackNetwork network;
+  auto const last = TestShard::kMaxShards - 1;
+  Node first(last - 1, network.Connect(last - 1));
+  Node second(last, network.Connect(last));
+  CheckMigration(first, second);
+
+  SECTION("Entities keep their ids") {
+    auto const ids = Populate(second.manager, 2);
+    CHECK(TestShard::HomeOf(ids[1]) == last);
+    REQUIRE(second.shard.Migrate(ids, last - 1) == 2);
+    REQUIRE(first.shard.Poll() == 2);
+    CHECK(first.manager.Query<Position>().size() == 6);
+    CHECK(first.manager.GetEntity(ids[1]).lock()->GetComponent<Position>()
+              .lock()->x == 1.0f);
+  }
+}
+
+TEST_CASE("Shard migration over a socket") {
+  auto first = std::make_unique<SocketTransport>();
+  auto second = std::make_unique<SocketTransport>();
+  REQUIRE(SocketTransport::ConnectPair(*first, 0, *second, 1));
+  Node home(0, std::move(first));
+  Node away(1, std::move(second));
+  CheckMigration(home, away);
+
+  SECTION("Large messages arrive whole") {
+    auto const ids = Populate(home.manager, 20000);
+    REQUIRE(home.shard.Migrate(ids, 1) == ids.size());
+    std::size_t restored = 0;
+    for (int i = 0; i < 100 && restored < ids.size(); ++i) {
+      restored += away.shard.Poll();
+      home.shard.Poll();
+    }
+    CHECK(restored == ids.size());
+    CHECK(away.manager.GetEntity(ids.back()).lock()->GetComponent<Position>()
+              .lock()->x == 19999.0f);
+  }
+}
+
+TEST_CASE("Shard ghosts") {
+  LoopbackNetwork network;
+  Node owner(0, network.Connect(0));
+  Node reader(1, network.Connect(1));
+  Node other(2, network.Connect(2));
+  auto const ids = Populate(owner.manager, 3);
+
+  REQUIRE(owner.shard.Publish(ids, 1) == 3);
+  REQUIRE(owner.shard.Publish({ids[0]}, 2) == 1);
+  reader.shard.Poll();
+  other.shard.Poll();
+  CHECK(reader.shard.GhostCount() == 3);
+  CHECK(reader.manager.GetEntity(ids[0]).expired());
+  CHECK(reader.shard.GetGhost<Position>(ids[2])->x == 2.0f);
+  CHECK(reader.shard.GetGhost<Health>(ids[1]) == nullptr);
+  CHECK(reader.shard.GetGhostIsEnabled(ids[0]));
+
+  SECTION("Publishing again updates the ghost") {
+    owner.manager.GetEntity(ids[2]).lock()->GetComponent<Position>()
+        .lock()->x = 42.0f;
+    owner.shard.Publish({ids[2]}, 1);
+    reader.shard.Poll();
+    CHECK(reader.shard.GetGhost<Position>(ids[2])->x == 42.0f);
+  }
+
+  SECTION("Publishing a frozen entity leaves it frozen") {
+    owner.manager.SetColdStorage(true);
+    owner.manager.GetEntity(ids[2]).lock()->SetIsEnabled(false);
+    REQUIRE(owner.shard.Publish({ids[2]}, 1) == 1);
+    reader.shard.Poll();
+    CHECK(reader.shard.GetGhost<Health>(ids[2])->value == 20);
+    CHECK(!reader.shard.GetGhostIsEnabled(ids[2]));
+    CHECK(owner.componentManager->IsFrozen(ids[2]));
+  }
+
+  SECTION("Unpublishing drops the ghost") {
+    owner.shard.Unpublish({ids[1]}, 1);
+    reader.shard.Poll();
+    CHECK(!reader.shard.HasGhost(ids[1]));
+    CHECK(reader.shard.HasGhost(ids[0]));
+  }
+
+  SECTION("Migrating replaces ghosts with the entity") {
+    REQUIRE(owner.shard.Migrate({ids[0]}, 1) == 1);
+    CHECK(reader.shard.Poll() == 1);
+    other.shard.Poll();
+    CHECK(!reader.shard.HasGhost(ids[0]));
+    CHECK(!reader.manager.GetEntity(ids[0]).expired());
+    CHECK(!other.shard.HasGhost(ids[0]));
+  }
+
+  SECTION("Messages from other builds are rejected") {
+    Shard<Position> narrow(3, owner.manager, owner.componentManager,
+                           network.Connect(3));
+    CHECK(narrow.Publish(ids, 1) == 3);
+    reader.shard.Poll();
+    CHECK(reader.shard.RejectedCount() == 1);
+  }
+}
\ No newline at end of file
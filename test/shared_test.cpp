@@ -0,0 +1,157 @@
+#include "shared.hpp"
+
+#include <array>
+#include <map>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+#include "component.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+namespace {
+struct MeshDesc {
+  std::array<int, 16> Lods;
+
+  bool operator==(MeshDesc const&) const = default;
+};
+
+struct AiConfig {
+  std::string Behaviour;
+  float Aggression;
+
+  bool operator==(AiConfig const&) const = default;
+};
+}  // namespace
+
+template <>
+struct ShareValues<MeshDesc> : std::true_type {};
+template <>
+struct ShareValues<AiConfig> : std::true_type {};
+
+template <>
+struct std::hash<AiConfig> {
+  std::size_t operator()(AiConfig const& config) const {
+    return std::hash<std::string>{}(config.Behaviour);
+  }
+};
+
+template <typename Pointer>
+concept CanWriteThrough =
+    requires(Pointer pointer) { pointer->Behaviour = std::string(); };
+
+TEST_CASE("Shared pool") {
+  SharedPool<MeshDesc> pool;
+  auto const a = pool.Emplace(MeshDesc{{1}});
+  auto const b = pool.Emplace(MeshDesc{{1}});
+  auto const c = pool.Emplace(MeshDesc{{2}});
+
+  SECTION("Equal values are stored once") {
+    REQUIRE(3 == pool.Size());
+    REQUIRE(2 == pool.Distinct());
+    REQUIRE(pool.Find(a) == pool.Find(b));
+    REQUIRE(pool.Find(a) != pool.Find(c));
+  }
+
+  SECTION("A value is freed with its last user") {
+    pool.Remove(a);
+    REQUIRE(2 == pool.Distinct());
+    pool.Remove(b);
+    REQUIRE(1 == pool.Distinct());
+    REQUIRE(!pool.Contains(b));
+    REQUIRE(2 == pool.Find(c)->Lods[0]);
+  }
+
+  SECTION("Freed values are reused") {
+    pool.Remove(c);
+    auto const d = pool.Emplace(MeshDesc{{3}});
+    REQUIRE(2 == pool.Distinct());
+    REQUIRE(3 == pool.Find(d)->Lods[0]);
+  }
+
+  SECTION("Assigning moves a component to another value") {
+    pool.Assign(a, MeshDesc{{2}});
+    REQUIRE(pool.Find(a) == pool.Find(c));
+    pool.Assign(b, MeshDesc{{2}});
+    REQUIRE(1 == pool.Distinct());
+    pool.Assign(b, MeshDesc{{2}});
+    REQUIRE(3 == pool.Size());
+  }
+
+  SECTION("Assigning to a removed id stores nothing") {
+    pool.Remove(c);
+    pool.Assign(c, MeshDesc{{4}});
+    REQUIRE(!pool.Contains(c));
+    REQUIRE(1 == pool.Distinct());
+  }
+}
+
+TEST_CASE("Shared components") {
+  auto componentManager = std::make_shared<ComponentManager>();
+  Manager manager(componentManager);
+
+  std::vector<std::shared_ptr<Entity>> entities;
+  for (int i = 0; i < 6; ++i) {
+    auto entity = manager.CreateEntity().lock();
+    entity->AddComponent<AiConfig>({i % 2 ? "guard" : "patrol", 0.5f});
+    entity->AddComponent<TestComponent>({i});
+    entities.push_back(entity);
+  }
+
+  SECTION("Entities with equal values share one copy") {
+    REQUIRE(2 == componentManager->CountSharedValues<AiConfig>());
+    REQUIRE(entities[0]->GetComponent<AiConfig>().lock() ==
+            entities[2]->GetComponent<AiConfig>().lock());
+    REQUIRE("guard" == entities[1]->GetComponent<AiConfig>().lock()->Behaviour);
+  }
+
+  SECTION("Shared values are handed out read only") {
+    static_assert(!CanWriteThrough<
+                  decltype(entities[0]->GetComponent<AiConfig>().lock())>);
+    static_assert(!CanWriteThrough<decltype(componentManager
+                                                ->GetByEntity<AiConfig>(0)
+                                                .lock())>);
+    static_assert(!CanWriteThrough<
+                  std::tuple_element_t<0, QueryArgs<AiConfig>>>);
+    static_assert(
+        CanWriteThrough<std::shared_ptr<AiConfig>>,
+        "the check itself must accept a mutable pointer");
+  }
+
+  SECTION("Can visit entities grouped by value") {
+    entities[5]->SetIsEnabled(false);
+    std::map<std::string, std::vector<Entity::Id>> groups;
+    manager.ForEachShared<AiConfig>(
+        [&](AiConfig const& config, std::span<Entity::Id const> ids) {
+          groups[config.Behaviour].assign(ids.begin(), ids.end());
+        });
+    REQUIRE(2 == groups.size());
+    REQUIRE(3 == groups["patrol"].size());
+    REQUIRE(2 == groups["guard"].size());
+  }
+
+  SECTION("Replacing gives the entity its own value") {
+    REQUIRE(entities[0]->ReplaceComponent<AiConfig>("sniper", 1.0f));
+    REQUIRE(3 == componentManager->CountSharedValues<AiConfig>());
+    REQUIRE("patrol" ==
+            entities[2]->GetComponent<AiConfig>().lock()->Behaviour);
+    REQUIRE("sniper" ==
+            entities[0]->GetComponent<AiConfig>().lock()->Behaviour);
+  }
+
+  SECTION("Shared components work in queries") {
+    std::size_t count = 0;
+    manager.ForEach<AiConfig, TestComponent>(
+        [&](std::shared_ptr<Entity>, std::shared_ptr<AiConfig const> config,
+            std::shared_ptr<TestComponent> component) {
+          REQUIRE((component->a % 2 ? "guard" : "patrol") == config->Behaviour);
+          ++count;
+        });
+    REQUIRE(6 == count);
+  }
+
+  SECTION("Removing the last user frees the value") {
+    for (int i = 1; i < 6; i += 2) entities[i]->RemoveComponent<AiConfig>();
+    REQUIRE(1 == componentManager->CountSharedValues<AiConfig>());
+  }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "soa.hpp"
+
+#include <span>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "component.hpp"
+#include "manager.hpp"
+
+namespace {
+struct Transform {
+  float Position = 0.0f;
+  float Rotation = 0.0f;
+  int Layer = 0;
+};
+}  // namespace
+
+template <>
+struct SoaLayout<Transform> {
+  static constexpr auto Fields = std::make_tuple(
+      &Transform::Position, &Transform::Rotation, &Transform::Layer);
+};
+
+TEST_CASE("SoA pools") {
+  SoaPool<Transform> pool;
+  std::vector<ComponentPoolBase::DataId> ids;
+  for (int i = 0; i < 4; ++i) {
+    ids.push_back(pool.Emplace(Transform{1.0f * i, 0.0f, i}));
+    pool.SetIsEnabled(ids.back(), true);
+  }
+
+  SECTION("Stores each field in its own array") {
+    REQUIRE(std::vector<int>{0, 1, 2, 3} == pool.Column<&Transform::Layer>());
+    REQUIRE(2.0f == pool.Get(ids[2]).Get<&Transform::Position>());
+  }
+
+  SECTION("Can load and store whole components") {
+    pool.Get(ids[1]).Store({5.0f, 6.0f, 7});
+    auto const component = pool.Get(ids[1]).Load();
+    REQUIRE(5.0f == component.Position);
+    REQUIRE(6.0f == component.Rotation);
+    REQUIRE(7 == component.Layer);
+  }
+
+  SECTION("Removing keeps the arrays packed") {
+    pool.Remove(ids[0]);
+    REQUIRE(3 == pool.Size());
+    REQUIRE(std::vector<int>{3, 1, 2} == pool.Column<&Transform::Layer>());
+    REQUIRE(!pool.Contains(ids[0]));
+    REQUIRE(3 == pool.Get(ids[3]).Get<&Transform::Layer>());
+  }
+
+  SECTION("Disabled components move behind enabled ones") {
+    pool.SetIsEnabled(ids[1], false);
+    REQUIRE(3 == pool.EnabledSize());
+    REQUIRE(1 == pool.Column<&Transform::Layer>().back());
+    pool.Remove(ids[0]);
+    REQUIRE(2 == pool.EnabledSize());
+    REQUIRE(1 == pool.Column<&Transform::Layer>().back());
+  }
+}
+
+TEST_CASE("SoA components in a manager") {
+  auto componentManager = std::make_shared<ComponentManager>();
+  Manager manager(componentManager);
+  std::vector<std::shared_ptr<Entity>> entities;
+  for (int i = 0; i < 5; ++i) {
+    entities.push_back(manager.CreateEntity().lock());
+    entities.back()->AddComponent<Transform>({1.0f * i, 0.0f, i});
+  }
+
+  SECTION("Spans cover enabled components") {
+    entities[2]->SetIsEnabled(false);
+    float sum = 0.0f;
+    std::size_t count = 0;
+    manager.ForEachFields<Transform, &Transform::Position>(
+        [&](std::span<Entity::Id const> ids, std::span<float> positions) {
+          REQUIRE(ids.size() == positions.size());
+          for (auto const position : positions) sum += position;
+          count = ids.size();
+        });
+    REQUIRE(4 == count);
+    REQUIRE(8.0f == sum);
+  }
+
+  SECTION("Writes through spans are kept") {
+    manager.ForEachFields<Transform, &Transform::Position,
+                          &Transform::Rotation>(
+        [&](std::span<Entity::Id const>, std::span<float> positions,
+            std::span<float> rotations) {
+          for (std::size_t i = 0; i < positions.size(); ++i) {
+            rotations[i] = positions[i] * 2.0f;
+          }
+        });
+    auto fields = componentManager->GetFields<Transform>(entities[3]->GetId());
+    REQUIRE(6.0f == fields.Get<&Transform::Rotation>());
+  }
+
+  SECTION("Proxies visit each component with its entity") {
+    manager.ForEachSoa<Transform>(
+        [&](Entity::Id const entityId, SoaRef<Transform> transform) {
+          REQUIRE(entityId == transform.Get<&Transform::Layer>());
+        });
+  }
+
+  SECTION("Removed and replaced like other components") {
+    entities[1]->RemoveComponent<Transform>();
+    REQUIRE(!entities[1]->HasComponent<Transform>());
+    REQUIRE(!componentManager->GetFields<Transform>(entities[1]->GetId()));
+
+    REQUIRE(entities[4]->ReplaceComponent<Transform>(Transform{9.0f, 0.0f, 9}));
+    REQUIRE(9 == componentManager->GetFields<Transform>(entities[4]->GetId())
+                     .Get<&Transform::Layer>());
+    REQUIRE(4 == manager.Query<Transform>().size());
+  }
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+
+#include "spatial.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+std::vector<SpatialGrid::EntityId> InRadius(SpatialGrid const& grid,
+                                            SpatialGrid::Point const& center,
+                                            float const radius) {
+  std::vector<SpatialGrid::EntityId> entities;
+  grid.ForEachInRadius(center, radius,
+                       [&](SpatialGrid::EntityId const entityId, auto const&) {
+                         entities.push_back(entityId);
+                       });
+  std::sort(entities.begin(), entities.end());
+  return entities;
+}
+}  // namespace
+
+TEST_CASE("Spatial Grid") {
+  SpatialGrid grid{2.0f};
+  grid.Set(1, {0.0f, 0.0f, 0.0f});
+  grid.Set(2, {1.5f, 0.0f, 0.0f});
+  grid.Set(3, {-3.0f, 0.0f, 0.0f});
+  grid.Set(4, {0.0f, 10.0f, 0.0f});
+
+  SECTION("Finds entities within radius") {
+    REQUIRE(std::vector<SpatialGrid::EntityId>{1, 2} ==
+            InRadius(grid, {0.0f, 0.0f, 0.0f}, 2.0f));
+  }
+
+  SECTION("Searches neighbouring cells with negative coordinates") {
+    REQUIRE(std::vector<SpatialGrid::EntityId>{1, 3} ==
+            InRadius(grid, {-1.5f, 0.0f, 0.0f}, 1.5f));
+  }
+
+  SECTION("Moving an entity updates its cell") {
+    grid.Set(4, {0.5f, 0.5f, 0.0f});
+    REQUIRE(std::vector<SpatialGrid::EntityId>{1, 2, 4} ==
+            InRadius(grid, {0.0f, 0.0f, 0.0f}, 2.0f));
+    REQUIRE(4 == grid.Size());
+  }
+
+  SECTION("Can remove an entity") {
+    grid.Set(5, {0.1f, 0.0f, 0.0f});
+    grid.Remove(1);
+    REQUIRE(!grid.Contains(1));
+    REQUIRE(std::vector<SpatialGrid::EntityId>{2, 5} ==
+            InRadius(grid, {0.0f, 0.0f, 0.0f}, 2.0f));
+  }
+
+  SECTION("Huge radii visit the occupied cells instead") {
+    grid.Set(5, {1e30f, -1e30f, 0.0f});
+    REQUIRE(std::vector<SpatialGrid::EntityId>{1, 2, 3, 4} ==
+            InRadius(grid, {0.0f, 0.0f, 0.0f}, 1e9f));
+    REQUIRE(std::vector<SpatialGrid::EntityId>{1, 2, 3, 4, 5} ==
+            InRadius(grid, {0.0f, 0.0f, 0.0f}, 1e31f));
+  }
+}
\ No newline at end of file
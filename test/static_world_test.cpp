@@ -0,0 +1,132 @@
+#include "static_world.hpp"
+
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+
+namespace {
+using World = StaticWorld<TestComponent, TestComponent2, TestTag>;
+
+class AddSystem : public System {
+ public:
+  AddSystem(World& world, int amount) : world_(world), amount_(amount) {}
+
+  void Tick(double const) override {
+    world_.ForEach<TestComponent>(
+        [&](World::EntityId, TestComponent& component) {
+          component.a += amount_;
+        });
+  }
+
+ private:
+  World& world_;
+  int amount_;
+};
+}  // namespace
+
+TEST_CASE("Static Storage") {
+  StaticStorage<TestComponent> storage;
+  storage.Emplace(3, 1);
+  storage.Emplace(7, 2);
+  storage.Emplace(5, 3);
+
+  SECTION("Can find components by entity") {
+    REQUIRE(2 == storage.Find(7)->a);
+    REQUIRE(nullptr == storage.Find(4));
+    REQUIRE(nullptr == storage.Find(100));
+  }
+
+  SECTION("Emplacing again replaces in place") {
+    storage.Emplace(7, 9);
+    REQUIRE(3 == storage.Size());
+    REQUIRE(9 == storage.Find(7)->a);
+  }
+
+  SECTION("Removing keeps the rest packed") {
+    storage.Remove(3);
+    REQUIRE(2 == storage.Size());
+    REQUIRE(std::vector<StaticStorage<TestComponent>::EntityId>{5, 7} ==
+            storage.Entities());
+    REQUIRE(3 == storage.Find(5)->a);
+    REQUIRE(!storage.Contains(3));
+  }
+}
+
+TEST_CASE("Static World") {
+  World world;
+  auto first = world.CreateEntity();
+  auto second = world.CreateEntity();
+  auto third = world.CreateEntity();
+  world.Add(first, TestComponent{1});
+  world.Add(second, TestComponent{2});
+  world.Add(third, TestComponent{3});
+  world.Add(second, TestComponent2{20});
+  world.Add(third, TestTag{});
+
+  SECTION("Can get components") {
+    REQUIRE(2 == world.Get<TestComponent>(second)->a);
+    REQUIRE(world.Has<TestComponent2>(second));
+    REQUIRE(nullptr == world.Get<TestComponent2>(first));
+  }
+
+  SECTION("ForEach visits entities with every component") {
+    std::vector<World::EntityId> visited;
+    world.ForEach<TestComponent, TestComponent2>(
+        [&](World::EntityId entityId, TestComponent& component,
+            TestComponent2& component2) {
+          REQUIRE(2 == component.a);
+          REQUIRE(20 == component2.b);
+          visited.push_back(entityId);
+        });
+    REQUIRE(std::vector<World::EntityId>{second} == visited);
+  }
+
+  SECTION("ForEach supports query terms") {
+    int sum = 0;
+    int found = 0;
+    world.ForEach<TestComponent, Without<TestTag>, Optional<TestComponent2>>(
+        [&](World::EntityId, TestComponent& component,
+            TestComponent2* component2) {
+          sum += component.a;
+          if (component2) ++found;
+        });
+    REQUIRE(3 == sum);
+    REQUIRE(1 == found);
+
+    std::vector<World::EntityId> tagged;
+    world.ForEach<With<TestTag>>(
+        [&](World::EntityId entityId) { tagged.push_back(entityId); });
+    REQUIRE(std::vector<World::EntityId>{third} == tagged);
+  }
+
+  SECTION("ForEach can remove the current entity") {
+    int visited = 0;
+    world.ForEach<TestComponent>(
+        [&](World::EntityId entityId, TestComponent&) {
+          world.DestroyEntity(entityId);
+          ++visited;
+        });
+    REQUIRE(3 == visited);
+    REQUIRE(0 == world.Size());
+    REQUIRE(0 == world.GetStorage<TestComponent>().Size());
+  }
+
+  SECTION("Destroying an entity removes its components") {
+    world.DestroyEntity(second);
+    REQUIRE(!world.IsAlive(second));
+    REQUIRE(!world.Has<TestComponent2>(second));
+    REQUIRE(nullptr == world.Emplace<TestComponent>(second, 1));
+    REQUIRE(2 == world.Size());
+  }
+
+  SECTION("Ticks systems") {
+    auto id = world.AddSystem<AddSystem>(10);
+    REQUIRE(System::GetId<AddSystem>() == id);
+    world.Tick(0.1);
+    REQUIRE(11 == world.Get<TestComponent>(first)->a);
+    world.RemoveSystem<AddSystem>();
+    world.Tick(0.1);
+    REQUIRE(11 == world.Get<TestComponent>(first)->a);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "streaming.hpp"
+
+#include <sys/resource.h>
+
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+#include "manager.hpp"
+
+namespace {
+struct Cell {
+  int x;
+  int y;
+};
+
+struct Health {
+  float value;
+};
+
+struct Extra {
+  int value;
+};
+}  // namespace
+
+TEST_CASE("Region streaming") {
+  auto const directory =
+      std::filesystem::temp_directory_path() / "crystal_entity_streaming";
+  std::filesystem::remove_all(directory);
+
+  auto componentManager = std::make_shared<ComponentManager>();
+  Manager manager(componentManager);
+  RegionStreamer<Cell, Health, TestComponent> streamer(
+      manager, componentManager, directory,
+      [](Cell const& cell) { return static_cast<uint64_t>(cell.x / 10); });
+
+  std::vector<Entity::Id> ids;
+  for (int i = 0; i < 20; ++i) {
+    auto entity = manager.CreateEntity().lock();
+    entity->AddComponent<Cell>({i, 0});
+    entity->AddComponent<Health>({i * 2.0f});
+    if (i % 2 == 0) entity->AddComponent<TestComponent>({i});
+    ids.push_back(entity->GetId());
+  }
+
+  SECTION("Paging out evicts only the region's entities") {
+    REQUIRE(10 == streamer.PageOut(0));
+    REQUIRE(streamer.IsPagedOut(0));
+    REQUIRE(!streamer.IsPagedOut(1));
+    for (int i = 0; i < 20; ++i) {
+      REQUIRE((i < 10) == manager.GetEntity(ids[i]).expired());
+    }
+    REQUIRE(10 == componentManager->Query<Health>().size());
+    REQUIRE(0 == streamer.PageOut(5));
+  }
+
+  SECTION("Paging in restores entities under their ids") {
+    streamer.PageOut(0);
+    REQUIRE(streamer.PageIn(0));
+    REQUIRE(!streamer.PageIn(0));
+    streamer.Flush();
+    REQUIRE(10 == streamer.Update());
+
+    for (int i = 0; i < 10; ++i) {
+      auto entity = manager.GetEntity(ids[i]).lock();
+      REQUIRE(entity);
+      REQUIRE(i == entity->GetComponent<Cell>().lock()->x);
+      REQUIRE(i * 2.0f == entity->GetComponent<Health>().lock()->value);
+      REQUIRE((i % 2 == 0) == entity->HasComponent<TestComponent>());
+    }
+    REQUIRE(20 == componentManager->Query<Health>().size());
+    REQUIRE(!std::filesystem::exists(directory / "region_0.bin"));
+  }
+
+  SECTION("New entities don't reuse paged out ids") {
+    streamer.PageOut(0);
+    auto entity = manager.CreateEntity().lock();
+    REQUIRE(std::find(ids.begin(), ids.end(), entity->GetId()) == ids.end());
+  }
+
+  SECTION("Disabled entities come back disabled") {
+    manager.GetEntity(ids[3]).lock()->SetIsEnabled(false);
+    streamer.PageOut(0);
+    streamer.PageIn(0);
+    streamer.Flush();
+    streamer.Update();
+    REQUIRE(!manager.GetEntity(ids[3]).lock()->GetIsEnabled());
+    REQUIRE(19 == componentManager->Query<Health>().size());
+  }
+
+  SECTION("Paging out a region again adds to its file") {
+    streamer.PageOut(0);
+    manager.CreateEntity().lock()->AddComponent<Cell>({5, 5});
+    REQUIRE(1 == streamer.PageOut(0));
+    streamer.PageIn(0);
+    streamer.Flush();
+    REQUIRE(11 == streamer.Update());
+  }
+
+  SECTION("Entities with unlisted components aren't paged out") {
+    manager.GetEntity(ids[1]).lock()->AddComponent<Extra>({7});
+    manager.GetEntity(ids[2]).lock()->AddComponent<std::string>("name");
+    REQUIRE(8 == streamer.PageOut(0));
+    REQUIRE(std::vector{ids[1], ids[2]} == streamer.GetSkipped());
+    REQUIRE(7 == manager.GetEntity(ids[1]).lock()->GetComponent<Extra>()
+                     .lock()->value);
+    REQUIRE("name" == *manager.GetEntity(ids[2]).lock()
+                           ->GetComponent<std::string>().lock());
+
+    manager.GetEntity(ids[1]).lock()->RemoveComponent<Extra>();
+    REQUIRE(1 == streamer.PageOut(0));
+    REQUIRE(std::vector{ids[2]} == streamer.GetSkipped());
+  }
+
+  SECTION("A failed write doesn't spoil later page outs") {
+    streamer.PageOut(0);
+    streamer.Flush();
+    auto const file = directory / "region_0.bin";
+    auto const size = std::filesystem::file_size(file);
+
+    // Let the next block only partly reach the disk
+    auto const previousHandler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    auto const previousLimit = limit;
+    limit.rlim_cur = size + 16;
+    setrlimit(RLIMIT_FSIZE, &limit);
+    manager.CreateEntity().lock()->AddComponent<Cell>({5, 5});
+    REQUIRE(1 == streamer.PageOut(0));
+    streamer.Flush();
+    setrlimit(RLIMIT_FSIZE, &previousLimit);
+    std::signal(SIGXFSZ, previousHandler);
+
+    REQUIRE(size == std::filesystem::file_size(file));
+    REQUIRE(1 == streamer.Update());
+    REQUIRE(1 == streamer.PageOut(0));
+    streamer.PageIn(0);
+    streamer.Flush();
+    REQUIRE(11 == streamer.Update());
+    REQUIRE(!streamer.IsPagedOut(0));
+  }
+
+  SECTION("An unreadable file leaves the region paged out") {
+    streamer.PageOut(0);
+    streamer.Flush();
+    std::ofstream(directory / "region_0.bin", std::ios::binary | std::ios::app)
+        << "garbage";
+    streamer.PageIn(0);
+    streamer.Flush();
+    REQUIRE(0 == streamer.Update());
+    REQUIRE(streamer.IsPagedOut(0));
+  }
+
+  streamer.Flush();
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Region streaming into an unwritable directory") {
+  // A file where a parent directory should be, so nothing can be created
+  auto const blocker =
+      std::filesystem::temp_directory_path() / "crystal_entity_unwritable";
+  std::filesystem::remove_all(blocker);
+  std::ofstream(blocker) << "not a directory";
+
+  auto componentManager = std::make_shared<ComponentManager>();
+  Manager manager(componentManager);
+  RegionStreamer<Cell, Health, TestComponent> streamer(
+      manager, componentManager, blocker / "regions",
+      [](Cell const& cell) { return static_cast<uint64_t>(cell.x / 10); });
+
+  auto entity = manager.CreateEntity().lock();
+  entity->AddComponent<Cell>({1, 0});
+  auto const id = entity->GetId();
+  entity.reset();
+
+  REQUIRE(1 == streamer.PageOut(0));
+  streamer.Flush();
+  REQUIRE(!streamer.IsPagedOut(0));
+  REQUIRE(!streamer.PageIn(0));
+  REQUIRE(1 == streamer.Update());
+  REQUIRE(!manager.GetEntity(id).expired());
+
+  std::filesystem::remove_all(blocker);
+}
\ No newline at end of file
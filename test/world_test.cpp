@@ -0,0 +1,88 @@
+#include "world_runner.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "data.hpp"
+
+namespace {
+class FailingSystem : public System {
+ public:
+  explicit FailingSystem(std::shared_ptr<EventManager>) {}
+  void Tick(double const) override { throw std::runtime_error("failed"); }
+};
+}  // namespace
+
+TEST_CASE("Work Stealing Pool") {
+  SECTION("Runs every job") {
+    std::atomic<int> count = 0;
+    WorkStealingPool pool(4);
+    for (int i = 0; i < 100; ++i) pool.Submit([&] { ++count; });
+    while (count < 100) std::this_thread::yield();
+    REQUIRE(100 == count);
+  }
+
+  SECTION("Jobs can submit more jobs") {
+    std::atomic<int> count = 0;
+    WorkStealingPool pool(2);
+    for (int i = 0; i < 10; ++i) {
+      pool.Submit([&] {
+        for (int j = 0; j < 10; ++j) pool.Submit([&] { ++count; });
+      });
+    }
+    while (count < 100) std::this_thread::yield();
+    REQUIRE(100 == count);
+  }
+}
+
+TEST_CASE("World Runner") {
+  WorldRunner runner(2);
+  auto& first = runner.AddWorld();
+  auto& second = runner.AddWorld();
+
+  SECTION("Worlds have their own entity ids") {
+    auto entity1 = first.CreateEntity().lock();
+    auto entity2 = second.CreateEntity().lock();
+    REQUIRE(entity1->GetId() == entity2->GetId());
+  }
+
+  SECTION("Worlds have their own components") {
+    first.CreateEntity().lock()->AddComponent<TestComponent>({1});
+    std::size_t found = 0;
+    second.ForEach<TestComponent>(
+        [&](std::shared_ptr<Entity>, std::shared_ptr<TestComponent>) {
+          ++found;
+        });
+    REQUIRE(0 == found);
+  }
+
+  SECTION("Ticks every world") {
+    std::vector<std::vector<System::Id>> orders(6);
+    for (std::size_t i = 2; i < orders.size(); ++i) runner.AddWorld();
+    for (std::size_t i = 0; i < orders.size(); ++i) {
+      runner.GetWorld(i).AddSystem<TestSystem2>(nullptr, &orders[i]);
+    }
+    runner.Tick(0.1);
+    runner.Tick(0.1);
+    for (auto const& order : orders) REQUIRE(2 == order.size());
+  }
+
+  SECTION("A throwing world doesn't stop the others") {
+    std::vector<System::Id> order;
+    first.AddSystem<FailingSystem>();
+    second.AddSystem<TestSystem2>(nullptr, &order);
+    REQUIRE_THROWS(runner.Tick(0.1));
+    REQUIRE(1 == order.size());
+    REQUIRE_THROWS(runner.Tick(0.1));
+    REQUIRE(2 == order.size());
+  }
+
+  SECTION("Can remove a world") {
+    runner.RemoveWorld(0);
+    REQUIRE(1 == runner.Size());
+    REQUIRE(&second == &runner.GetWorld(0));
+    runner.Tick(0.1);
+  }
+}
\ No newline at end of file